@@ -0,0 +1,276 @@
+#include "accounts.h"
+#include "log.h"
+#include "journal.h"
+#include "holders.h"
+#include "protocol.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Account store, sharded by name hash. Trades on accounts in different shards never
+// share a lock; sessions and the matching path reach an account through a stable
+// pointer and only take its shard lock.
+
+static AccountShard shards[ACCOUNT_SHARDS];
+
+void accounts_init() {
+    for (int i = 0; i < ACCOUNT_SHARDS; i++) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+}
+
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (; *name; name++) {
+        h ^= (unsigned char)*name;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline AccountShard* account_shard(const Account* account) {
+    return &shards[account->id & (ACCOUNT_SHARDS - 1)];
+}
+
+// Double a shard's name table; caller holds its lock
+static void shard_grow(AccountShard* shard) {
+    int count = shard->bucket_count ? shard->bucket_count * 2 : ACCOUNT_INITIAL_BUCKETS;
+    Account** buckets = calloc(count, sizeof(Account*));
+    if (!buckets) return;
+
+    for (int i = 0; i < shard->bucket_count; i++) {
+        Account* a = shard->buckets[i];
+        while (a) {
+            Account* next = a->next;
+            uint32_t b = (name_hash(a->name) / ACCOUNT_SHARDS) & (count - 1);
+            a->next = buckets[b];
+            buckets[b] = a;
+            a = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucket_count = count;
+}
+
+// Attach a session to an account. A named account is found or created in the name
+// table and outlives its sessions; an unnamed one belongs to a single connection.
+Account* account_open(const char* name, int named, double balance) {
+    uint32_t hash = name_hash(name);
+    AccountShard* shard = &shards[hash & (ACCOUNT_SHARDS - 1)];
+
+    pthread_mutex_lock(&shard->lock);
+    if (named && shard->bucket_count) {
+        Account* a = shard->buckets[(hash / ACCOUNT_SHARDS) & (shard->bucket_count - 1)];
+        for (; a; a = a->next) {
+            if (strcmp(a->name, name) == 0) {
+                a->sessions++;
+                pthread_mutex_unlock(&shard->lock);
+                return a;
+            }
+        }
+    }
+
+    Account* account = calloc(1, sizeof(Account));
+    if (!account) {
+        pthread_mutex_unlock(&shard->lock);
+        return NULL;
+    }
+    account->id = (++shard->next_seq * ACCOUNT_SHARDS) | (hash & (ACCOUNT_SHARDS - 1));
+    snprintf(account->name, sizeof(account->name), "%s", name);
+    account->named = named;
+    account->sessions = 1;
+    account->portfolio.wallet_balance = balance;
+
+    if (named) {
+        if (shard->named_count >= shard->bucket_count) shard_grow(shard);
+        uint32_t b = (hash / ACCOUNT_SHARDS) & (shard->bucket_count - 1);
+        account->next = shard->buckets[b];
+        shard->buckets[b] = account;
+        shard->named_count++;
+        account->last_seq = journal_account(account->id, name, balance);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    if (named) {
+        char msg[96];
+        sprintf(msg, "Account %.31s opened (id %u)", name, account->id);
+        log_message(msg);
+    }
+    return account;
+}
+
+// Recreate a named account under the ID it was journaled with (recovery, before any
+// session exists). Returns the account already holding the name, if any.
+Account* account_restore(const char* name, uint32_t id, double balance) {
+    uint32_t hash = name_hash(name);
+    AccountShard* shard = &shards[hash & (ACCOUNT_SHARDS - 1)];
+    if ((id & (ACCOUNT_SHARDS - 1)) != (hash & (ACCOUNT_SHARDS - 1))) return NULL;
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->bucket_count) {
+        Account* a = shard->buckets[(hash / ACCOUNT_SHARDS) & (shard->bucket_count - 1)];
+        for (; a; a = a->next) {
+            if (strcmp(a->name, name) == 0) {
+                pthread_mutex_unlock(&shard->lock);
+                return a;
+            }
+        }
+    }
+
+    Account* account = calloc(1, sizeof(Account));
+    if (!account) {
+        pthread_mutex_unlock(&shard->lock);
+        return NULL;
+    }
+    account->id = id;
+    snprintf(account->name, sizeof(account->name), "%s", name);
+    account->named = 1;
+    account->portfolio.wallet_balance = balance;
+    if (id / ACCOUNT_SHARDS > shard->next_seq) shard->next_seq = id / ACCOUNT_SHARDS;
+
+    if (shard->named_count >= shard->bucket_count) shard_grow(shard);
+    uint32_t b = (hash / ACCOUNT_SHARDS) & (shard->bucket_count - 1);
+    account->next = shard->buckets[b];
+    shard->buckets[b] = account;
+    shard->named_count++;
+    pthread_mutex_unlock(&shard->lock);
+    return account;
+}
+
+// Detach a session; an unnamed account goes away with it
+void account_close(Account* account) {
+    AccountShard* shard = account_shard(account);
+
+    pthread_mutex_lock(&shard->lock);
+    int release = --account->sessions == 0 && !account->named;
+    pthread_mutex_unlock(&shard->lock);
+
+    if (release) {
+        holders_release(account);
+        free(account->portfolio.holdings);
+        free(account);
+    }
+}
+
+void account_lock(Account* account) {
+    pthread_mutex_lock(&account_shard(account)->lock);
+}
+
+void account_unlock(Account* account) {
+    pthread_mutex_unlock(&account_shard(account)->lock);
+}
+
+// Names are printable identifiers that fit the session's username
+int account_name_valid(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= ACCOUNT_NAME_LEN) return 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '-' && name[i] != '.') return 0;
+    }
+    return 1;
+}
+
+// Helper to find a holding index by symbol ID (binary search); caller holds the account lock
+int find_holding(Portfolio* p, int stock_id) {
+    int lo = 0, hi = p->holding_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int id = p->holdings[mid].stock_id;
+        if (id == stock_id) return mid;
+        if (id < stock_id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+// Insert an empty holding for stock_id, keeping the array sorted; returns it
+Holding* add_holding(Portfolio* p, int stock_id) {
+    if (p->holding_count == p->holding_capacity) {
+        p->holding_capacity = p->holding_capacity ? p->holding_capacity * 2 : 8;
+        p->holdings = realloc(p->holdings, sizeof(Holding) * p->holding_capacity);
+    }
+
+    int pos = p->holding_count;
+    while (pos > 0 && p->holdings[pos - 1].stock_id > stock_id) pos--;
+    memmove(&p->holdings[pos + 1], &p->holdings[pos], sizeof(Holding) * (p->holding_count - pos));
+    p->holding_count++;
+
+    Holding* h = &p->holdings[pos];
+    h->stock_id = stock_id;
+    h->quantity = 0;
+    h->reserved = 0;
+    h->avg_buy_price = 0.0;
+    h->mark_price = 0.0;
+    h->holder_pos = -1;
+    return h;
+}
+
+// Book one execution: a buy pays price per share out of the wallet and averages into
+// the holding, a sell is paid out and gives up the shares (and their cost basis, added
+// to *cost_basis). Shared by live settlement and journal replay; caller holds the
+// account lock. Returns the realized P/L of a sell.
+double portfolio_fill(Portfolio* p, int stock_id, int side, int qty, double price, double* cost_basis) {
+    double amount = price * qty;
+    int holding_idx = find_holding(p, stock_id);
+
+    if (side == SIDE_BUY) {
+        Holding* h = holding_idx >= 0 ? &p->holdings[holding_idx] : add_holding(p, stock_id);
+        double total_cost = (h->quantity * h->avg_buy_price) + amount;
+        h->quantity += qty;
+        h->avg_buy_price = total_cost / h->quantity;
+        p->wallet_balance -= amount;
+        p->total_invested += amount;
+        return 0.0;
+    }
+
+    if (holding_idx < 0) return 0.0;
+    Holding* h = &p->holdings[holding_idx];
+    if (qty > h->quantity) qty = h->quantity;
+    amount = price * qty;
+    double basis = h->avg_buy_price * qty;
+
+    p->wallet_balance += amount;
+    p->total_invested -= basis; // Decrease invested amount by the cost basis of sold shares
+    h->quantity -= qty;
+    if (h->quantity == 0) {
+        memmove(&p->holdings[holding_idx], &p->holdings[holding_idx + 1],
+                sizeof(Holding) * (p->holding_count - holding_idx - 1));
+        p->holding_count--;
+    }
+    *cost_basis += basis;
+    return amount - basis;
+}
+
+// Visit every named account, each under its shard lock (snapshots)
+void accounts_each(void (*fn)(Account* account, void* ctx), void* ctx) {
+    for (int s = 0; s < ACCOUNT_SHARDS; s++) {
+        AccountShard* shard = &shards[s];
+        pthread_mutex_lock(&shard->lock);
+        for (int i = 0; i < shard->bucket_count; i++) {
+            for (Account* a = shard->buckets[i]; a; a = a->next) fn(a, ctx);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+// Free named accounts; unnamed ones were released with their sessions
+void accounts_destroy_all() {
+    for (int s = 0; s < ACCOUNT_SHARDS; s++) {
+        AccountShard* shard = &shards[s];
+        for (int i = 0; i < shard->bucket_count; i++) {
+            Account* a = shard->buckets[i];
+            while (a) {
+                Account* next = a->next;
+                free(a->portfolio.holdings);
+                free(a);
+                a = next;
+            }
+        }
+        free(shard->buckets);
+        shard->buckets = NULL;
+        shard->bucket_count = shard->named_count = 0;
+        pthread_mutex_destroy(&shard->lock);
+    }
+}
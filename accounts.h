@@ -0,0 +1,69 @@
+#ifndef ACCOUNTS_H
+#define ACCOUNTS_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+// Constants
+#define ACCOUNT_SHARDS 64               // Power of two; an account's shard is its ID's low bits
+#define ACCOUNT_NAME_LEN 32
+#define ACCOUNT_INITIAL_BUCKETS 16      // Per shard name table, doubled as it fills
+
+// Structures
+typedef struct {
+    int stock_id;
+    int quantity;
+    int reserved;               // Shares committed to resting sell orders
+    double avg_buy_price;
+    double mark_price;          // Price market_value last counted it at (holders.c)
+    int holder_pos;             // Slot in the symbol's holder list (-1 = not listed)
+} Holding;
+
+typedef struct {
+    double wallet_balance;
+    double reserved_cash;       // Set aside for resting buy orders (not in wallet_balance)
+    double total_invested;
+    double market_value;        // Holdings at their marks; unrealized P/L = this - total_invested
+    uint64_t mark_seq;          // Bumped whenever market_value is revalued (PORTFOLIO WATCH)
+    int holding_count;
+    int holding_capacity;
+    Holding* holdings;          // Sorted by stock_id
+} Portfolio;
+
+// Trading state, independent of any connection. Every field past the identity is
+// guarded by the shard lock: sessions on different reactors and matching threads
+// filling resting orders all go through it.
+typedef struct Account {
+    uint32_t id;
+    char name[ACCOUNT_NAME_LEN];
+    int named;                  // Opened by LOGIN: kept after its last session leaves
+    int sessions;               // Sessions attached
+    uint64_t last_seq;          // Newest journal record of this account (named only)
+    Portfolio portfolio;
+    struct Account* next;       // Shard name table chain
+} Account;
+
+// One lock per shard; padded so neighbouring shard locks do not share a cache line
+typedef struct {
+    pthread_mutex_t lock;
+    Account** buckets;          // Named accounts by name hash
+    int bucket_count;
+    int named_count;
+    uint32_t next_seq;
+} __attribute__((aligned(64))) AccountShard;
+
+// Function prototypes
+void accounts_init();
+Account* account_open(const char* name, int named, double balance);
+Account* account_restore(const char* name, uint32_t id, double balance);
+void account_close(Account* account);
+void account_lock(Account* account);
+void account_unlock(Account* account);
+int account_name_valid(const char* name);
+int find_holding(Portfolio* p, int stock_id);
+Holding* add_holding(Portfolio* p, int stock_id);
+double portfolio_fill(Portfolio* p, int stock_id, int side, int qty, double price, double* cost_basis);
+void accounts_each(void (*fn)(Account* account, void* ctx), void* ctx);
+void accounts_destroy_all();
+
+#endif
@@ -0,0 +1,120 @@
+#include "alertscan.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <math.h>
+#include <string.h>
+
+// Alert gate for one tick: every armed limit of a symbol is compared against the
+// move in a single pass over two columns. A buy limit is -threshold (alert when
+// change <= limit) and a sell limit is +threshold (alert when change >= limit);
+// disarmed and padding slots hold -INFINITY / +INFINITY, which never compare true.
+//
+// Bit i of buy_mask / sell_mask is set for each crossing, one uint64_t per 64 slots.
+// The same pass leaves in *buy_bound / *sell_bound the nearest limit that did NOT
+// fire, so the caller can skip the scan entirely until a move reaches it.
+
+typedef int (*ScanFn)(const double*, const double*, int, double, uint64_t*, uint64_t*, double*, double*);
+
+static int scan_scalar(const double* buy_limit, const double* sell_limit, int count, double change,
+                       uint64_t* buy_mask, uint64_t* sell_mask, double* buy_bound, double* sell_bound) {
+    double bmax = -INFINITY;
+    double smin = INFINITY;
+    uint64_t any = 0;
+
+    memset(buy_mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+    memset(sell_mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+    for (int i = 0; i < count; i++) {
+        uint64_t b = change <= buy_limit[i];
+        uint64_t s = change >= sell_limit[i];
+        buy_mask[i >> 6] |= b << (i & 63);
+        sell_mask[i >> 6] |= s << (i & 63);
+        if (!b && buy_limit[i] > bmax) bmax = buy_limit[i];
+        if (!s && sell_limit[i] < smin) smin = sell_limit[i];
+        any |= b | s;
+    }
+    *buy_bound = bmax;
+    *sell_bound = smin;
+    return any != 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static int scan_avx2(const double* buy_limit, const double* sell_limit, int count, double change,
+                     uint64_t* buy_mask, uint64_t* sell_mask, double* buy_bound, double* sell_bound) {
+    const __m256d c = _mm256_set1_pd(change);
+    const __m256d no_buy = _mm256_set1_pd(-INFINITY);
+    const __m256d no_sell = _mm256_set1_pd(INFINITY);
+    __m256d bmax = no_buy;
+    __m256d smin = no_sell;
+    uint64_t any = 0;
+    int i = 0;
+
+    memset(buy_mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+    memset(sell_mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+    for (; i + ALERT_SCAN_LANES <= count; i += ALERT_SCAN_LANES) {
+        __m256d bl = _mm256_load_pd(buy_limit + i);
+        __m256d sl = _mm256_load_pd(sell_limit + i);
+        __m256d bhit = _mm256_cmp_pd(c, bl, _CMP_LE_OQ);
+        __m256d shit = _mm256_cmp_pd(c, sl, _CMP_GE_OQ);
+
+        // Fired lanes drop out of the bounds: that side is disarmed once delivered
+        bmax = _mm256_max_pd(bmax, _mm256_blendv_pd(bl, no_buy, bhit));
+        smin = _mm256_min_pd(smin, _mm256_blendv_pd(sl, no_sell, shit));
+
+        uint64_t b = (uint64_t)_mm256_movemask_pd(bhit);
+        uint64_t s = (uint64_t)_mm256_movemask_pd(shit);
+        buy_mask[i >> 6] |= b << (i & 63);
+        sell_mask[i >> 6] |= s << (i & 63);
+        any |= b | s;
+    }
+
+    double lanes[ALERT_SCAN_LANES];
+    double bm = -INFINITY;
+    double sm = INFINITY;
+    _mm256_storeu_pd(lanes, bmax);
+    for (int k = 0; k < ALERT_SCAN_LANES; k++) if (lanes[k] > bm) bm = lanes[k];
+    _mm256_storeu_pd(lanes, smin);
+    for (int k = 0; k < ALERT_SCAN_LANES; k++) if (lanes[k] < sm) sm = lanes[k];
+
+    // Unpadded tail (callers normally pass whole vectors)
+    for (; i < count; i++) {
+        uint64_t b = change <= buy_limit[i];
+        uint64_t s = change >= sell_limit[i];
+        buy_mask[i >> 6] |= b << (i & 63);
+        sell_mask[i >> 6] |= s << (i & 63);
+        if (!b && buy_limit[i] > bm) bm = buy_limit[i];
+        if (!s && sell_limit[i] < sm) sm = sell_limit[i];
+        any |= b | s;
+    }
+    *buy_bound = bm;
+    *sell_bound = sm;
+    return any != 0;
+}
+#endif
+
+static ScanFn scan_impl;
+
+static ScanFn scan_select() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return scan_avx2;
+#endif
+    return scan_scalar;
+}
+
+// Scan count slots (columns aligned to ALERT_SCAN_ALIGN); returns 1 if any alert fired
+int alert_scan(const double* buy_limit, const double* sell_limit, int count, double change,
+               uint64_t* buy_mask, uint64_t* sell_mask, double* buy_bound, double* sell_bound) {
+    ScanFn fn = __atomic_load_n(&scan_impl, __ATOMIC_RELAXED);
+    if (!fn) {
+        fn = scan_select(); // Every thread picks the same kernel, so the race is benign
+        __atomic_store_n(&scan_impl, fn, __ATOMIC_RELAXED);
+    }
+    return fn(buy_limit, sell_limit, count, change, buy_mask, sell_mask, buy_bound, sell_bound);
+}
+
+// Name of the kernel this CPU runs, for the startup log
+const char* alert_scan_kernel() {
+    return scan_select() == scan_scalar ? "scalar" : "avx2";
+}
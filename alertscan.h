@@ -0,0 +1,15 @@
+#ifndef ALERTSCAN_H
+#define ALERTSCAN_H
+
+#include <stdint.h>
+
+// Constants
+#define ALERT_SCAN_LANES 4              // Doubles per AVX2 vector; columns are padded to a multiple
+#define ALERT_SCAN_ALIGN 32             // Column alignment (one AVX2 vector)
+
+// Function prototypes
+int alert_scan(const double* buy_limit, const double* sell_limit, int count, double change,
+               uint64_t* buy_mask, uint64_t* sell_mask, double* buy_bound, double* sell_bound);
+const char* alert_scan_kernel();
+
+#endif
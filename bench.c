@@ -0,0 +1,552 @@
+#include "bench.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Headless load generator: N binary-protocol sessions replay a scripted order mix
+// at a fixed aggregate rate (open loop) and record request->reply and tick->alert latency.
+
+static BenchConn conns[BENCH_MAX_CONNECTIONS];
+static int conn_count = BENCH_DEFAULT_CONNECTIONS;
+static int symbol_count = 0;
+static double threshold = BENCH_DEFAULT_THRESHOLD;
+static int mix[OP_COUNT];
+static int mix_total = 0;
+static unsigned int seed = 1;
+static const char* account_prefix = NULL;   // -a: trade on named (journaled) accounts
+static int idle_count = 0;                  // -i: extra sessions that only connect
+static Samples samples[OP_COUNT];
+static Samples alert_samples;
+static uint64_t sent = 0;
+static uint64_t answered = 0;
+static uint64_t outstanding = 0;
+static volatile sig_atomic_t bench_running = 1;
+
+static const char* op_names[OP_COUNT] = {"buy", "sell", "portfolio", "subscribe", "snapshot"};
+
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void signal_handler(int signum) {
+    (void)signum;
+    bench_running = 0;
+}
+
+static void samples_add(Samples* s, int64_t value) {
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 4096;
+        s->values = realloc(s->values, sizeof(int64_t) * s->capacity);
+    }
+    s->values[s->count++] = value;
+}
+
+static int compare_ns(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples, in microseconds
+static double percentile_us(const Samples* s, double p) {
+    if (s->count == 0) return 0.0;
+    size_t rank = (size_t)(p * s->count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > s->count) rank = s->count;
+    return s->values[rank - 1] / 1000.0;
+}
+
+// Parse "buy=40,sell=30,..." into operation weights
+static int parse_mix(const char* spec) {
+    char copy[256];
+    strncpy(copy, spec, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+
+    memset(mix, 0, sizeof(mix));
+    mix_total = 0;
+    for (char* item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        char* eq = strchr(item, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        int op;
+        for (op = 0; op < OP_COUNT; op++) {
+            if (strcasecmp(item, op_names[op]) == 0) break;
+        }
+        int weight = atoi(eq + 1);
+        if (op == OP_COUNT || weight < 0) return -1;
+        mix[op] = weight;
+        mix_total += weight;
+    }
+    return mix_total > 0 ? 0 : -1;
+}
+
+static int pick_op() {
+    int r = rand_r(&seed) % mix_total;
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (r < mix[op]) return op;
+        r -= mix[op];
+    }
+    return OP_BUY;
+}
+
+static void append_out(BenchConn* conn, const void* data, int len) {
+    if (conn->out_len + len > conn->out_capacity) {
+        int capacity = conn->out_capacity ? conn->out_capacity : BENCH_IO_CHUNK;
+        while (capacity < conn->out_len + len) capacity *= 2;
+        conn->outbuf = realloc(conn->outbuf, capacity);
+        conn->out_capacity = capacity;
+    }
+    memcpy(conn->outbuf + conn->out_len, data, len);
+    conn->out_len += len;
+}
+
+static void push_pending(BenchConn* conn, uint32_t request_id, int op, int64_t intended_ns) {
+    if (conn->pending_count == conn->pending_capacity) {
+        int capacity = conn->pending_capacity ? conn->pending_capacity * 2 : 256;
+        Pending* ring = malloc(sizeof(Pending) * capacity);
+        for (int i = 0; i < conn->pending_count; i++) {
+            ring[i] = conn->pending[(conn->pending_head + i) % conn->pending_capacity];
+        }
+        free(conn->pending);
+        conn->pending = ring;
+        conn->pending_head = 0;
+        conn->pending_capacity = capacity;
+    }
+    Pending* p = &conn->pending[(conn->pending_head + conn->pending_count) % conn->pending_capacity];
+    p->request_id = request_id;
+    p->op = op;
+    p->intended_ns = intended_ns;
+    conn->pending_count++;
+    outstanding++;
+}
+
+static void track_fill(BenchConn* conn, const FillMsg* fill) {
+    int s = (int)fill->symbol_id;
+    if (s < 0 || s >= symbol_count) return;
+    int before = conn->held[s];
+    conn->held[s] += fill->side == SIDE_BUY ? fill->quantity : -fill->quantity;
+
+    if (before == 0 && conn->held[s] > 0) {
+        conn->held_list[conn->held_count++] = s;
+    } else if (before > 0 && conn->held[s] <= 0) {
+        for (int i = 0; i < conn->held_count; i++) {
+            if (conn->held_list[i] != s) continue;
+            conn->held_list[i] = conn->held_list[--conn->held_count];
+            break;
+        }
+    }
+}
+
+// Blocking connect, negotiate binary framing and wait for HELLO
+int bench_connect(const char* ip, BenchConn* conn) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) return -1;
+
+    conn->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (conn->fd < 0) return -1;
+    if (connect(conn->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) return -1;
+    int one = 1;
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    const char* handshake = PROTO_HANDSHAKE "\n";
+    if (send(conn->fd, handshake, strlen(handshake), 0) < 0) return -1;
+
+    // The text welcome comes first and ends with the prompt; frames follow it
+    char buffer[BENCH_IO_CHUNK];
+    int len = 0, frames_at = -1;
+    for (;;) {
+        int bytes = recv(conn->fd, buffer + len, sizeof(buffer) - len - 1, 0);
+        if (bytes <= 0) {
+            buffer[len] = '\0';
+            fprintf(stderr, "Connection refused by server: %s\n", len ? buffer : "closed");
+            return -1;
+        }
+        len += bytes;
+        buffer[len] = '\0';
+        if (frames_at < 0) {
+            char* prompt = strstr(buffer, "\n\n> ");
+            if (!prompt) continue;
+            frames_at = prompt - buffer + 4;
+        }
+        int frame_len = proto_frame_length(buffer + frames_at, len - frames_at);
+        if (frame_len < 0) return -1;
+        if (frame_len > 0) break;
+    }
+
+    HelloMsg hello;
+    memcpy(&hello, buffer + frames_at, sizeof(hello));
+    if (hello.hdr.type != MSG_HELLO || hello.version != PROTO_VERSION) return -1;
+    symbol_count = hello.symbol_count;
+
+    // Anything after HELLO is kept for the event loop
+    int rest = len - frames_at - (int)hello.hdr.length;
+    conn->inbuf_capacity = BENCH_IO_CHUNK * 2;
+    conn->inbuf = malloc(conn->inbuf_capacity);
+    memcpy(conn->inbuf, buffer + frames_at + hello.hdr.length, rest);
+    conn->inbuf_len = rest;
+    conn->held = calloc(symbol_count, sizeof(int));
+    conn->held_list = malloc(sizeof(int) * symbol_count);
+    conn->next_request_id = 1;
+    conn->ready = 1;
+
+    // Named accounts are journaled, so their fills pay for durability; the OK is not timed
+    if (account_prefix) {
+        LoginMsg login;
+        memset(&login, 0, sizeof(login));
+        proto_header(&login.hdr, MSG_LOGIN, sizeof(login), 0);
+        snprintf(login.name, sizeof(login.name), "%s%d", account_prefix, (int)(conn - conns) + 1);
+        append_out(conn, &login, sizeof(login));
+    }
+
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL, 0) | O_NONBLOCK);
+    return 0;
+}
+
+// Open idle text sessions (each waits for the welcome, so the server has accepted it)
+// and report the connect cost; returns their descriptors
+static int* open_idle(const char* ip, int count) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    inet_pton(AF_INET, ip, &addr.sin_addr);
+
+    int* fds = malloc(sizeof(int) * count);
+    int64_t start = monotonic_ns();
+    int opened = 0;
+    for (; opened < count; opened++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            perror("Idle connection");
+            if (fd >= 0) close(fd);
+            break;
+        }
+        char buffer[BENCH_IO_CHUNK];
+        int len = 0;
+        for (;;) {
+            int bytes = recv(fd, buffer + len, sizeof(buffer) - len - 1, 0);
+            if (bytes <= 0) break;
+            len += bytes;
+            buffer[len] = '\0';
+            if (strstr(buffer, "\n\n> ") || strstr(buffer, "ERROR")) break;
+        }
+        fds[opened] = fd;
+        if (strstr(buffer, "ERROR")) {
+            fprintf(stderr, "Idle connection %d refused: server full\n", opened + 1);
+            close(fd);
+            break;
+        }
+    }
+    double seconds = (monotonic_ns() - start) / 1e9;
+    printf("Opened %d idle session(s) in %.2f s (%.1f us each, welcome included)\n",
+           opened, seconds, opened ? seconds * 1e6 / opened : 0.0);
+    for (int i = opened; i < count; i++) fds[i] = -1;
+    return fds;
+}
+
+// Encode one scripted request into the connection's output buffer
+void bench_send(BenchConn* conn, int op, int64_t intended_ns) {
+    uint32_t request_id = conn->next_request_id++;
+    int symbol = rand_r(&seed) % symbol_count;
+
+    // Sell something actually held; with nothing to sell, buy instead
+    if (op == OP_SELL && conn->held_count == 0) op = OP_BUY;
+
+    if (op == OP_BUY || op == OP_SELL) {
+        OrderMsg order;
+        memset(&order, 0, sizeof(order));
+        proto_header(&order.hdr, MSG_ORDER, sizeof(order), request_id);
+        order.side = op == OP_BUY ? SIDE_BUY : SIDE_SELL;
+        order.symbol_id = op == OP_BUY ? symbol : conn->held_list[rand_r(&seed) % conn->held_count];
+        order.quantity = 1;
+        append_out(conn, &order, sizeof(order));
+    } else if (op == OP_SUBSCRIBE) {
+        SubscribeMsg sub;
+        memset(&sub, 0, sizeof(sub));
+        proto_header(&sub.hdr, MSG_SUBSCRIBE, sizeof(sub), request_id);
+        sub.symbol_id = symbol;
+        sub.threshold = threshold;
+        append_out(conn, &sub, sizeof(sub));
+    } else {
+        FrameHeader req;
+        proto_header(&req, op == OP_SNAPSHOT ? MSG_SNAPSHOT_REQ : MSG_PORTFOLIO_REQ, sizeof(req), request_id);
+        append_out(conn, &req, sizeof(req));
+    }
+    push_pending(conn, request_id, op, intended_ns);
+    sent++;
+}
+
+static int flush_out(BenchConn* conn) {
+    int offset = 0;
+    while (offset < conn->out_len) {
+        ssize_t bytes = send(conn->fd, conn->outbuf + offset, conn->out_len - offset, MSG_NOSIGNAL);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        offset += bytes;
+    }
+    memmove(conn->outbuf, conn->outbuf + offset, conn->out_len - offset);
+    conn->out_len -= offset;
+    return 0;
+}
+
+static void handle_reply(BenchConn* conn, const char* data, int len) {
+    FrameHeader hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+
+    if (hdr.type == MSG_ALERT && len >= (int)sizeof(AlertMsg)) {
+        AlertMsg alert;
+        memcpy(&alert, data, sizeof(alert));
+        // Alerts answering a SUBSCRIBE carry an old tick time; only tick-driven ones are timed
+        if (alert.hdr.request_id == 0) samples_add(&alert_samples, realtime_ns() - alert.tick_ns);
+        return;
+    }
+    if (hdr.request_id == 0 || conn->pending_count == 0) return;
+
+    Pending* p = &conn->pending[conn->pending_head];
+    if (p->request_id != hdr.request_id) {
+        fprintf(stderr, "Reply out of order: expected %u, got %u\n", p->request_id, hdr.request_id);
+    }
+    Samples* s = &samples[p->op];
+    samples_add(s, monotonic_ns() - p->intended_ns);
+    if (hdr.type == MSG_ERROR) s->errors++;
+    if (hdr.type == MSG_FILL && len >= (int)sizeof(FillMsg)) {
+        FillMsg fill;
+        memcpy(&fill, data, sizeof(fill));
+        track_fill(conn, &fill);
+    }
+
+    conn->pending_head = (conn->pending_head + 1) % conn->pending_capacity;
+    conn->pending_count--;
+    outstanding--;
+    answered++;
+}
+
+// Read whatever is available and process complete frames; returns -1 when the session is gone
+int bench_read(BenchConn* conn) {
+    for (;;) {
+        if (conn->inbuf_capacity - conn->inbuf_len < BENCH_IO_CHUNK) {
+            conn->inbuf_capacity *= 2;
+            conn->inbuf = realloc(conn->inbuf, conn->inbuf_capacity);
+        }
+        int bytes = recv(conn->fd, conn->inbuf + conn->inbuf_len, conn->inbuf_capacity - conn->inbuf_len, 0);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        if (bytes == 0) return -1;
+        conn->inbuf_len += bytes;
+    }
+
+    int offset = 0;
+    for (;;) {
+        int frame_len = proto_frame_length(conn->inbuf + offset, conn->inbuf_len - offset);
+        if (frame_len < 0) return -1;
+        if (frame_len == 0) break;
+        handle_reply(conn, conn->inbuf + offset, frame_len);
+        offset += frame_len;
+    }
+    memmove(conn->inbuf, conn->inbuf + offset, conn->inbuf_len - offset);
+    conn->inbuf_len -= offset;
+    return 0;
+}
+
+static void report_row(FILE* out, FILE* csv, const char* name, Samples* s, double elapsed) {
+    qsort(s->values, s->count, sizeof(int64_t), compare_ns);
+    double max = s->count ? s->values[s->count - 1] / 1000.0 : 0.0;
+    double rate = elapsed > 0 ? s->count / elapsed : 0.0;
+
+    fprintf(out, "%-10s %10zu %8lu %10.1f %10.1f %10.1f %10.1f %12.1f\n",
+            name, s->count, (unsigned long)s->errors,
+            percentile_us(s, 0.50), percentile_us(s, 0.99), percentile_us(s, 0.999), max, rate);
+    if (csv) {
+        fprintf(csv, "%s,%zu,%lu,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                name, s->count, (unsigned long)s->errors,
+                percentile_us(s, 0.50), percentile_us(s, 0.99), percentile_us(s, 0.999), max, rate);
+    }
+}
+
+// Latency table (microseconds) as text, and as CSV when csv is set
+void bench_report(FILE* out, FILE* csv, double elapsed) {
+    Samples all;
+    memset(&all, 0, sizeof(all));
+    for (int op = 0; op < OP_COUNT; op++) {
+        for (size_t i = 0; i < samples[op].count; i++) samples_add(&all, samples[op].values[i]);
+        all.errors += samples[op].errors;
+    }
+
+    fprintf(out, "\nSent %lu requests, %lu answered in %.2f s (%.1f req/s), %lu unanswered\n\n",
+            (unsigned long)sent, (unsigned long)answered, elapsed,
+            elapsed > 0 ? answered / elapsed : 0.0, (unsigned long)outstanding);
+    fprintf(out, "%-10s %10s %8s %10s %10s %10s %10s %12s\n",
+            "metric", "count", "errors", "p50(us)", "p99(us)", "p99.9(us)", "max(us)", "per second");
+    if (csv) fprintf(csv, "metric,count,errors,p50_us,p99_us,p999_us,max_us,per_second\n");
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        report_row(out, csv, op_names[op], &samples[op], elapsed);
+    }
+    report_row(out, csv, "all", &all, elapsed);
+    report_row(out, csv, "alert", &alert_samples, elapsed);
+    free(all.values);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-s server_ip] [-c connections] [-r requests_per_sec] [-d seconds]\n"
+            "          [-m mix] [-t threshold] [-S seed] [-o results.csv] [-a account_prefix]\n"
+            "  mix defaults to %s\n"
+            "          [-i idle_sessions]\n"
+            "  -a: log connection N in to account <prefix>N, so its trades are journaled\n"
+            "  -i: also hold this many idle sessions open for the whole run\n",
+            prog, BENCH_DEFAULT_MIX);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_ip = SERVER_IP;
+    const char* csv_path = NULL;
+    double rate = BENCH_DEFAULT_RATE;
+    double duration = BENCH_DEFAULT_DURATION;
+    int opt;
+
+    parse_mix(BENCH_DEFAULT_MIX);
+    while ((opt = getopt(argc, argv, "s:c:r:d:m:t:S:o:a:i:h")) != -1) {
+        switch (opt) {
+        case 's': server_ip = optarg; break;
+        case 'c': conn_count = atoi(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 't': threshold = atof(optarg); break;
+        case 'S': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'o': csv_path = optarg; break;
+        case 'a': account_prefix = optarg; break;
+        case 'i': idle_count = atoi(optarg); break;
+        case 'm':
+            if (parse_mix(optarg) < 0) {
+                fprintf(stderr, "Invalid mix: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (conn_count < 1 || conn_count > BENCH_MAX_CONNECTIONS || rate <= 0 || duration <= 0 || idle_count < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    int* idle = idle_count ? open_idle(server_ip, idle_count) : NULL;
+    int epoll_fd = epoll_create1(0);
+    for (int i = 0; i < conn_count; i++) {
+        if (bench_connect(server_ip, &conns[i]) < 0) {
+            fprintf(stderr, "Connection %d to %s:%d failed\n", i + 1, server_ip, PORT);
+            return EXIT_FAILURE;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &conns[i];
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+    printf("Connected %d session(s), %d symbols; %.0f req/s for %.1f s\n",
+           conn_count, symbol_count, rate, duration);
+
+    // Open loop: request i is due at start + i * interval whether or not replies kept up
+    int64_t interval = (int64_t)(1e9 / rate);
+    int64_t start = monotonic_ns();
+    int64_t end = start + (int64_t)(duration * 1e9);
+    int64_t drain_end = end + BENCH_DRAIN_SECONDS * 1000000000LL;
+    int64_t next_due = start;
+    int next_conn = 0;
+    struct epoll_event events[64];
+
+    while (bench_running) {
+        int64_t now = monotonic_ns();
+        if (now < end) {
+            while (next_due <= now) {
+                BenchConn* conn = &conns[next_conn];
+                next_conn = (next_conn + 1) % conn_count;
+                if (conn->ready) bench_send(conn, pick_op(), next_due);
+                next_due += interval;
+            }
+        } else if (outstanding == 0 || now >= drain_end) {
+            break;
+        }
+
+        for (int i = 0; i < conn_count; i++) {
+            if (conns[i].ready && conns[i].out_len > 0 && flush_out(&conns[i]) < 0) conns[i].ready = 0;
+        }
+
+        int timeout = now < end ? (int)((next_due - now) / 1000000) : 10;
+        int n = epoll_wait(epoll_fd, events, 64, timeout);
+        for (int i = 0; i < n; i++) {
+            BenchConn* conn = events[i].data.ptr;
+            if (conn->ready && bench_read(conn) < 0) {
+                fprintf(stderr, "Session closed by server\n");
+                conn->ready = 0;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+            }
+        }
+    }
+
+    double elapsed = (monotonic_ns() - start) / 1e9;
+    if (elapsed > duration) elapsed = duration; // Throughput over the load window
+    FILE* csv = NULL;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (!csv) perror("CSV output");
+    }
+    bench_report(stdout, csv, elapsed);
+    if (csv) fclose(csv);
+
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].fd >= 0) close(conns[i].fd);
+        free(conns[i].inbuf);
+        free(conns[i].outbuf);
+        free(conns[i].pending);
+        free(conns[i].held);
+        free(conns[i].held_list);
+    }
+    for (int i = 0; i < idle_count; i++) {
+        if (idle[i] >= 0) close(idle[i]);
+    }
+    free(idle);
+    close(epoll_fd);
+    return EXIT_SUCCESS;
+}
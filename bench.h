@@ -0,0 +1,72 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Constants
+#define SERVER_IP "127.0.0.1"
+#define PORT 8888
+#define BENCH_MAX_CONNECTIONS 1024
+#define BENCH_DEFAULT_CONNECTIONS 4
+#define BENCH_DEFAULT_RATE 1000         // Requests per second across all connections
+#define BENCH_DEFAULT_DURATION 10       // Seconds
+#define BENCH_DEFAULT_THRESHOLD 0.5     // SUBSCRIBE threshold (percent)
+#define BENCH_DEFAULT_MIX "buy=40,sell=30,portfolio=20,subscribe=10"
+#define BENCH_DRAIN_SECONDS 2           // Wait for outstanding replies after the run
+#define BENCH_IO_CHUNK 65536
+
+// Scripted operations
+enum {
+    OP_BUY,
+    OP_SELL,
+    OP_PORTFOLIO,
+    OP_SUBSCRIBE,
+    OP_SNAPSHOT,
+    OP_COUNT
+};
+
+// Structures
+
+// Latency samples of one kind (nanoseconds)
+typedef struct {
+    int64_t* values;
+    size_t count;
+    size_t capacity;
+    uint64_t errors;            // ERROR replies (still timed)
+} Samples;
+
+// Request awaiting its reply; the server answers each session in order
+typedef struct {
+    uint32_t request_id;
+    int op;
+    int64_t intended_ns;        // Scheduled send time, so queueing delay is not hidden
+} Pending;
+
+typedef struct {
+    int fd;
+    int ready;                  // HELLO received
+    char* inbuf;
+    int inbuf_len;
+    int inbuf_capacity;
+    char* outbuf;
+    int out_len;
+    int out_capacity;
+    Pending* pending;           // FIFO ring of in-flight requests
+    int pending_head;
+    int pending_count;
+    int pending_capacity;
+    uint32_t next_request_id;
+    int* held;                  // Shares held per symbol, tracked from fills
+    int* held_list;             // Symbols with held[s] > 0, for picking SELL targets
+    int held_count;
+} BenchConn;
+
+// Function Prototypes
+int bench_connect(const char* ip, BenchConn* conn);
+void bench_send(BenchConn* conn, int op, int64_t intended_ns);
+int bench_read(BenchConn* conn);
+void bench_report(FILE* out, FILE* csv, double elapsed);
+
+#endif
@@ -0,0 +1,519 @@
+#include "server.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Binary protocol handlers: decode fixed-layout frames, reuse the trade logic,
+// and answer with frames queued on the session's output queue.
+
+static void reply_error(ClientInfo* client, uint32_t request_id, int code, int symbol_id, const char* text) {
+    ErrorMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_ERROR, sizeof(frame), request_id);
+    frame.code = code;
+    frame.symbol_id = symbol_id < 0 ? UINT32_MAX : (uint32_t)symbol_id;
+    strncpy(frame.text, text, sizeof(frame.text) - 1);
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+static void reply_empty(ClientInfo* client, uint32_t request_id, int type) {
+    FrameHeader frame;
+    proto_header(&frame, type, sizeof(frame), request_id);
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+static const char* error_text(int code) {
+    switch (code) {
+    case ERR_INVALID_QUANTITY: return "Invalid quantity";
+    case ERR_UNKNOWN_SYMBOL: return "Unknown symbol";
+    case ERR_INSUFFICIENT_FUNDS: return "Insufficient funds";
+    case ERR_NOT_OWNED: return "Symbol not owned";
+    case ERR_INSUFFICIENT_SHARES: return "Insufficient shares";
+    case ERR_BAD_THRESHOLD: return "Threshold must be positive";
+    case ERR_BAD_PRICE: return "Invalid limit price";
+    case ERR_UNKNOWN_ORDER: return "No such open order";
+    case ERR_BOOK_FULL: return "Order book full";
+    case ERR_BAD_ACCOUNT: return "Invalid account name";
+    case ERR_ORDERS_OPEN: return "Cancel open orders first";
+    case ERR_BATCH_ABORTED: return "Batch aborted";
+    default: return "Malformed request";
+    }
+}
+
+// Symbol IDs on the wire are unsigned; anything not listed maps to -1
+static int wire_symbol(uint32_t symbol_id) {
+    return symbol_id < (uint32_t)market_symbol_count() ? (int)symbol_id : -1;
+}
+
+// Reply to a trade with a FILL or an ERROR frame
+static void reply_trade(ClientInfo* client, uint32_t request_id, const TradeResult* r) {
+    if (r->error != ERR_NONE) {
+        reply_error(client, request_id, r->error, r->stock_id, error_text(r->error));
+        return;
+    }
+
+    FillMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_FILL, sizeof(frame), request_id);
+    frame.symbol_id = r->stock_id;
+    frame.side = r->side;
+    frame.quantity = r->quantity;
+    frame.price = r->price;
+    frame.amount = r->amount;
+    frame.realized_pl = r->realized_pl;
+    frame.balance = r->balance;
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+static void handle_order(ClientInfo* client, const OrderMsg* order) {
+    TradeResult result;
+    int stock_idx = wire_symbol(order->symbol_id);
+
+    if (order->side == SIDE_BUY) {
+        execute_buy(client, stock_idx, order->quantity, &result);
+    } else if (order->side == SIDE_SELL) {
+        execute_sell(client, stock_idx, order->quantity, &result);
+    } else {
+        reply_error(client, order->hdr.request_id, ERR_BAD_REQUEST, stock_idx, "Unknown side");
+        return;
+    }
+    reply_trade(client, order->hdr.request_id, &result);
+}
+
+static void handle_limit_order(ClientInfo* client, const LimitOrderMsg* order) {
+    TradeResult r;
+    execute_limit(client, wire_symbol(order->symbol_id), order->side, order->quantity, order->price, &r);
+    if (r.error != ERR_NONE) {
+        reply_error(client, order->hdr.request_id, r.error, r.stock_id, error_text(r.error));
+        return;
+    }
+
+    OrderAckMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_ORDER_ACK, sizeof(frame), order->hdr.request_id);
+    frame.order_id = r.order_id;
+    frame.symbol_id = r.stock_id;
+    frame.side = r.side;
+    frame.quantity = r.quantity;
+    frame.filled = r.filled;
+    frame.resting = r.resting;
+    frame.price = r.limit;
+    frame.avg_price = r.price;
+    frame.balance = r.balance;
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+static void handle_cancel_frame(ClientInfo* client, const CancelMsg* req) {
+    int remaining;
+    int error = execute_cancel(client, req->order_id, &remaining);
+    if (error != ERR_NONE) {
+        reply_error(client, req->hdr.request_id, error, -1, error_text(error));
+        return;
+    }
+
+    CanceledMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_CANCELED, sizeof(frame), req->hdr.request_id);
+    frame.order_id = req->order_id;
+    frame.quantity = remaining;
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+static void handle_batch_frame(ClientInfo* client, const BatchMsg* req, const char* data) {
+    int count = req->count;
+    BatchOrder* orders = malloc(sizeof(BatchOrder) * (count ? count : 1));
+    TradeResult* results = malloc(sizeof(TradeResult) * (count ? count : 1));
+    int len = sizeof(BatchReportMsg) + count * sizeof(BatchResultEntry);
+    Message* out = orders && results ? message_alloc(len) : NULL;
+    if (!out) {
+        free(orders);
+        free(results);
+        return;
+    }
+
+    const BatchOrderEntry* entries = (const BatchOrderEntry*)(data + sizeof(BatchMsg));
+    for (int i = 0; i < count; i++) {
+        BatchOrderEntry e;
+        memcpy(&e, &entries[i], sizeof(e));
+        orders[i] = (BatchOrder){ wire_symbol(e.symbol_id), e.side, e.quantity };
+    }
+    execute_batch(client, orders, count, req->atomic, results);
+
+    BatchReportMsg* frame = (BatchReportMsg*)out->data;
+    memset(frame, 0, sizeof(*frame));
+    proto_header(&frame->hdr, MSG_BATCH_REPORT, len, req->hdr.request_id);
+    frame->count = count;
+    frame->atomic = req->atomic ? 1 : 0;
+
+    BatchResultEntry* report = (BatchResultEntry*)(frame + 1);
+    for (int i = 0; i < count; i++) {
+        const TradeResult* r = &results[i];
+        BatchResultEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        memcpy(&entry.symbol_id, &entries[i].symbol_id, sizeof(entry.symbol_id));
+        entry.side = r->side;
+        entry.error = r->error;
+        entry.quantity = r->quantity;
+        entry.price = r->price;
+        entry.amount = r->amount;
+        entry.realized_pl = r->realized_pl;
+        memcpy(&report[i], &entry, sizeof(entry));
+        frame->filled += r->error == ERR_NONE;
+    }
+    account_lock(client->account);
+    frame->balance = client->account->portfolio.wallet_balance;
+    account_unlock(client->account);
+    free(orders);
+    free(results);
+    out->len = len;
+    session_queue(client, out);
+}
+
+static void send_orders(ClientInfo* client, uint32_t request_id) {
+    OrderEntry* entries;
+    int count = list_orders(client, &entries);
+    int len = sizeof(OrdersMsg) + count * sizeof(OrderEntry);
+    Message* out = message_alloc(len);
+    if (!out) {
+        free(entries);
+        return;
+    }
+
+    OrdersMsg* frame = (OrdersMsg*)out->data;
+    memset(frame, 0, sizeof(*frame));
+    proto_header(&frame->hdr, MSG_ORDERS, len, request_id);
+    frame->count = count;
+    memcpy(frame + 1, entries, count * sizeof(OrderEntry));
+    free(entries);
+    out->len = len;
+    session_queue(client, out);
+}
+
+static void handle_subscribe_frame(ClientInfo* client, const SubscribeMsg* req) {
+    Message* alert;
+    int error = execute_subscribe(client, wire_symbol(req->symbol_id), req->threshold, &alert);
+
+    if (error != ERR_NONE) {
+        reply_error(client, req->hdr.request_id, error, wire_symbol(req->symbol_id), error_text(error));
+        return;
+    }
+    reply_empty(client, req->hdr.request_id, MSG_OK);
+    if (alert) {
+        // Fresh, unshared frame: tie it to the request so it is not mistaken for a tick alert
+        FrameHeader* hdr = (FrameHeader*)alert->data;
+        hdr->request_id = req->hdr.request_id;
+        session_queue(client, alert);
+    }
+}
+
+static void send_portfolio(ClientInfo* client, uint32_t request_id) {
+    Portfolio* p = &client->account->portfolio;
+    account_lock(client->account);
+    int len = sizeof(PortfolioMsg) + p->holding_count * sizeof(HoldingEntry);
+    Message* out = message_alloc(len);
+    if (!out) {
+        account_unlock(client->account);
+        return;
+    }
+
+    PortfolioMsg* frame = (PortfolioMsg*)out->data;
+    memset(frame, 0, sizeof(*frame));
+    proto_header(&frame->hdr, MSG_PORTFOLIO, len, request_id);
+    frame->wallet_balance = p->wallet_balance;
+    frame->total_invested = p->total_invested;
+    frame->count = p->holding_count;
+
+    HoldingEntry* entries = (HoldingEntry*)(frame + 1);
+    for (int i = 0; i < p->holding_count; i++) {
+        entries[i].symbol_id = p->holdings[i].stock_id;
+        entries[i].quantity = p->holdings[i].quantity;
+        entries[i].avg_buy_price = p->holdings[i].avg_buy_price;
+        entries[i].price = p->holdings[i].mark_price;
+    }
+    account_unlock(client->account);
+    out->len = len;
+    session_queue(client, out);
+}
+
+// The quote table is shared by every request of a market version; only the header
+// (request_id, version, count) is built per request and queued in front of it. With
+// stream set, STREAM ALL updates are measured from the prices it carries.
+static void send_snapshot(ClientInfo* client, uint32_t request_id, int stream) {
+    Message* parts[MAX_MARKET_SHARDS];
+    unsigned long version;
+    int count;
+    int shards = snapshot_quotes(parts, &version, &count);
+    if (!shards) return;
+    for (int k = 0; stream && k < shards; k++) {
+        stream_seen(client, (const QuoteEntry*)parts[k]->data, parts[k]->len / sizeof(QuoteEntry));
+    }
+
+    SnapshotMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_SNAPSHOT, sizeof(frame) + count * sizeof(QuoteEntry), request_id);
+    frame.version = version;
+    frame.count = count;
+    Message* header = message_create((const char*)&frame, sizeof(frame));
+    if (!header) {
+        for (int k = 0; k < shards; k++) message_unref(parts[k]);
+        return;
+    }
+    session_queue(client, header);
+    for (int k = 0; k < shards; k++) {
+        if (parts[k]->len) {
+            session_queue(client, parts[k]);
+        } else {
+            message_unref(parts[k]);
+        }
+    }
+}
+
+// Start a quote stream: the reply is a SNAPSHOT of the streamed symbols, then QUOTE
+// frames follow as prices move
+static void handle_stream_frame(ClientInfo* client, const StreamMsg* req) {
+    int stock_idx = req->symbol_id == PROTO_ALL_SYMBOLS ? STREAM_ALL : wire_symbol(req->symbol_id);
+    int interval_ms = req->interval_ms == 0 ? STREAM_DEFAULT_MS
+                    : req->interval_ms > INT32_MAX ? INT32_MAX : (int)req->interval_ms;
+    int error = execute_stream(client, stock_idx, interval_ms, req->min_change);
+
+    if (error == ERR_BAD_THRESHOLD) {
+        reply_error(client, req->hdr.request_id, error, -1, "Minimum change must not be negative");
+        return;
+    }
+    if (error != ERR_NONE) {
+        reply_error(client, req->hdr.request_id, error, stock_idx < 0 ? -1 : stock_idx, error_text(error));
+        return;
+    }
+    if (stock_idx == STREAM_ALL) {
+        send_snapshot(client, req->hdr.request_id, 1);
+        return;
+    }
+
+    struct __attribute__((packed)) {
+        SnapshotMsg snapshot;
+        QuoteEntry quote;
+    } frame;
+    Stock s;
+    memset(&frame, 0, sizeof(frame));
+    market_read(stock_idx, &s);
+    proto_header(&frame.snapshot.hdr, MSG_SNAPSHOT, sizeof(frame), req->hdr.request_id);
+    frame.snapshot.version = market_version();
+    frame.snapshot.count = 1;
+    frame.quote.symbol_id = stock_idx;
+    frame.quote.volume = s.volume;
+    frame.quote.price = s.price;
+    frame.quote.change_percent = s.change_percent;
+    stream_seen(client, &frame.quote, 1);
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+static void send_symbols(ClientInfo* client, const SymbolsReqMsg* req) {
+    int total = market_symbol_count();
+    int first = req->first_id < (uint32_t)total ? (int)req->first_id : total;
+    int count = total - first;
+    if (count > PROTO_MAX_SYMBOLS_PER_LIST) count = PROTO_MAX_SYMBOLS_PER_LIST;
+
+    int len = sizeof(SymbolsMsg) + count * sizeof(SymbolEntry);
+    Message* out = message_alloc(len);
+    if (!out) return;
+
+    SymbolsMsg* frame = (SymbolsMsg*)out->data;
+    memset(frame, 0, sizeof(*frame));
+    proto_header(&frame->hdr, MSG_SYMBOLS, len, req->hdr.request_id);
+    frame->first_id = first;
+    frame->count = count;
+    frame->total = total;
+
+    SymbolEntry* entries = (SymbolEntry*)(frame + 1);
+    for (int i = 0; i < count; i++) {
+        const char* symbol = market_stock(first + i)->symbol;
+        memset(entries[i].symbol, 0, PROTO_SYMBOL_LEN);
+        memcpy(entries[i].symbol, symbol, strnlen(symbol, PROTO_SYMBOL_LEN - 1));
+    }
+    out->len = len;
+    session_queue(client, out);
+}
+
+static void send_session(ClientInfo* client, uint32_t request_id) {
+    SessionMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_SESSION, sizeof(frame), request_id);
+    frame.queued = client->outq.count;
+    frame.queued_bytes = client->outq.bytes;
+    frame.peak_bytes = client->outq.peak_bytes;
+    frame.conflated = client->outq.conflated;
+    frame.limit_bytes = OUTQ_LIMIT_BYTES;
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+// The STATS report as text after a frame header
+static void send_stats(ClientInfo* client, uint32_t request_id) {
+    size_t len = 0;
+    char* report = metrics_render(0, &len);
+    Message* out = report ? message_alloc(sizeof(FrameHeader) + len) : NULL;
+    if (!out) {
+        free(report);
+        reply_error(client, request_id, ERR_BAD_REQUEST, -1, "Statistics unavailable");
+        return;
+    }
+    proto_header((FrameHeader*)out->data, MSG_STATS, sizeof(FrameHeader) + len, request_id);
+    memcpy(out->data + sizeof(FrameHeader), report, len);
+    out->len = sizeof(FrameHeader) + len;
+    free(report);
+    session_queue(client, out);
+}
+
+// Switch a text session to binary framing and greet it
+void binary_handshake(ClientInfo* client) {
+    HelloMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_HELLO, sizeof(frame), 0);
+    frame.version = PROTO_VERSION;
+    frame.session_id = client->client_id;
+    frame.symbol_count = market_symbol_count();
+
+    __atomic_store_n(&client->binary, 1, __ATOMIC_RELAXED);
+    session_queue(client, message_create((const char*)&frame, sizeof(frame)));
+}
+
+// Frame dispatcher (binary counterpart of handle_command)
+void handle_frame(ClientInfo* client, const char* data, int len) {
+    FrameHeader hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+
+    switch (hdr.type) {
+    case MSG_ORDER:
+        if (len < (int)sizeof(OrderMsg)) break;
+        {
+            OrderMsg order;
+            memcpy(&order, data, sizeof(order));
+            handle_order(client, &order);
+        }
+        return;
+    case MSG_LIMIT:
+        if (len < (int)sizeof(LimitOrderMsg)) break;
+        {
+            LimitOrderMsg order;
+            memcpy(&order, data, sizeof(order));
+            handle_limit_order(client, &order);
+        }
+        return;
+    case MSG_CANCEL:
+        if (len < (int)sizeof(CancelMsg)) break;
+        {
+            CancelMsg req;
+            memcpy(&req, data, sizeof(req));
+            handle_cancel_frame(client, &req);
+        }
+        return;
+    case MSG_ORDER_BATCH:
+        if (len < (int)sizeof(BatchMsg)) break;
+        {
+            BatchMsg req;
+            memcpy(&req, data, sizeof(req));
+            if (req.count > PROTO_MAX_BATCH ||
+                len < (int)(sizeof(BatchMsg) + req.count * sizeof(BatchOrderEntry))) break;
+            handle_batch_frame(client, &req, data);
+        }
+        return;
+    case MSG_ORDERS_REQ:
+        send_orders(client, hdr.request_id);
+        return;
+    case MSG_LOGIN:
+        if (len < (int)sizeof(LoginMsg)) break;
+        {
+            LoginMsg req;
+            memcpy(&req, data, sizeof(req));
+            req.name[sizeof(req.name) - 1] = '\0';
+            int error = execute_login(client, req.name);
+            if (error != ERR_NONE) {
+                reply_error(client, req.hdr.request_id, error, -1, error_text(error));
+            } else {
+                reply_empty(client, req.hdr.request_id, MSG_OK);
+            }
+        }
+        return;
+    case MSG_SUBSCRIBE:
+        if (len < (int)sizeof(SubscribeMsg)) break;
+        {
+            SubscribeMsg req;
+            memcpy(&req, data, sizeof(req));
+            handle_subscribe_frame(client, &req);
+        }
+        return;
+    case MSG_PORTFOLIO_REQ:
+        send_portfolio(client, hdr.request_id);
+        return;
+    case MSG_WATCH:
+        if (len < (int)sizeof(WatchMsg)) break;
+        {
+            WatchMsg req;
+            memcpy(&req, data, sizeof(req));
+            int interval_ms = req.interval_ms > INT32_MAX ? INT32_MAX : (int)req.interval_ms;
+            execute_watch(client, interval_ms);
+            reply_empty(client, req.hdr.request_id, MSG_OK);
+        }
+        return;
+    case MSG_STREAM:
+        if (len < (int)sizeof(StreamMsg)) break;
+        {
+            StreamMsg req;
+            memcpy(&req, data, sizeof(req));
+            handle_stream_frame(client, &req);
+        }
+        return;
+    case MSG_UNSTREAM:
+        if (len < (int)sizeof(StreamMsg)) break;
+        {
+            StreamMsg req;
+            memcpy(&req, data, sizeof(req));
+            int stock_idx = req.symbol_id == PROTO_ALL_SYMBOLS ? STREAM_ALL : wire_symbol(req.symbol_id);
+            int error = execute_unstream(client, stock_idx);
+            if (error != ERR_NONE) {
+                reply_error(client, req.hdr.request_id, error, -1, error_text(error));
+            } else {
+                reply_empty(client, req.hdr.request_id, MSG_OK);
+            }
+        }
+        return;
+    case MSG_SNAPSHOT_REQ:
+        send_snapshot(client, hdr.request_id, 0);
+        return;
+    case MSG_SYMBOLS_REQ:
+        if (len < (int)sizeof(SymbolsReqMsg)) break;
+        {
+            SymbolsReqMsg req;
+            memcpy(&req, data, sizeof(req));
+            send_symbols(client, &req);
+        }
+        return;
+    case MSG_SESSION_REQ:
+        send_session(client, hdr.request_id);
+        return;
+    case MSG_STATS_REQ:
+        send_stats(client, hdr.request_id);
+        return;
+    case MSG_QUIT:
+        reply_empty(client, hdr.request_id, MSG_BYE);
+        client->active = 0;
+        return;
+    }
+    reply_error(client, hdr.request_id, ERR_BAD_REQUEST, -1, error_text(ERR_BAD_REQUEST));
+}
+
+// Dispatch the frame at the start of data; returns bytes consumed, 0 if it is incomplete
+int binary_frame(ClientInfo* client, const char* data, int available) {
+    int frame_len = proto_frame_length(data, available);
+    if (frame_len < 0) {
+        client->active = 0; // Framing is lost; nothing after this can be trusted
+        return -1;
+    }
+    if (frame_len > 0) {
+        int64_t start = metrics_now();
+        handle_frame(client, data, frame_len);
+        metrics_record(HIST_COMMAND, metrics_now() - start);
+        metrics_count(CTR_COMMANDS, 1);
+    }
+    return frame_len;
+}
@@ -0,0 +1,280 @@
+#include "book.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Price-time priority matching engine for one symbol. Not thread-safe: callers
+// serialize access per book. Nodes come from slab pools owned by the book and are
+// recycled through free lists, so the steady state allocates nothing.
+
+#define BOOK_ID_MASK ((1ULL << (2 * BOOK_INDEX_BITS)) - 1)
+#define BOOK_INDEX_MASK ((1U << BOOK_INDEX_BITS) - 1)
+#define BOOK_COMPACT_MIN 32             // Lingering empty levels tolerated before compaction
+
+// Both sides are kept ascending by key so the best level is always the last one
+static inline int64_t level_key(int side, int64_t price) {
+    return side == BOOK_BID ? price : -price;
+}
+
+static inline BookSide* book_side(OrderBook* book, int side) {
+    return side == BOOK_BID ? &book->bids : &book->asks;
+}
+
+static Order* order_alloc(OrderBook* book) {
+    Order* order = book->free_orders;
+    if (order) {
+        book->free_orders = order->next;
+        order->generation = (order->generation + 1) & BOOK_INDEX_MASK;
+        uint64_t index = order->id & BOOK_INDEX_MASK;
+        order->id = book->id_prefix | ((uint64_t)order->generation << BOOK_INDEX_BITS) | index;
+        return order;
+    }
+
+    if (book->order_total == BOOK_MAX_ORDERS) return NULL;
+    if ((book->order_total & (BOOK_POOL_CHUNK - 1)) == 0) {
+        Order** chunks = realloc(book->order_chunks, sizeof(Order*) * (book->order_chunk_count + 1));
+        if (!chunks) return NULL;
+        book->order_chunks = chunks;
+        Order* chunk = calloc(BOOK_POOL_CHUNK, sizeof(Order));
+        if (!chunk) return NULL;
+        book->order_chunks[book->order_chunk_count++] = chunk;
+    }
+
+    int index = book->order_total++;
+    order = &book->order_chunks[index >> BOOK_POOL_CHUNK_SHIFT][index & (BOOK_POOL_CHUNK - 1)];
+    order->generation = 0;
+    order->id = book->id_prefix | (uint64_t)index;
+    return order;
+}
+
+static void order_free(OrderBook* book, Order* order) {
+    order->level = NULL;
+    order->prev = NULL;
+    order->next = book->free_orders;
+    book->free_orders = order;
+}
+
+static PriceLevel* level_alloc(OrderBook* book, int64_t price) {
+    if (!book->free_levels) {
+        PriceLevel** chunks = realloc(book->level_chunks, sizeof(PriceLevel*) * (book->level_chunk_count + 1));
+        if (!chunks) return NULL;
+        book->level_chunks = chunks;
+        PriceLevel* chunk = calloc(BOOK_POOL_CHUNK, sizeof(PriceLevel));
+        if (!chunk) return NULL;
+        book->level_chunks[book->level_chunk_count++] = chunk;
+        for (int i = BOOK_POOL_CHUNK - 1; i >= 0; i--) {
+            chunk[i].next_free = book->free_levels;
+            book->free_levels = &chunk[i];
+        }
+    }
+
+    PriceLevel* level = book->free_levels;
+    book->free_levels = level->next_free;
+    memset(level, 0, sizeof(*level));
+    level->price = price;
+    return level;
+}
+
+static void level_free(OrderBook* book, PriceLevel* level) {
+    level->next_free = book->free_levels;
+    book->free_levels = level;
+}
+
+// Drop every lingering empty level in one pass
+static void side_compact(OrderBook* book, BookSide* side) {
+    int kept = 0;
+    for (int i = 0; i < side->count; i++) {
+        if (side->levels[i]->count == 0) {
+            level_free(book, side->levels[i]);
+        } else {
+            side->levels[kept++] = side->levels[i];
+        }
+    }
+    side->count = kept;
+    side->empty = 0;
+}
+
+// Level for price, inserted in key order if missing. Orders cluster near the top of
+// the book, so the best level is checked first and insertions move few pointers.
+static PriceLevel* side_level(OrderBook* book, BookSide* side, int side_id, int64_t price) {
+    int64_t key = level_key(side_id, price);
+    int pos = side->count;
+
+    if (pos > 0) {
+        int64_t top = level_key(side_id, side->levels[pos - 1]->price);
+        if (key == top) return side->levels[pos - 1];
+        if (key < top) {
+            int lo = 0, hi = pos - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (level_key(side_id, side->levels[mid]->price) < key) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (side->levels[lo]->price == price) return side->levels[lo];
+            pos = lo;
+        }
+    }
+
+    if (side->count == side->capacity) {
+        int capacity = side->capacity ? side->capacity * 2 : BOOK_SIDE_INITIAL_LEVELS;
+        PriceLevel** levels = realloc(side->levels, sizeof(PriceLevel*) * capacity);
+        if (!levels) return NULL;
+        side->levels = levels;
+        side->capacity = capacity;
+    }
+
+    PriceLevel* level = level_alloc(book, price);
+    if (!level) return NULL;
+    memmove(&side->levels[pos + 1], &side->levels[pos], sizeof(PriceLevel*) * (side->count - pos));
+    side->levels[pos] = level;
+    side->count++;
+    side->empty++;              // Counted as empty until its first order is linked
+    return level;
+}
+
+static void level_unlink(PriceLevel* level, Order* order) {
+    if (order->prev) {
+        order->prev->next = order->next;
+    } else {
+        level->head = order->next;
+    }
+    if (order->next) {
+        order->next->prev = order->prev;
+    } else {
+        level->tail = order->prev;
+    }
+    level->quantity -= order->quantity;
+    level->count--;
+}
+
+void book_init(OrderBook* book, uint64_t id_prefix) {
+    memset(book, 0, sizeof(*book));
+    book->id_prefix = id_prefix & ~BOOK_ID_MASK;
+}
+
+void book_destroy(OrderBook* book) {
+    for (int i = 0; i < book->order_chunk_count; i++) free(book->order_chunks[i]);
+    for (int i = 0; i < book->level_chunk_count; i++) free(book->level_chunks[i]);
+    free(book->order_chunks);
+    free(book->level_chunks);
+    free(book->bids.levels);
+    free(book->asks.levels);
+    memset(book, 0, sizeof(*book));
+}
+
+// Execute an incoming order of side against the opposite side while it crosses limit.
+// Fills go in price then time priority; returns the quantity filled.
+int book_match(OrderBook* book, int side, int64_t limit, int quantity, BookFillFn on_fill, void* ctx) {
+    int maker_side = side == BOOK_BID ? BOOK_ASK : BOOK_BID;
+    BookSide* s = book_side(book, maker_side);
+    int filled = 0;
+
+    while (quantity > 0 && s->count > 0) {
+        PriceLevel* level = s->levels[s->count - 1];
+        if (level->count == 0) {
+            s->count--;
+            s->empty--;
+            level_free(book, level);
+            continue;
+        }
+        if (side == BOOK_BID ? level->price > limit : level->price < limit) break;
+
+        while (quantity > 0 && level->head) {
+            Order* maker = level->head;
+            int qty = maker->quantity < quantity ? maker->quantity : quantity;
+
+            maker->quantity -= qty;
+            level->quantity -= qty;
+            quantity -= qty;
+            filled += qty;
+            if (on_fill) on_fill(ctx, maker, level->price, qty);
+
+            if (maker->quantity == 0) {
+                level_unlink(level, maker);
+                order_free(book, maker);
+                book->live--;
+            }
+        }
+
+        if (level->count == 0) {
+            s->count--;
+            level_free(book, level);
+        }
+    }
+    return filled;
+}
+
+// Rest an order at the back of its price level; NULL if the pools are exhausted
+Order* book_add(OrderBook* book, int side, int64_t price, int quantity, void* owner, int owner_id) {
+    BookSide* s = book_side(book, side);
+    PriceLevel* level = side_level(book, s, side, price);
+    if (!level) return NULL;
+
+    Order* order = order_alloc(book);
+    if (!order) return NULL;
+
+    order->price = price;
+    order->quantity = quantity;
+    order->side = side;
+    order->owner = owner;
+    order->owner_id = owner_id;
+    order->level = level;
+    order->next = NULL;
+    order->prev = level->tail;
+    if (level->tail) {
+        level->tail->next = order;
+    } else {
+        level->head = order;
+    }
+    level->tail = order;
+    if (level->count++ == 0) s->empty--;
+    level->quantity += quantity;
+    book->live++;
+    return order;
+}
+
+// Resting order with this ID, or NULL if it was filled, cancelled or never existed
+Order* book_find(OrderBook* book, uint64_t order_id) {
+    if ((order_id & ~BOOK_ID_MASK) != book->id_prefix) return NULL;
+    uint64_t index = order_id & BOOK_INDEX_MASK;
+    if (index >= (uint64_t)book->order_total) return NULL;
+
+    Order* order = &book->order_chunks[index >> BOOK_POOL_CHUNK_SHIFT][index & (BOOK_POOL_CHUNK - 1)];
+    if (!order->level || order->id != order_id) return NULL;
+    return order;
+}
+
+// Remove a resting order in O(1); returns its unfilled quantity, or -1 if unknown
+int book_cancel(OrderBook* book, uint64_t order_id) {
+    Order* order = book_find(book, order_id);
+    if (!order) return -1;
+
+    int remaining = order->quantity;
+    PriceLevel* level = order->level;
+    BookSide* s = book_side(book, order->side);
+    level_unlink(level, order);
+    order_free(book, order);
+    book->live--;
+
+    // An emptied level stays in place until it surfaces at the top or too many pile up
+    if (level->count == 0) {
+        if (s->levels[s->count - 1] == level) {
+            s->count--;
+            level_free(book, level);
+        } else if (++s->empty > BOOK_COMPACT_MIN && s->empty * 2 > s->count) {
+            side_compact(book, s);
+        }
+    }
+    return remaining;
+}
+
+// Best resting price on a side, 0 if the side is empty
+int64_t book_best(const OrderBook* book, int side) {
+    const BookSide* s = side == BOOK_BID ? &book->bids : &book->asks;
+    for (int i = s->count - 1; i >= 0; i--) {
+        if (s->levels[i]->count > 0) return s->levels[i]->price;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdint.h>
+
+// Constants
+#define PRICE_SCALE 100                 // Book prices are integer cents
+#define BOOK_POOL_CHUNK_SHIFT 12        // Order and level nodes come from 4096-node slabs
+#define BOOK_POOL_CHUNK (1 << BOOK_POOL_CHUNK_SHIFT)
+#define BOOK_INDEX_BITS 24              // Order ID: [generation:24][pool index:24]
+#define BOOK_MAX_ORDERS (1 << BOOK_INDEX_BITS)
+#define BOOK_SIDE_INITIAL_LEVELS 64
+
+// Book sides (same values as SIDE_BUY / SIDE_SELL on the wire)
+#define BOOK_BID 1
+#define BOOK_ASK 2
+
+// Structures
+
+// Resting order; lives in the book's pool and is linked into its level's FIFO
+typedef struct Order {
+    struct Order* next;         // Level FIFO (older -> newer); also the pool free list
+    struct Order* prev;
+    struct PriceLevel* level;   // NULL while the node is free
+    uint64_t id;
+    int64_t price;              // Cents
+    int32_t quantity;           // Remaining
+    uint32_t generation;        // Bumped on reuse so stale IDs never match
+    uint8_t side;
+    int owner_id;               // Opaque to the engine (session that placed it)
+    void* owner;
+} Order;
+
+// All resting orders at one price, in time priority
+typedef struct PriceLevel {
+    int64_t price;
+    int64_t quantity;           // Sum of remaining quantity
+    int count;
+    Order* head;
+    Order* tail;
+    struct PriceLevel* next_free;
+} PriceLevel;
+
+// Levels of one side sorted so the best price is last; emptied levels linger until
+// they reach the top or are compacted, which keeps cancel O(1)
+typedef struct {
+    PriceLevel** levels;
+    int count;
+    int capacity;
+    int empty;                  // Levels with no orders still in the array
+} BookSide;
+
+typedef struct {
+    BookSide bids;              // Ascending price
+    BookSide asks;              // Descending price
+    Order** order_chunks;       // Pool slabs; an order's index is stable for its lifetime
+    int order_chunk_count;
+    int order_total;            // Nodes ever created
+    Order* free_orders;
+    PriceLevel* free_levels;
+    PriceLevel** level_chunks;
+    int level_chunk_count;
+    uint64_t id_prefix;         // OR-ed into every order ID (e.g. the symbol)
+    int live;                   // Resting orders
+} OrderBook;
+
+// Called for every execution, before a fully filled maker leaves the book
+typedef void (*BookFillFn)(void* ctx, const Order* maker, int64_t price, int quantity);
+
+// Function prototypes
+void book_init(OrderBook* book, uint64_t id_prefix);
+void book_destroy(OrderBook* book);
+int book_match(OrderBook* book, int side, int64_t limit, int quantity, BookFillFn on_fill, void* ctx);
+Order* book_add(OrderBook* book, int side, int64_t price, int quantity, void* owner, int owner_id);
+Order* book_find(OrderBook* book, uint64_t order_id);
+int book_cancel(OrderBook* book, uint64_t order_id);
+int64_t book_best(const OrderBook* book, int side);
+
+static inline int64_t book_price_ticks(double price) {
+    return (int64_t)(price * PRICE_SCALE + 0.5);
+}
+
+static inline double book_price_value(int64_t ticks) {
+    return (double)ticks / PRICE_SCALE;
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include "book.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+
+// Matching engine microbenchmark: drives one OrderBook on one core with a mix of
+// passive and marketable limit orders, cancels and market orders around a drifting
+// mid price, and reports order operations per second and per-operation latency.
+
+#define BENCH_DEFAULT_OPS 10000000
+#define BENCH_DEFAULT_DEPTH 20          // Passive orders rest up to this many ticks from mid
+#define BENCH_MID_PRICE 10000           // Ticks ($100.00)
+#define BENCH_SAMPLE_EVERY 64           // One operation in this many is timed on its own
+#define BENCH_WARM_ORDERS 10000
+
+enum { OP_ADD, OP_CANCEL, OP_MARKET, OP_TYPES };
+
+static const char* op_names[OP_TYPES] = {"add", "cancel", "market"};
+
+static uint64_t rng_state = 1;
+static uint64_t fills = 0;
+static uint64_t filled_qty = 0;
+
+// xorshift64*: cheap enough not to show up next to the book
+static uint64_t rng_next() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void count_fill(void* ctx, const Order* maker, int64_t price, int quantity) {
+    (void)ctx;
+    (void)maker;
+    (void)price;
+    fills++;
+    filled_qty += quantity;
+}
+
+static int compare_ns(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : (x > y);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-n operations] [-d depth_ticks] [-S seed]\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    long ops = BENCH_DEFAULT_OPS;
+    int depth = BENCH_DEFAULT_DEPTH;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:S:h")) != -1) {
+        switch (opt) {
+        case 'n': ops = atol(optarg); break;
+        case 'd': depth = atoi(optarg); break;
+        case 'S': rng_state = strtoull(optarg, NULL, 10) | 1; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (ops <= 0 || depth <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    OrderBook book;
+    book_init(&book, 0);
+
+    // IDs of orders that rested; cancels pick from here (some will have traded since)
+    int live_capacity = BENCH_WARM_ORDERS * 4;
+    uint64_t* live = malloc(sizeof(uint64_t) * live_capacity);
+    int live_count = 0;
+
+    long samples_len = ops / BENCH_SAMPLE_EVERY + 1;
+    int64_t* samples[OP_TYPES];
+    long sample_count[OP_TYPES] = {0};
+    long op_count[OP_TYPES] = {0};
+    for (int t = 0; t < OP_TYPES; t++) samples[t] = malloc(sizeof(int64_t) * samples_len);
+
+    int64_t mid = BENCH_MID_PRICE;
+    long cancelled = 0;
+
+    // Warm the pools and give the book some depth before timing
+    for (int i = 0; i < BENCH_WARM_ORDERS; i++) {
+        int side = (rng_next() & 1) ? BOOK_BID : BOOK_ASK;
+        int64_t offset = 1 + (int64_t)(rng_next() % depth);
+        Order* o = book_add(&book, side, side == BOOK_BID ? mid - offset : mid + offset,
+                            1 + (int)(rng_next() % 100), NULL, 0);
+        if (o) live[live_count++] = o->id;
+    }
+
+    int64_t start = monotonic_ns();
+    for (long i = 0; i < ops; i++) {
+        uint64_t r = rng_next();
+        int roll = (int)(r % 100);
+        int type = roll < 55 ? OP_ADD : roll < 90 ? OP_CANCEL : OP_MARKET;
+        int side = (r >> 8) & 1 ? BOOK_BID : BOOK_ASK;
+        int qty = 1 + (int)((r >> 16) % 100);
+        int timed = (i % BENCH_SAMPLE_EVERY) == 0;
+        int64_t t0 = timed ? monotonic_ns() : 0;
+
+        if ((i & 1023) == 0) mid += (int64_t)((r >> 40) % 3) - 1; // Slow drift
+
+        if (type == OP_ADD) {
+            // Mostly passive; one in ten crosses the spread and trades first
+            int64_t offset = 1 + (int64_t)((r >> 24) % depth);
+            if (((r >> 32) % 10) == 0) offset = -offset / 4;
+            int64_t price = side == BOOK_BID ? mid - offset : mid + offset;
+            int filled = book_match(&book, side, price, qty, count_fill, NULL);
+            if (filled < qty) {
+                Order* o = book_add(&book, side, price, qty - filled, NULL, 0);
+                if (o) {
+                    if (live_count == live_capacity) {
+                        live_capacity *= 2;
+                        live = realloc(live, sizeof(uint64_t) * live_capacity);
+                    }
+                    live[live_count++] = o->id;
+                }
+            }
+        } else if (type == OP_CANCEL && live_count > 0) {
+            int k = (int)((r >> 24) % live_count);
+            if (book_cancel(&book, live[k]) >= 0) cancelled++;
+            live[k] = live[--live_count];
+        } else {
+            book_match(&book, side, side == BOOK_BID ? INT64_MAX : 0, qty, count_fill, NULL);
+        }
+
+        op_count[type]++;
+        if (timed) samples[type][sample_count[type]++] = monotonic_ns() - t0;
+    }
+    int64_t elapsed = monotonic_ns() - start;
+
+    double seconds = elapsed / 1e9;
+    printf("Order book benchmark: %ld operations in %.3f s = %.2f M ops/s (%.1f ns/op)\n",
+           ops, seconds, ops / seconds / 1e6, (double)elapsed / ops);
+    printf("  %ld fills (%llu shares), %ld cancels hit, %d orders resting, %d bid / %d ask levels\n",
+           (long)fills, (unsigned long long)filled_qty, cancelled, book.live, book.bids.count, book.asks.count);
+    printf("  Sampled latency (1 in %d, timer overhead included):\n", BENCH_SAMPLE_EVERY);
+    printf("  %-8s %10s %8s %8s %8s %8s\n", "op", "count", "p50", "p99", "p99.9", "max");
+    for (int t = 0; t < OP_TYPES; t++) {
+        long n = sample_count[t];
+        if (n == 0) continue;
+        qsort(samples[t], n, sizeof(int64_t), compare_ns);
+        printf("  %-8s %10ld %6lldns %6lldns %6lldns %6lldns\n", op_names[t], op_count[t],
+               (long long)samples[t][n / 2], (long long)samples[t][n * 99 / 100],
+               (long long)samples[t][n * 999 / 1000], (long long)samples[t][n - 1]);
+        free(samples[t]);
+    }
+
+    free(live);
+    book_destroy(&book);
+    return EXIT_SUCCESS;
+}
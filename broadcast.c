@@ -0,0 +1,486 @@
+#include "broadcast.h"
+#include "server.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Allocate a message holding a copy of data; the caller owns the first reference
+Message* message_create(const char* data, int len) {
+    Message* msg = malloc(sizeof(Message) + len);
+    if (!msg) return NULL;
+    msg->refcount = 1;
+    msg->len = len;
+    memcpy(msg->data, data, len);
+    return msg;
+}
+
+// Allocate an empty message the caller fills in (data[0..capacity) and len)
+Message* message_alloc(int capacity) {
+    Message* msg = malloc(sizeof(Message) + capacity);
+    if (!msg) return NULL;
+    msg->refcount = 1;
+    msg->len = 0;
+    return msg;
+}
+
+// printf-style message constructor
+Message* message_format(const char* fmt, ...) {
+    char buffer[BUFFER_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    if (len < 0) return NULL;
+    if (len >= (int)sizeof(buffer)) len = sizeof(buffer) - 1;
+    return message_create(buffer, len);
+}
+
+Message* message_ref(Message* msg) {
+    __atomic_add_fetch(&msg->refcount, 1, __ATOMIC_RELAXED);
+    return msg;
+}
+
+void message_unref(Message* msg) {
+    if (msg && __atomic_sub_fetch(&msg->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(msg);
+    }
+}
+
+void outq_init(OutQueue* q) {
+    memset(q, 0, sizeof(*q));
+}
+
+static uint32_t key_hash(int key) {
+    return (uint32_t)key * 2654435761u;
+}
+
+static OutSlot* index_find(OutQueue* q, int key) {
+    if (!q->index) return NULL;
+    for (uint32_t i = key_hash(key) & q->index_mask;; i = (i + 1) & q->index_mask) {
+        if (q->index[i].key == key) return &q->index[i];
+        if (q->index[i].key == 0) return NULL;
+    }
+}
+
+// Point key at the entry with this serial, growing the table to stay at most half full
+static void index_put(OutQueue* q, int key, uint32_t serial) {
+    if (!q->index || (q->keyed + 1) * 2 > q->index_mask + 1) {
+        int size = q->index ? (q->index_mask + 1) * 2 : OUTQ_INDEX_INITIAL;
+        OutSlot* old = q->index;
+        int old_size = old ? q->index_mask + 1 : 0;
+        q->index = calloc(size, sizeof(OutSlot));
+        q->index_mask = size - 1;
+        for (int i = 0; i < old_size; i++) {
+            if (old[i].key) index_put(q, old[i].key, old[i].serial);
+        }
+        free(old);
+    }
+    uint32_t i = key_hash(key) & q->index_mask;
+    while (q->index[i].key && q->index[i].key != key) i = (i + 1) & q->index_mask;
+    q->index[i].key = key;
+    q->index[i].serial = serial;
+}
+
+// Forget key if it still points at serial; later entries of the probe run shift back
+static void index_remove(OutQueue* q, int key, uint32_t serial) {
+    OutSlot* slot = index_find(q, key);
+    if (!slot || slot->serial != serial) return;
+    uint32_t hole = slot - q->index;
+    for (uint32_t i = (hole + 1) & q->index_mask; q->index[i].key; i = (i + 1) & q->index_mask) {
+        uint32_t home = key_hash(q->index[i].key) & q->index_mask;
+        if (((i - home) & q->index_mask) >= ((i - hole) & q->index_mask)) {
+            q->index[hole] = q->index[i];
+            hole = i;
+        }
+    }
+    q->index[hole].key = 0;
+}
+
+// Replace a queued, not yet started entry with the same key; returns 1 if msg took its place
+static int outq_conflate(OutQueue* q, Message* msg, int key) {
+    OutSlot* slot = index_find(q, key);
+    if (!slot) return 0;
+    int first = q->offset > 0 ? 1 : 0; // The head may already be partly on the wire
+    if (q->sending > first) first = q->sending;
+    int i = (int)(slot->serial - q->base);
+    if (i < first || i >= q->count) return 0;
+    
+    OutEntry* e = &q->ring[(q->head + i) % q->capacity];
+    q->bytes += msg->len - e->msg->len;
+    if (q->bytes > q->peak_bytes) q->peak_bytes = q->bytes;
+    message_unref(e->msg);
+    e->msg = msg;
+    q->conflated++;
+    return 1;
+}
+
+// Append a message reference; the queue takes ownership of that reference.
+// Keyed messages replace an older queued one with the same key instead of queueing behind it.
+void outq_push(OutQueue* q, Message* msg, int key) {
+    if (key && q->keyed > 0 && outq_conflate(q, msg, key)) return;
+
+    if (q->count == q->capacity) {
+        int capacity = q->capacity ? q->capacity * 2 : OUTQ_INITIAL_CAPACITY;
+        OutEntry* ring = malloc(sizeof(OutEntry) * capacity);
+        for (int i = 0; i < q->count; i++) {
+            ring[i] = q->ring[(q->head + i) % q->capacity];
+        }
+        free(q->ring);
+        q->ring = ring;
+        q->head = 0;
+        q->capacity = capacity;
+    }
+    OutEntry* e = &q->ring[(q->head + q->count) % q->capacity];
+    e->msg = msg;
+    e->key = key;
+    if (key) {
+        index_put(q, key, q->base + q->count);
+        q->keyed++;
+    }
+    q->count++;
+    q->bytes += msg->len;
+    if (q->bytes > q->peak_bytes) q->peak_bytes = q->bytes;
+}
+
+// Release the head entry; the index is dropped with the last keyed one
+static void outq_pop(OutQueue* q) {
+    OutEntry* e = &q->ring[q->head];
+    if (e->key) {
+        index_remove(q, e->key, q->base);
+        if (--q->keyed == 0) {
+            free(q->index);
+            q->index = NULL;
+        }
+    }
+    message_unref(e->msg);
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    q->base++;
+}
+
+// Describe up to max queued messages as iovecs, starting after what is already written;
+// with refs, also take a reference to each message for a write that outlives the queue
+int outq_iov(OutQueue* q, struct iovec* iov, Message** refs, int max) {
+    int n = 0;
+    for (int i = 0; i < q->count && n < max; i++, n++) {
+        Message* msg = q->ring[(q->head + i) % q->capacity].msg;
+        if (refs) refs[n] = message_ref(msg);
+        int skip = (i == 0) ? q->offset : 0;
+        iov[n].iov_base = msg->data + skip;
+        iov[n].iov_len = msg->len - skip;
+    }
+    return n;
+}
+
+// Retire sent bytes from the head; an emptied queue releases its ring
+void outq_consume(OutQueue* q, size_t sent) {
+    q->bytes -= sent;
+    while (sent > 0) {
+        Message* msg = q->ring[q->head].msg;
+        size_t remaining = msg->len - q->offset;
+        if (sent < remaining) {
+            q->offset += sent;
+            break;
+        }
+        sent -= remaining;
+        q->offset = 0;
+        outq_pop(q);
+    }
+
+    // An idle session keeps no ring; the next push allocates a fresh one
+    if (q->count == 0) {
+        free(q->ring);
+        q->ring = NULL;
+        q->head = q->capacity = 0;
+    }
+}
+
+// Write as much of the queue as the socket takes; returns -1 on a dead socket
+int outq_flush(OutQueue* q, int socket) {
+    while (q->count > 0) {
+        struct iovec iov[OUTQ_MAX_IOV];
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = iov;
+        mh.msg_iovlen = outq_iov(q, iov, NULL, OUTQ_MAX_IOV);
+        metrics_count(CTR_IO_CALLS, 1);
+        ssize_t sent = sendmsg(socket, &mh, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        outq_consume(q, sent);
+    }
+    return 0;
+}
+
+// Drop every queued reference and release the ring
+void outq_clear(OutQueue* q) {
+    while (q->count > 0) outq_pop(q);
+    free(q->index);
+    free(q->ring);
+    outq_init(q);
+}
+
+// Encode an alert once (text or binary frame); every recipient shares the same buffer
+Message* alert_message(int stock_id, const Stock* s, int buy, int binary) {
+    if (binary) {
+        AlertMsg frame;
+        memset(&frame, 0, sizeof(frame));
+        proto_header(&frame.hdr, MSG_ALERT, sizeof(frame), 0);
+        frame.symbol_id = stock_id;
+        frame.side = buy ? SIDE_BUY : SIDE_SELL;
+        frame.price = s->price;
+        frame.change_percent = s->change_percent;
+        frame.tick_ns = s->updated_ns;
+        return message_create((const char*)&frame, sizeof(frame));
+    }
+    if (buy) {
+        return message_format("\n🔔 BUY ALERT: %s at $%.2f (%.2f%% drop)\n",
+                              s->symbol, s->price, s->change_percent);
+    }
+    return message_format("\n🔔 SELL ALERT: %s at $%.2f (%.2f%% rise)\n",
+                          s->symbol, s->price, s->change_percent);
+}
+
+// Encode one streamed quote for a single session (text or binary frame)
+Message* quote_message(int stock_id, const Stock* s, int binary) {
+    if (binary) {
+        QuoteMsg frame;
+        memset(&frame, 0, sizeof(frame));
+        proto_header(&frame.hdr, MSG_QUOTE, sizeof(frame), 0);
+        frame.quote.symbol_id = stock_id;
+        frame.quote.volume = s->volume;
+        frame.quote.price = s->price;
+        frame.quote.change_percent = s->change_percent;
+        frame.tick_ns = s->updated_ns;
+        return message_create((const char*)&frame, sizeof(frame));
+    }
+    return message_format("💹 %s $%.2f (%+.2f%%)\n", s->symbol, s->price, s->change_percent);
+}
+
+// Rendered market snapshots, kept until their version or the symbol count moves on.
+// Each market shard caches the QuoteEntry array of its own symbols (ids k, k + N, ...)
+// keyed by that shard's version, so a tick re-renders only its shard's part; the
+// AVAILABLE text is assembled from the parts and keyed by the whole market version.
+typedef struct {
+    pthread_mutex_t lock;       // Held while rendering, so a stale entry is rendered once
+    unsigned long version;
+    int count;
+    Message* msg;
+} SnapshotCache;
+
+static SnapshotCache quote_parts[MAX_MARKET_SHARDS] = {
+    [0 ... MAX_MARKET_SHARDS - 1] = { PTHREAD_MUTEX_INITIALIZER, 0, 0, NULL }
+};
+static SnapshotCache available = { PTHREAD_MUTEX_INITIALIZER, 0, 0, NULL };
+
+// QuoteEntry array of shard's symbols below count, in id order
+static Message* render_quotes(int shard, int shards, int count) {
+    int n = count > shard ? (count - shard + shards - 1) / shards : 0;
+    int len = n * sizeof(QuoteEntry);
+    Message* out = message_alloc(len);
+    if (!out) return NULL;
+
+    QuoteEntry* entries = (QuoteEntry*)out->data;
+    for (int i = 0; i < n; i++) {
+        int id = shard + i * shards;
+        Stock s;
+        market_read(id, &s);
+        entries[i].symbol_id = id;
+        entries[i].volume = s.volume;
+        entries[i].price = s.price;
+        entries[i].change_percent = s.change_percent;
+    }
+    out->len = len;
+    return out;
+}
+
+// AVAILABLE text from snapshot parts (see snapshot_quotes), listed by symbol ID
+Message* render_available(Message** parts, int shards, int count) {
+    Message* out = message_alloc(256 + count * (SYMBOL_LEN + 48));
+    if (!out) return NULL;
+    char* buffer = out->data;
+    int offset = 0;
+
+    offset += sprintf(buffer + offset, "\n═══════ AVAILABLE STOCKS (Simulated) ═══════\n");
+    offset += sprintf(buffer + offset, "%-6s | %-8s | %-6s\n", "Symbol", "Price", "Change");
+    offset += sprintf(buffer + offset, "----------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        const QuoteEntry* q = (const QuoteEntry*)parts[i % shards]->data + i / shards;
+        offset += sprintf(buffer + offset, "%-6s | $%8.2f | %+.2f%%\n",
+                            market_stock(i)->symbol, q->price, q->change_percent);
+    }
+    offset += sprintf(buffer + offset, "════════════════════════════════════════\n");
+    out->len = offset;
+    return out;
+}
+
+// Current part of one shard; the caller owns the returned reference
+static Message* quote_part(int shard, int shards, int count, unsigned long* version) {
+    SnapshotCache* c = &quote_parts[shard];
+
+    // Version before render: prices newer than the tag only cost a re-render
+    unsigned long v = market_shard_version(shard);
+
+    pthread_mutex_lock(&c->lock);
+    if (!c->msg || c->version != v || c->count != count) {
+        Message* fresh = render_quotes(shard, shards, count);
+        if (!fresh) {
+            pthread_mutex_unlock(&c->lock);
+            return NULL;
+        }
+        message_unref(c->msg);
+        c->msg = fresh;
+        c->version = v;
+        c->count = count;
+    }
+    Message* msg = message_ref(c->msg);
+    *version = c->version;
+    pthread_mutex_unlock(&c->lock);
+    return msg;
+}
+
+// MSG_SNAPSHOT body: one QuoteEntry array per market shard, each shared by every
+// request within that shard's version. Fills parts[0 .. shards - 1] (references the
+// caller owns) and returns the shard count, or 0 on allocation failure. Entries
+// are grouped by shard, not sorted by id. *version and *count describe the table.
+int snapshot_quotes(Message** parts, unsigned long* version, int* count) {
+    int shards = market_shard_count();
+    int n = market_symbol_count();
+    unsigned long v = 0;
+
+    for (int k = 0; k < shards; k++) {
+        unsigned long part_version;
+        parts[k] = quote_part(k, shards, n, &part_version);
+        if (!parts[k]) {
+            while (k-- > 0) message_unref(parts[k]);
+            return 0;
+        }
+        v += part_version;
+    }
+    if (version) *version = v;
+    if (count) *count = n;
+    return shards;
+}
+
+// AVAILABLE text for the current market version, assembled from the shard parts;
+// every request within a version shares one buffer and the caller owns the reference
+Message* available_message() {
+    unsigned long v = market_version();
+    int n = market_symbol_count();
+
+    pthread_mutex_lock(&available.lock);
+    if (!available.msg || available.version != v || available.count != n) {
+        Message* parts[MAX_MARKET_SHARDS];
+        int shards = snapshot_quotes(parts, NULL, NULL);
+        Message* fresh = shards ? render_available(parts, shards, n) : NULL;
+        for (int k = 0; k < shards; k++) message_unref(parts[k]);
+        if (!fresh) {
+            pthread_mutex_unlock(&available.lock);
+            return NULL;
+        }
+        message_unref(available.msg);
+        available.msg = fresh;
+        available.version = v;
+        available.count = n;
+    }
+    Message* msg = message_ref(available.msg);
+    pthread_mutex_unlock(&available.lock);
+    return msg;
+}
+
+static void cache_clear(SnapshotCache* c) {
+    pthread_mutex_lock(&c->lock);
+    message_unref(c->msg);
+    c->msg = NULL;
+    pthread_mutex_unlock(&c->lock);
+}
+
+// Drop the cached snapshots (shutdown)
+void snapshot_cache_clear() {
+    for (int k = 0; k < MAX_MARKET_SHARDS; k++) cache_clear(&quote_parts[k]);
+    cache_clear(&available);
+}
+
+// Lazily encode the alert variant a recipient needs; cache[buy][binary]
+static Message* cached_alert(Message* cache[2][2], int stock_id, const Stock* s, int buy, int binary) {
+    if (!cache[buy][binary]) cache[buy][binary] = alert_message(stock_id, s, buy, binary);
+    return cache[buy][binary];
+}
+
+// Stage one reference of msg for the reactor that owns client; returns the staged delivery
+Delivery* broadcast_stage(BroadcastBatch* b, ClientInfo* client, Message* msg, int key) {
+    int r = client->reactor->id;
+    if (b->count[r] == b->capacity[r]) {
+        int capacity = b->capacity[r] ? b->capacity[r] * 2 : BROADCAST_INITIAL_BATCH;
+        b->batch[r] = realloc(b->batch[r], sizeof(Delivery) * capacity);
+        b->capacity[r] = capacity;
+    }
+    Delivery* d = &b->batch[r][b->count[r]++];
+    d->session = session_handle(client);
+    d->key = key;
+    d->hold_seq = 0;
+    d->tick_ns = 0;
+    d->msg = message_ref(msg);
+    return d;
+}
+
+// Evaluate subscriptions for one updated stock and stage the alerts it fires
+void broadcast_tick(BroadcastBatch* b, int stock_idx) {
+    Stock s;
+    Message* alerts[2][2] = {{NULL, NULL}, {NULL, NULL}};
+
+    market_read(stock_idx, &s);
+
+    // All of the symbol's limits are checked in one vector pass, skipped outright while
+    // the move stays inside the nearest armed threshold. Alerts are keyed by symbol so a
+    // backlogged session keeps only the newest one per stock.
+    SymbolSubs* index = subindex_get(stock_idx);
+    const uint64_t* buy;
+    const uint64_t* sell;
+    pthread_mutex_lock(&index->lock);
+    int words = subindex_scan(index, s.change_percent, &buy, &sell);
+
+    // Buy alerts: price dropped by at least the threshold
+    for (int w = 0; w < words; w++) {
+        for (uint64_t m = buy[w]; m; m &= m - 1) {
+            Subscription* sub = index->subs[w * 64 + __builtin_ctzll(m)];
+            int binary = __atomic_load_n(&sub->client->binary, __ATOMIC_RELAXED);
+            Message* msg = cached_alert(alerts, stock_idx, &s, 1, binary);
+            if (msg) broadcast_stage(b, sub->client, msg, ALERT_KEY(stock_idx))->tick_ns = s.updated_ns;
+            subindex_arm(index, sub, 0, 1); // Re-arm the sell alert after a drop
+        }
+    }
+
+    // Sell alerts: price rose by at least the threshold
+    for (int w = 0; w < words; w++) {
+        for (uint64_t m = sell[w]; m; m &= m - 1) {
+            Subscription* sub = index->subs[w * 64 + __builtin_ctzll(m)];
+            int binary = __atomic_load_n(&sub->client->binary, __ATOMIC_RELAXED);
+            Message* msg = cached_alert(alerts, stock_idx, &s, 0, binary);
+            if (msg) broadcast_stage(b, sub->client, msg, ALERT_KEY(stock_idx))->tick_ns = s.updated_ns;
+            subindex_arm(index, sub, 1, 0); // Re-arm the buy alert after a rise
+        }
+    }
+
+    pthread_mutex_unlock(&index->lock);
+
+    // Drop the producer's own references; queued copies keep the buffers alive
+    for (int i = 0; i < 4; i++) message_unref(alerts[i / 2][i % 2]);
+}
+
+// Hand every staged batch to its reactor in one locked append and one wakeup
+void broadcast_commit(BroadcastBatch* b) {
+    for (int r = 0; r < reactor_count(); r++) {
+        if (b->count[r] == 0) continue;
+        reactor_deliver(reactor_get(r), b->batch[r], b->count[r]);
+        b->count[r] = 0;
+    }
+}
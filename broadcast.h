@@ -0,0 +1,103 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "reactor.h"
+#include "market.h"
+#include "sessions.h"
+
+// Constants
+#define OUTQ_INITIAL_CAPACITY 16
+#define OUTQ_MAX_IOV 64
+#define OUTQ_INDEX_INITIAL 16                   // Conflation index slots (power of two, doubled as needed)
+#define OUTQ_LIMIT_BYTES (256 * 1024)          // Backlog a session may hold for OUTQ_GRACE_NS
+#define OUTQ_HARD_LIMIT_BYTES (4 * 1024 * 1024) // Backlog that disconnects immediately
+#define OUTQ_GRACE_NS 5000000000LL
+#define BROADCAST_INITIAL_BATCH 64
+#define ALERT_KEY(stock_id) ((stock_id) + 1)   // Conflation keys: alerts and streamed quotes
+#define QUOTE_KEY(stock_id) (-(stock_id) - 1)  // of one symbol never replace each other
+
+struct ClientInfo;
+struct iovec;
+
+// Structures
+
+// Immutable, reference-counted wire message shared by every session it is queued to
+typedef struct Message {
+    int refcount;
+    int len;
+    char data[];
+} Message;
+
+// Queued message; a non-zero key marks market data that a newer update with the same key replaces
+typedef struct {
+    Message* msg;
+    int key;
+} OutEntry;
+
+// Conflation index entry: where the newest queued message with a key sits
+typedef struct {
+    int key;                    // 0 = empty slot
+    uint32_t serial;            // Position counted from the first message ever queued
+} OutSlot;
+
+// Per-session outbound queue of message references
+typedef struct {
+    OutEntry* ring;
+    int head;
+    int count;
+    int capacity;
+    int offset;                 // Bytes of ring[head] already written
+    int sending;                // Head entries handed to an io_uring send (not conflated)
+    int keyed;                  // Entries with a conflation key
+    uint32_t base;              // Serial of ring[head]
+    OutSlot* index;             // Open-addressed key -> serial of keyed entries (NULL while none)
+    int index_mask;
+    size_t bytes;               // Queued bytes not yet written
+    size_t peak_bytes;
+    uint64_t conflated;         // Market updates replaced before reaching the socket
+    int64_t over_since_ns;      // When bytes first exceeded OUTQ_LIMIT_BYTES (0 = within limit)
+} OutQueue;
+
+// One message addressed to one session
+typedef struct Delivery {
+    SessionHandle session;      // Resolved by the reactor; stale if the session closed in flight
+    int key;                    // Conflation key (0 = always delivered)
+    uint64_t hold_seq;          // Journal record the message reports (0 = none)
+    int64_t tick_ns;            // Alerts: publication time of the tick (latency metrics)
+    Message* msg;
+} Delivery;
+
+// Producer-side staging of deliveries, one batch per reactor
+typedef struct {
+    Delivery* batch[MAX_REACTORS];
+    int count[MAX_REACTORS];
+    int capacity[MAX_REACTORS];
+} BroadcastBatch;
+
+// Function prototypes
+Message* message_create(const char* data, int len);
+Message* message_alloc(int capacity);
+Message* message_format(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+Message* message_ref(Message* msg);
+void message_unref(Message* msg);
+
+void outq_init(OutQueue* q);
+void outq_push(OutQueue* q, Message* msg, int key);
+int outq_iov(OutQueue* q, struct iovec* iov, Message** refs, int max);
+void outq_consume(OutQueue* q, size_t sent);
+int outq_flush(OutQueue* q, int socket);
+void outq_clear(OutQueue* q);
+
+Message* alert_message(int stock_id, const Stock* s, int buy, int binary);
+Message* quote_message(int stock_id, const Stock* s, int binary);
+Message* render_available(Message** parts, int shards, int count);
+Message* available_message();
+int snapshot_quotes(Message** parts, unsigned long* version, int* count);
+void snapshot_cache_clear();
+Delivery* broadcast_stage(BroadcastBatch* b, struct ClientInfo* client, Message* msg, int key);
+void broadcast_tick(BroadcastBatch* b, int stock_idx);
+void broadcast_commit(BroadcastBatch* b);
+
+#endif
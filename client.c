@@ -2,79 +2,337 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
 #include <errno.h>
-#include <pthread.h>
+#include <poll.h>
+#include <inttypes.h>
 
-int client_socket = -1;
-volatile sig_atomic_t client_running = 1;
-pthread_t receiver_thread;
+// Interactive front end over clientlib: one thread polls stdin and the connection.
+// Commands typed at the prompt become binary requests right away, so several can be
+// in flight; each reply is printed by the callback of the request it answers.
+
+TcClient connection;
+volatile sig_atomic_t interrupted = 0;
+int client_running = 1;
+int quit_sent = 0;
+char (*symbols)[PROTO_SYMBOL_LEN + 1] = NULL;   // Names by symbol ID
+int symbol_count = 0;
+int symbols_loaded = 0;
+char username[32] = "";
 
 // Signal handler for CTRL+C
 void signal_handler(int signum) {
-    if (signum == SIGINT) {
-        if (client_running) {
-            printf("\n\nAttempting to disconnect cleanly...\n");
-            // Send QUIT command to server if socket is open
-            if (client_socket >= 0) {
-                send(client_socket, "QUIT\n", 5, 0);
-            }
-        }
-        client_running = 0;
+    if (signum == SIGINT) interrupted = 1;
+}
+
+static void prompt() {
+    printf("> ");
+    fflush(stdout);
+}
+
+static const char* symbol_name(uint32_t symbol_id) {
+    return symbol_id < (uint32_t)symbol_count ? symbols[symbol_id] : "?";
+}
+
+static int find_symbol(const char* name) {
+    for (int i = 0; i < symbol_count; i++) {
+        if (strcasecmp(symbols[i], name) == 0) return i;
     }
+    return -1;
 }
 
-// Thread to receive data from the server
-void* receive_thread(void* arg) {
-    char buffer[BUFFER_SIZE];
-    
-    while (client_running) {
-        int bytes = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-        
-        if (bytes <= 0) {
-            if (bytes == 0) {
-                printf("\nServer closed connection.\n");
-            } else if (errno != EINTR) {
-                // Ignore EINTR (interrupted system call)
-                perror("\nReceive error");
-            }
-            client_running = 0;
-            break;
-        }
-        
-        buffer[bytes] = '\0';
-        
-        // Handle server-side forced disconnection
-        if (strstr(buffer, "CLOSING_CONNECTION")) {
-             client_running = 0;
-             printf("Connection closed by server.\n");
-             break;
-        }
+static void print_fill(const FillMsg* f) {
+    if (f->side == SIDE_BUY) {
+        printf("\n✓ BOUGHT %d shares of %s at $%.2f\n"
+               "Total cost: $%.2f\n"
+               "Remaining balance: $%.2f\n\n",
+               f->quantity, symbol_name(f->symbol_id), f->price, f->amount, f->balance);
+        return;
+    }
+    double cost_basis = f->amount - f->realized_pl;
+    double pl_pct = cost_basis == 0 ? 0.0 : (f->realized_pl / cost_basis) * 100;
+    printf("\n✓ SOLD %d shares of %s at $%.2f\n"
+           "Proceeds: $%.2f\n"
+           "Profit/Loss: %s$%.2f (%.2f%%)\n"
+           "New balance: $%.2f\n\n",
+           f->quantity, symbol_name(f->symbol_id), f->price, f->amount,
+           f->realized_pl >= 0 ? "+" : "", f->realized_pl, pl_pct, f->balance);
+}
+
+static void print_ack(const OrderAckMsg* a) {
+    printf("\n✓ %s %d %s limit $%.2f\n", a->side == SIDE_BUY ? "BUY" : "SELL",
+           a->quantity, symbol_name(a->symbol_id), a->price);
+    if (a->filled > 0) printf("Filled: %d at avg $%.2f\n", a->filled, a->avg_price);
+    if (a->resting > 0) printf("Resting: %d as ORDER %" PRIu64 "\n", a->resting, a->order_id);
+    printf("Balance: $%.2f\n\n", a->balance);
+}
 
-        // Print bell character for alerts
-        if (strstr(buffer, "ALERT")) {
-            printf("\a");
+static const char* batch_error(int code) {
+    switch (code) {
+    case ERR_INVALID_QUANTITY: return "Invalid quantity";
+    case ERR_UNKNOWN_SYMBOL: return "Unknown symbol";
+    case ERR_INSUFFICIENT_FUNDS: return "Insufficient funds";
+    case ERR_NOT_OWNED: return "Symbol not owned";
+    case ERR_INSUFFICIENT_SHARES: return "Insufficient shares";
+    case ERR_BATCH_ABORTED: return "Not executed, another order in the batch failed";
+    default: return "Malformed request";
+    }
+}
+
+static void print_batch(const BatchReportMsg* b, int len) {
+    const BatchResultEntry* e = (const BatchResultEntry*)(b + 1);
+    int count = b->count;
+    if ((int)(sizeof(*b) + count * sizeof(*e)) > len) count = 0;
+
+    if (b->atomic && b->filled < count) {
+        printf("\n✗ BATCH ATOMIC %d orders: none executed\n", count);
+    } else {
+        printf("\n✓ BATCH %d orders: %d filled, %d rejected\n", count, b->filled, count - b->filled);
+    }
+    for (int i = 0; i < count; i++) {
+        if (e[i].error != ERR_NONE) {
+            printf("  %s %d %s: ERROR: %s\n", e[i].side == SIDE_BUY ? "BUY" : "SELL", e[i].quantity,
+                   symbol_name(e[i].symbol_id), batch_error(e[i].error));
+        } else if (e[i].side == SIDE_BUY) {
+            printf("  BOUGHT %d %s at $%.2f ($%.2f)\n", e[i].quantity, symbol_name(e[i].symbol_id),
+                   e[i].price, e[i].amount);
+        } else {
+            printf("  SOLD %d %s at $%.2f ($%.2f, P/L %s$%.2f)\n", e[i].quantity, symbol_name(e[i].symbol_id),
+                   e[i].price, e[i].amount, e[i].realized_pl >= 0 ? "+" : "", e[i].realized_pl);
         }
-        
-        printf("%s", buffer);
-        fflush(stdout);
-        
-        // Print the prompt back if needed
-        if (client_running && strstr(buffer, "\n\n") != NULL) {
-             printf("> ");
-             fflush(stdout);
+    }
+    printf("Balance: $%.2f\n\n", b->balance);
+}
+
+static void print_portfolio(const PortfolioMsg* p, int len) {
+    const HoldingEntry* h = (const HoldingEntry*)(p + 1);
+    int count = p->count;
+    if ((int)(sizeof(*p) + count * sizeof(*h)) > len) count = 0;
+
+    printf("\n╔══════════════════════════════════════════════════╗\n");
+    printf("║           PORTFOLIO - %s%-24s║\n", username, "");
+    printf("╚══════════════════════════════════════════════════╝\n");
+    printf("💰 Wallet: $%.2f\n", p->wallet_balance);
+    if (count == 0) {
+        printf("📊 Invested: $%.2f\n\n", 0.00);
+        printf("No holdings. Use BUY command to purchase stocks.\n\n");
+        return;
+    }
+    printf("Holdings:\n");
+    printf("%-6s | Qty | Avg Buy | Current | Value    | P/L\n", "Stock");
+    printf("--------------------------------------------------------\n");
+    double market_value = 0.0;
+    for (int i = 0; i < count; i++) {
+        double value = h[i].quantity * h[i].price;
+        double pl_pct = h[i].avg_buy_price == 0 ? 0.0 : ((h[i].price - h[i].avg_buy_price) / h[i].avg_buy_price) * 100;
+        market_value += value;
+        printf("%-6s | %3d | $%6.2f | $%6.2f | $%7.2f | %s%.2f%%\n",
+               symbol_name(h[i].symbol_id), h[i].quantity, h[i].avg_buy_price,
+               h[i].price, value, pl_pct >= 0 ? "+" : "", pl_pct);
+    }
+    double total_pl = market_value - p->total_invested;
+    printf("--------------------------------------------------------\n");
+    printf("📊 Total Invested Cost: $%.2f\n", p->total_invested);
+    printf("Portfolio Market Value: $%.2f\n", market_value);
+    printf("Total P/L: %s$%.2f\n\n", total_pl >= 0 ? "+" : "", total_pl);
+}
+
+static int compare_quotes(const void* a, const void* b) {
+    uint32_t x = ((const QuoteEntry*)a)->symbol_id, y = ((const QuoteEntry*)b)->symbol_id;
+    return (x > y) - (x < y);
+}
+
+// Snapshot entries arrive grouped by market shard; list them by symbol like AVAILABLE
+static void print_snapshot(const SnapshotMsg* s, int len) {
+    int count = s->count;
+    if ((int)(sizeof(*s) + count * sizeof(QuoteEntry)) > len) count = 0;
+    QuoteEntry* quotes = malloc(sizeof(QuoteEntry) * (count ? count : 1));
+    memcpy(quotes, s + 1, sizeof(QuoteEntry) * count);
+    qsort(quotes, count, sizeof(QuoteEntry), compare_quotes);
+
+    printf("\n═══════ AVAILABLE STOCKS (Simulated) ═══════\n");
+    printf("%-6s | %-8s | %-6s\n", "Symbol", "Price", "Change");
+    printf("----------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        printf("%-6s | $%8.2f | %+.2f%%\n", symbol_name(quotes[i].symbol_id),
+               quotes[i].price, quotes[i].change_percent);
+    }
+    printf("════════════════════════════════════════\n");
+    free(quotes);
+}
+
+static void print_orders(const OrdersMsg* o, int len) {
+    const OrderEntry* e = (const OrderEntry*)(o + 1);
+    int count = o->count;
+    if ((int)(sizeof(*o) + count * sizeof(*e)) > len) count = 0;
+
+    printf("\n═══════ OPEN ORDERS ═══════\n");
+    if (count == 0) {
+        printf("No resting orders. Add a price to BUY/SELL to place one.\n");
+    } else {
+        printf("%-20s | %-6s | %-4s | %6s | %s\n", "Order", "Stock", "Side", "Qty", "Limit");
+        for (int i = 0; i < count; i++) {
+            printf("%-20" PRIu64 " | %-6s | %-4s | %6d | $%.2f\n", e[i].order_id, symbol_name(e[i].symbol_id),
+                   e[i].side == SIDE_BUY ? "BUY" : "SELL", e[i].quantity, e[i].price);
         }
+    }
+    printf("\n");
+}
+
+// Reply to a typed command; arg is the text to print for OK (owned by the request)
+static void print_reply(TcClient* c, const FrameHeader* frame, int len, void* arg) {
+    (void)c;
+    if (!frame) {
+        free(arg);
+        return;
+    }
 
-        // Check if the server responded with a prompt
-        if (client_running && bytes > 0 && buffer[bytes-2] == '>' && buffer[bytes-1] == ' ') {
-             printf("> ");
-             fflush(stdout);
+    switch (frame->type) {
+    case MSG_OK:
+        printf("%s", arg ? (const char*)arg : "✓ OK\n");
+        break;
+    case MSG_ERROR: {
+        const ErrorMsg* e = (const ErrorMsg*)frame;
+        if (e->symbol_id != UINT32_MAX && e->symbol_id < (uint32_t)symbol_count) {
+            printf("ERROR: %.*s (%s)\n", (int)sizeof(e->text), e->text, symbol_name(e->symbol_id));
+        } else {
+            printf("ERROR: %.*s\n", (int)sizeof(e->text), e->text);
         }
+        break;
+    }
+    case MSG_FILL:
+        print_fill((const FillMsg*)frame);
+        break;
+    case MSG_ORDER_ACK:
+        print_ack((const OrderAckMsg*)frame);
+        break;
+    case MSG_BATCH_REPORT:
+        print_batch((const BatchReportMsg*)frame, len);
+        break;
+    case MSG_CANCELED: {
+        const CanceledMsg* m = (const CanceledMsg*)frame;
+        printf("✓ ORDER %" PRIu64 " cancelled (%d unfilled)\n", m->order_id, m->quantity);
+        break;
+    }
+    case MSG_ALERT:
+        break; // Fired by SUBSCRIBE itself; printed by on_alert
+    case MSG_PORTFOLIO:
+        print_portfolio((const PortfolioMsg*)frame, len);
+        break;
+    case MSG_SNAPSHOT:
+        print_snapshot((const SnapshotMsg*)frame, len);
+        break;
+    case MSG_ORDERS:
+        print_orders((const OrdersMsg*)frame, len);
+        break;
+    case MSG_SESSION: {
+        const SessionMsg* s = (const SessionMsg*)frame;
+        printf("Session %s: %u message(s) queued (%" PRIu64 " bytes), peak %" PRIu64 " bytes, "
+               "%" PRIu64 " update(s) conflated, limit %" PRIu64 " bytes\n",
+               username, s->queued, s->queued_bytes, s->peak_bytes, s->conflated, s->limit_bytes);
+        break;
+    }
+    case MSG_STATS:
+        printf("%.*s", len - (int)sizeof(FrameHeader), (const char*)(frame + 1));
+        break;
+    case MSG_BYE:
+        printf("Connection closed by server.\n");
+        break;
+    }
+    free(arg);
+    if (frame->type != MSG_BYE && frame->type != MSG_ALERT) prompt();
+}
+
+// LOGIN reply; arg is the account name
+static void on_login(TcClient* c, const FrameHeader* frame, int len, void* arg) {
+    if (frame && frame->type == MSG_OK) {
+        snprintf(username, sizeof(username), "%s", (const char*)arg);
+        printf("✓ Logged in as %s\n", username);
+        prompt();
+        free(arg);
+        return;
+    }
+    print_reply(c, frame, len, NULL);
+    free(arg);
+}
+
+static void on_alert(TcClient* c, const AlertMsg* a) {
+    (void)c;
+    if (a->side == SIDE_BUY) {
+        printf("\a\n🔔 BUY ALERT: %s at $%.2f (%.2f%% drop)\n", symbol_name(a->symbol_id), a->price, a->change_percent);
+    } else {
+        printf("\a\n🔔 SELL ALERT: %s at $%.2f (%.2f%% rise)\n", symbol_name(a->symbol_id), a->price, a->change_percent);
+    }
+    prompt();
+}
+
+static void on_quote(TcClient* c, const QuoteMsg* q) {
+    (void)c;
+    printf("💹 %s $%.2f (%+.2f%%)\n", symbol_name(q->quote.symbol_id), q->quote.price, q->quote.change_percent);
+    fflush(stdout);
+}
+
+static void on_exec(TcClient* c, const ExecMsg* e) {
+    (void)c;
+    printf("\n📣 ORDER %" PRIu64 ": %s %d %s at $%.2f (%d still resting)\n"
+           "Balance: $%.2f\n",
+           e->order_id, e->side == SIDE_BUY ? "BOUGHT" : "SOLD", e->quantity,
+           symbol_name(e->symbol_id), e->price, e->remaining, e->balance);
+    prompt();
+}
+
+static void on_pnl(TcClient* c, const PnlMsg* p) {
+    (void)c;
+    printf("\n📈 P/L: value $%.2f (%s%.2f) | unrealized %s$%.2f | cash $%.2f\n",
+           p->market_value, p->value_change >= 0 ? "+" : "", p->value_change,
+           p->unrealized_pl >= 0 ? "+" : "-", p->unrealized_pl >= 0 ? p->unrealized_pl : -p->unrealized_pl,
+           p->wallet_balance);
+    prompt();
+}
+
+// Symbol names arrive a page at a time; the prompt opens once all are known
+static void on_symbols(TcClient* c, const FrameHeader* frame, int len, void* arg) {
+    (void)arg;
+    if (!frame || frame->type != MSG_SYMBOLS) return;
+    const SymbolsMsg* m = (const SymbolsMsg*)frame;
+    const SymbolEntry* e = (const SymbolEntry*)(m + 1);
+    if ((int)(sizeof(*m) + m->count * sizeof(*e)) > len) return;
+
+    if (symbol_count != (int)m->total) {
+        symbols = realloc(symbols, sizeof(*symbols) * (m->total ? m->total : 1));
+        memset(symbols, 0, sizeof(*symbols) * m->total);
+        symbol_count = m->total;
     }
-    
-    return NULL;
+    for (uint32_t i = 0; i < m->count && m->first_id + i < m->total; i++) {
+        memcpy(symbols[m->first_id + i], e[i].symbol, PROTO_SYMBOL_LEN);
+    }
+
+    uint32_t next = m->first_id + m->count;
+    if (m->count > 0 && next < m->total) {
+        tc_symbols(c, next, on_symbols, NULL);
+        return;
+    }
+    symbols_loaded = 1;
+    printf("✓ Connected successfully! (session %u, %d symbols)\n", c->hello.session_id, symbol_count);
+    print_menu();
+}
+
+static void on_ready(TcClient* c, const HelloMsg* hello) {
+    snprintf(username, sizeof(username), "User%u", hello->session_id);
+    tc_symbols(c, 0, on_symbols, NULL);
+}
+
+static void on_close(TcClient* c, int error) {
+    (void)c;
+    if (error == ECONNREFUSED && !symbols_loaded) {
+        printf("Connection refused (server down or full).\n");
+    } else if (error) {
+        printf("\nConnection error: %s\n", strerror(error));
+    } else if (!quit_sent) {
+        printf("\nServer closed connection.\n");
+    }
+    client_running = 0;
 }
 
 // Prints the command menu
@@ -83,127 +341,285 @@ void print_menu() {
     printf("╔════════════════════════════════════════╗\n");
     printf("║         TRADING COMMANDS               ║\n");
     printf("╠════════════════════════════════════════╣\n");
-    printf("║ BUY <symbol> <qty>   - Buy shares     ║\n");
-    printf("║ SELL <symbol> <qty>  - Sell shares    ║\n");
+    printf("║ BUY <symbol> <qty> [p] - Buy shares   ║\n");
+    printf("║ SELL <symbol> <qty> [p]- Sell shares  ║\n");
+    printf("║ BATCH [ATOMIC] <orders> - Many orders ║\n");
+    printf("║ ORDERS               - Open orders     ║\n");
+    printf("║ CANCEL <order>       - Cancel order    ║\n");
     printf("║ PORTFOLIO            - View holdings   ║\n");
+    printf("║ PORTFOLIO WATCH [ms] - Live P/L        ║\n");
     printf("║ AVAILABLE            - List stocks     ║\n");
     printf("║ SUBSCRIBE <symbol> [t] - Price alerts  ║\n");
+    printf("║ STREAM <sym|ALL> [ms] [m] - Quotes     ║\n");
+    printf("║ UNSTREAM [symbol]    - Stop quotes     ║\n");
+    printf("║ LOGIN <name>         - Use account     ║\n");
+    printf("║ SESSION              - Queue stats     ║\n");
+    printf("║ STATS                - Server stats    ║\n");
     printf("║ HELP                 - Show help       ║\n");
     printf("║ QUIT                 - Exit            ║\n");
     printf("╚════════════════════════════════════════╝\n");
-    printf("> ");
-    fflush(stdout);
+    prompt();
+}
+
+static void send_quit(TcClient* c) {
+    if (quit_sent) return;
+    quit_sent = 1;
+    if (!tc_request(c, MSG_QUIT, print_reply, NULL)) client_running = 0;
+}
+
+static void handle_trade(TcClient* c, int side, const char* symbol, int qty, const char* price) {
+    int symbol_id = find_symbol(symbol);
+    if (symbol_id < 0) {
+        printf("ERROR: Stock %s not found\n", symbol);
+        prompt();
+    } else if (price) {
+        tc_limit(c, symbol_id, side, qty, atof(price), print_reply, NULL);
+    } else {
+        tc_order(c, symbol_id, side, qty, print_reply, NULL);
+    }
+}
+
+// BATCH [ATOMIC] BUY|SELL <symbol> <qty> [, ...]
+static void handle_batch(TcClient* c, char* args) {
+    BatchOrderEntry orders[PROTO_MAX_BATCH];
+    int count = 0, atomic = 0;
+    char* save = NULL;
+    char* token = strtok_r(args, " \t,", &save);
+
+    if (token && strcasecmp(token, "ATOMIC") == 0) {
+        atomic = 1;
+        token = strtok_r(NULL, " \t,", &save);
+    }
+    while (token) {
+        char* symbol = strtok_r(NULL, " \t,", &save);
+        char* qty = symbol ? strtok_r(NULL, " \t,", &save) : NULL;
+        int side = strcasecmp(token, "BUY") == 0 ? SIDE_BUY : strcasecmp(token, "SELL") == 0 ? SIDE_SELL : -1;
+        if (!qty || side < 0 || count == PROTO_MAX_BATCH) {
+            count = 0;
+            break;
+        }
+        int symbol_id = find_symbol(symbol);
+        if (symbol_id < 0) {
+            printf("ERROR: Stock %s not found\n", symbol);
+            prompt();
+            return;
+        }
+        memset(&orders[count], 0, sizeof(orders[count]));
+        orders[count].symbol_id = symbol_id;
+        orders[count].side = side;
+        orders[count++].quantity = atoi(qty);
+        token = strtok_r(NULL, " \t,", &save);
+    }
+    if (count == 0) {
+        printf("ERROR: Usage: BATCH [ATOMIC] BUY|SELL <symbol> <qty> ... (at most %d orders)\n", PROTO_MAX_BATCH);
+        prompt();
+        return;
+    }
+    tc_batch(c, orders, count, atomic, print_reply, NULL);
+}
+
+// Turn one typed line into a request (HELP and unknown symbols are answered locally)
+void handle_input(TcClient* c, char* line) {
+    char cmd[32], arg1[32], arg2[32], arg3[32];
+    char text[BUFFER_SIZE];
+    int n = sscanf(line, "%31s %31s %31s %31s", cmd, arg1, arg2, arg3);
+    if (n <= 0) {
+        prompt();
+        return;
+    }
+
+    if (strcasecmp(cmd, "BATCH") == 0 && n >= 2) {
+        handle_batch(c, line + strspn(line, " \t") + strlen(cmd));
+    }
+    else if ((strcasecmp(cmd, "BUY") == 0 || strcasecmp(cmd, "SELL") == 0) && (n == 3 || n == 4)) {
+        handle_trade(c, strcasecmp(cmd, "BUY") == 0 ? SIDE_BUY : SIDE_SELL, arg1, atoi(arg2), n == 4 ? arg3 : NULL);
+    }
+    else if (strcasecmp(cmd, "CANCEL") == 0 && n == 2) {
+        tc_cancel(c, strtoull(arg1, NULL, 10), print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "ORDERS") == 0 && n == 1) {
+        tc_request(c, MSG_ORDERS_REQ, print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "LOGIN") == 0 && n == 2) {
+        tc_login(c, arg1, on_login, strdup(arg1));
+    }
+    else if (strcasecmp(cmd, "PORTFOLIO") == 0 && n == 1) {
+        tc_request(c, MSG_PORTFOLIO_REQ, print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "PORTFOLIO") == 0 && strcasecmp(arg1, "WATCH") == 0 && n <= 3) {
+        int interval_ms = n == 3 ? atoi(arg2) : WATCH_DEFAULT_MS;
+        if (interval_ms <= 0) {
+            printf("ERROR: Interval must be a positive number of milliseconds\n");
+            prompt();
+            return;
+        }
+        snprintf(text, sizeof(text), "✓ Portfolio P/L pushed at most every %d ms (PORTFOLIO UNWATCH to stop)\n",
+                 interval_ms < WATCH_MIN_MS ? WATCH_MIN_MS : interval_ms);
+        tc_watch(c, interval_ms, print_reply, strdup(text));
+    }
+    else if (strcasecmp(cmd, "PORTFOLIO") == 0 && strcasecmp(arg1, "UNWATCH") == 0 && n == 2) {
+        tc_watch(c, 0, print_reply, strdup("✓ Stopped portfolio updates\n"));
+    }
+    else if (strcasecmp(cmd, "AVAILABLE") == 0 && n == 1) {
+        tc_request(c, MSG_SNAPSHOT_REQ, print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "SUBSCRIBE") == 0 && (n == 2 || n == 3)) {
+        int symbol_id = find_symbol(arg1);
+        double threshold = n == 3 ? atof(arg2) : 5.0;
+        if (symbol_id < 0) {
+            printf("ERROR: Stock %s not found\n", arg1);
+            prompt();
+            return;
+        }
+        snprintf(text, sizeof(text), "✓ Subscribed to %s for price changes of %.1f%% or more.\n",
+                 symbols[symbol_id], threshold);
+        tc_subscribe(c, symbol_id, threshold, print_reply, strdup(text));
+    }
+    else if (strcasecmp(cmd, "STREAM") == 0 && n >= 2) {
+        int all = strcasecmp(arg1, "ALL") == 0;
+        int symbol_id = all ? 0 : find_symbol(arg1);
+        int interval_ms = n >= 3 ? atoi(arg2) : STREAM_DEFAULT_MS;
+        double min_change = n == 4 ? atof(arg3) : 0.0;
+        if (symbol_id < 0) {
+            printf("ERROR: Stock %s not found\n", arg1);
+            prompt();
+            return;
+        }
+        if (interval_ms <= 0) {
+            printf("ERROR: Interval must be a positive number of milliseconds\n");
+            prompt();
+            return;
+        }
+        tc_stream(c, all ? PROTO_ALL_SYMBOLS : (uint32_t)symbol_id, interval_ms, min_change, print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "UNSTREAM") == 0 && n <= 2) {
+        int all = n == 1 || strcasecmp(arg1, "ALL") == 0;
+        int symbol_id = all ? 0 : find_symbol(arg1);
+        if (symbol_id < 0) {
+            printf("ERROR: Stock %s not found\n", arg1);
+            prompt();
+            return;
+        }
+        if (all) {
+            snprintf(text, sizeof(text), "✓ Stopped all quote streams\n");
+        } else {
+            snprintf(text, sizeof(text), "✓ Stopped streaming %s\n", symbols[symbol_id]);
+        }
+        tc_unstream(c, all ? PROTO_ALL_SYMBOLS : (uint32_t)symbol_id, print_reply, strdup(text));
+    }
+    else if (strcasecmp(cmd, "SESSION") == 0 && n == 1) {
+        tc_request(c, MSG_SESSION_REQ, print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "STATS") == 0 && n == 1) {
+        tc_request(c, MSG_STATS_REQ, print_reply, NULL);
+    }
+    else if (strcasecmp(cmd, "HELP") == 0 && n == 1) {
+        print_menu();
+    }
+    else if (strcasecmp(cmd, "QUIT") == 0 && n == 1) {
+        send_quit(c);
+    }
+    else {
+        printf("ERROR: Invalid command or arguments. Type HELP.\n");
+        prompt();
+    }
+}
+
+// Run every complete line typed so far; returns bytes consumed
+static int handle_lines(TcClient* c, char* data, int len) {
+    int offset = 0;
+    char* newline;
+    while (client_running && !quit_sent && (newline = memchr(data + offset, '\n', len - offset))) {
+        *newline = '\0';
+        handle_input(c, data + offset);
+        offset = newline - data + 1;
+    }
+    return offset;
 }
 
 // Cleanup socket resource
 void cleanup_client() {
-    if (client_socket >= 0) {
-        close(client_socket);
-        client_socket = -1;
-    }
+    tc_close(&connection);
+    free(symbols);
+    symbols = NULL;
 }
 
 int main(int argc, char* argv[]) {
-    struct sockaddr_in server_addr;
     char buffer[BUFFER_SIZE];
+    int buffered = 0;
+    int stdin_open = 1;
     char server_ip[16] = SERVER_IP;
-    
+
     if (argc > 1) {
         strncpy(server_ip, argv[1], sizeof(server_ip) - 1);
     }
-    
+
     printf("\n");
     printf("╔════════════════════════════════════════╗\n");
-    printf("║   STOCK TRADING CLIENT v3.0           ║\n");
+    printf("║   STOCK TRADING CLIENT v4.0           ║\n");
     printf("╚════════════════════════════════════════╝\n");
     printf("\nConnecting to %s:%d...\n", server_ip, PORT);
-    
+
     signal(SIGINT, signal_handler);
-    
-    // 1. Create socket
-    client_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_socket < 0) {
-        perror("Socket creation failed");
-        exit(EXIT_FAILURE);
-    }
-    
-    // Configure server address structure
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(PORT);
-    
-    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0) {
-        perror("Invalid address/ Address not supported");
-        cleanup_client();
-        exit(EXIT_FAILURE);
-    }
-    
-    // 2. Connect to server
-    if (connect(client_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+
+    TcCallbacks callbacks = {
+        .on_ready = on_ready,
+        .on_exec = on_exec,
+        .on_alert = on_alert,
+        .on_quote = on_quote,
+        .on_pnl = on_pnl,
+        .on_close = on_close,
+    };
+    if (tc_connect(&connection, server_ip, PORT, &callbacks) < 0) {
         perror("Connection failed");
-        cleanup_client();
-        exit(EXIT_FAILURE);
-    }
-    
-    printf("✓ Connected successfully!\n\n");
-    
-    // Start receiving thread
-    if (pthread_create(&receiver_thread, NULL, receive_thread, NULL) != 0) {
-        perror("Thread creation failed");
-        cleanup_client();
         exit(EXIT_FAILURE);
     }
-    
-    // Give the receiver thread a moment to catch the welcome message
-    usleep(500000); 
-    
-    // Main command loop
+
+    // Commands are read only once the symbol list is in, so names resolve locally
     while (client_running) {
-        if (fgets(buffer, BUFFER_SIZE, stdin) == NULL) {
-            if (client_running) {
-                // EOF (Ctrl+D) - simulate quit
-                send(client_socket, "QUIT\n", 5, 0);
-            }
-            client_running = 0;
-            break;
-        }
-        
-        buffer[strcspn(buffer, "\n")] = 0; // Remove newline
-        
-        if (strlen(buffer) == 0) {
-            printf("> ");
-            fflush(stdout);
-            continue;
-        }
-        
-        // Send command to server
-        strcat(buffer, "\n"); // Add newline for server-side parsing
-        if (send(client_socket, buffer, strlen(buffer), 0) < 0) {
-            perror("Send failed");
-            client_running = 0;
+        struct pollfd fds[2] = {
+            { tc_fd(&connection), (short)tc_events(&connection), 0 },
+            { STDIN_FILENO, POLLIN, 0 },
+        };
+        int nfds = stdin_open && symbols_loaded && !quit_sent ? 2 : 1;
+
+        if (poll(fds, nfds, -1) < 0 && errno != EINTR) {
+            perror("poll");
             break;
         }
-        
-        if (strncasecmp(buffer, "QUIT", 4) == 0) {
-            // Give server a chance to process QUIT before stopping receiver
-            usleep(200000); 
-            client_running = 0;
-            break;
+        if (interrupted) {
+            interrupted = 0;
+            printf("\n\nAttempting to disconnect cleanly...\n");
+            send_quit(&connection);
         }
-        
-        // Wait briefly for server response before printing new prompt
-        usleep(200000); 
-        
-        // Print next prompt if still running (the receiver thread usually handles this after a delay)
-        if (client_running) {
-            printf("> ");
-            fflush(stdout);
+
+        if (nfds == 2 && fds[1].revents) {
+            ssize_t bytes = read(STDIN_FILENO, buffer + buffered, sizeof(buffer) - 1 - buffered);
+            if (bytes <= 0) {
+                // EOF (Ctrl+D): run a last unterminated line, then quit
+                stdin_open = 0;
+                if (buffered > 0) {
+                    buffer[buffered++] = '\n';
+                    handle_lines(&connection, buffer, buffered);
+                }
+                buffered = 0;
+                send_quit(&connection);
+            } else {
+                buffered += bytes;
+                int used = handle_lines(&connection, buffer, buffered);
+                memmove(buffer, buffer + used, buffered - used);
+                buffered -= used;
+                if (buffered == (int)sizeof(buffer) - 1) {
+                    printf("ERROR: Command too long.\n");
+                    buffered = 0;
+                }
+            }
         }
+
+        if (tc_process(&connection, fds[0].revents) < 0) client_running = 0;
     }
-    
-    // Wait for receiver thread to finish
-    pthread_join(receiver_thread, NULL);
+
     cleanup_client();
-    
     printf("\n✓ Disconnected\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -2,16 +2,20 @@
 #define CLIENT_H
 
 #include <signal.h>
+#include "clientlib.h"
 
 // Constants
 #define SERVER_IP "127.0.0.1"
-#define PORT 8888
+#define PORT TC_DEFAULT_PORT
 #define BUFFER_SIZE 1024
+#define WATCH_DEFAULT_MS 1000      // Server defaults for PORTFOLIO WATCH and STREAM
+#define WATCH_MIN_MS 100
+#define STREAM_DEFAULT_MS 250
 
 // Function Prototypes
 void signal_handler(int signum);
-void* receive_thread(void* arg);
 void print_menu();
+void handle_input(TcClient* c, char* line);
 void cleanup_client();
 
-#endif
\ No newline at end of file
+#endif
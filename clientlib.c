@@ -0,0 +1,436 @@
+#include "clientlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// The text welcome the server sends on connect ends with this prompt; frames follow it
+static const char welcome_end[] = "\n\n> ";
+
+static void append_out(TcClient* c, const void* data, int len) {
+    if (c->out_len + len > c->out_capacity) {
+        int capacity = c->out_capacity ? c->out_capacity : TC_IO_CHUNK;
+        while (capacity < c->out_len + len) capacity *= 2;
+        c->outbuf = realloc(c->outbuf, capacity);
+        c->out_capacity = capacity;
+    }
+    memcpy(c->outbuf + c->out_len, data, len);
+    c->out_len += len;
+}
+
+static void push_pending(TcClient* c, uint32_t request_id, TcReplyFn fn, void* arg) {
+    if (c->pending_count == c->pending_capacity) {
+        int capacity = c->pending_capacity ? c->pending_capacity * 2 : 64;
+        TcPending* ring = malloc(sizeof(TcPending) * capacity);
+        for (int i = 0; i < c->pending_count; i++) {
+            ring[i] = c->pending[(c->pending_head + i) % c->pending_capacity];
+        }
+        free(c->pending);
+        c->pending = ring;
+        c->pending_head = 0;
+        c->pending_capacity = capacity;
+    }
+    TcPending* p = &c->pending[(c->pending_head + c->pending_count) % c->pending_capacity];
+    p->request_id = request_id;
+    p->fn = fn;
+    p->arg = arg;
+    c->pending_count++;
+}
+
+// Take the request a reply answers out of the ring; returns 0 if none is waiting for it
+static int take_pending(TcClient* c, uint32_t request_id, TcPending* out) {
+    int found = 0;
+    for (int i = 0; i < c->pending_count; i++) {
+        TcPending* p = &c->pending[(c->pending_head + i) % c->pending_capacity];
+        if (p->request_id != request_id) continue;
+        *out = *p;
+        p->request_id = 0;
+        found = 1;
+        break;
+    }
+    // Answered entries leave from the head (normally the one just answered)
+    while (c->pending_count && c->pending[c->pending_head].request_id == 0) {
+        c->pending_head = (c->pending_head + 1) % c->pending_capacity;
+        c->pending_count--;
+    }
+    return found;
+}
+
+// Drop the connection; requests still in flight are answered with a NULL frame
+static void shut(TcClient* c, int error, int notify) {
+    if (c->state == TC_CLOSED) return;
+    c->state = TC_CLOSED;
+    c->error = error;
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+
+    for (int i = 0; i < c->pending_count; i++) {
+        TcPending* p = &c->pending[(c->pending_head + i) % c->pending_capacity];
+        if (p->request_id && p->fn) p->fn(c, NULL, 0, p->arg);
+    }
+    free(c->pending);
+    free(c->inbuf);
+    free(c->outbuf);
+    c->pending = NULL;
+    c->pending_head = c->pending_count = c->pending_capacity = 0;
+    c->inbuf = c->outbuf = NULL;
+    c->inbuf_len = c->inbuf_capacity = c->out_len = c->out_capacity = 0;
+
+    if (notify && c->callbacks.on_close) c->callbacks.on_close(c, error);
+}
+
+// Start a non-blocking connect and queue the binary handshake behind it. Requests may
+// be issued right away; they are sent once the connection is up.
+int tc_connect(TcClient* c, const char* ip, int port, const TcCallbacks* callbacks) {
+    struct sockaddr_in addr;
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    c->state = TC_CLOSED;
+    if (callbacks) c->callbacks = *callbacks;
+    c->next_request_id = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port ? port : TC_DEFAULT_PORT);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) return -1;
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(c->fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        c->state = TC_HANDSHAKE;
+    } else if (errno == EINPROGRESS) {
+        c->state = TC_CONNECTING;
+    } else {
+        int error = errno;
+        close(c->fd);
+        c->fd = -1;
+        errno = error;
+        return -1;
+    }
+
+    const char* handshake = PROTO_HANDSHAKE "\n";
+    append_out(c, handshake, strlen(handshake));
+    return 0;
+}
+
+// Close the connection (pending requests get a NULL reply; on_close is not called)
+void tc_close(TcClient* c) {
+    shut(c, 0, 0);
+}
+
+int tc_fd(const TcClient* c) {
+    return c->fd;
+}
+
+// poll() events the connection is waiting for (0 once closed)
+int tc_events(const TcClient* c) {
+    if (c->state == TC_CLOSED) return 0;
+    if (c->state == TC_CONNECTING || c->out_len > 0) return POLLIN | POLLOUT;
+    return POLLIN;
+}
+
+// Requests in flight
+int tc_pending(const TcClient* c) {
+    int count = 0;
+    for (int i = 0; i < c->pending_count; i++) {
+        if (c->pending[(c->pending_head + i) % c->pending_capacity].request_id) count++;
+    }
+    return count;
+}
+
+// Write as much queued output as the socket takes; returns -1 once closed
+int tc_flush(TcClient* c) {
+    if (c->state == TC_CLOSED) return -1;
+    if (c->state == TC_CONNECTING) return 0;
+
+    int offset = 0;
+    while (offset < c->out_len) {
+        ssize_t bytes = send(c->fd, c->outbuf + offset, c->out_len - offset, MSG_NOSIGNAL);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            shut(c, errno, 1);
+            return -1;
+        }
+        offset += bytes;
+    }
+    memmove(c->outbuf, c->outbuf + offset, c->out_len - offset);
+    c->out_len -= offset;
+    return 0;
+}
+
+// Route one frame. Replies go to the callback of the request they answer; FILL also
+// reaches on_fill, and an ALERT fired by SUBSCRIBE itself is treated as an alert.
+static void dispatch(TcClient* c, const char* data, int len) {
+    const FrameHeader* hdr = (const FrameHeader*)data;
+
+    switch (hdr->type) {
+    case MSG_ALERT:
+        if (len >= (int)sizeof(AlertMsg) && c->callbacks.on_alert) c->callbacks.on_alert(c, (const AlertMsg*)data);
+        return;
+    case MSG_QUOTE:
+        if (len >= (int)sizeof(QuoteMsg) && c->callbacks.on_quote) c->callbacks.on_quote(c, (const QuoteMsg*)data);
+        return;
+    case MSG_PNL:
+        if (len >= (int)sizeof(PnlMsg) && c->callbacks.on_pnl) c->callbacks.on_pnl(c, (const PnlMsg*)data);
+        return;
+    case MSG_EXEC:
+        if (len >= (int)sizeof(ExecMsg) && c->callbacks.on_exec) c->callbacks.on_exec(c, (const ExecMsg*)data);
+        return;
+    case MSG_FILL:
+        if (len >= (int)sizeof(FillMsg) && c->callbacks.on_fill) c->callbacks.on_fill(c, (const FillMsg*)data);
+        if (c->state == TC_CLOSED) return;
+        break;
+    }
+
+    TcPending p;
+    if (hdr->request_id == 0 || !take_pending(c, hdr->request_id, &p)) return;
+    if (p.fn) p.fn(c, hdr, len, p.arg);
+}
+
+// Skip the text welcome and take the HELLO frame; returns bytes consumed, 0 if more
+// input is needed, -1 if the server sent something else (e.g. server full)
+static int handshake(TcClient* c) {
+    int offset = -1;
+    for (int i = 0; i + (int)sizeof(welcome_end) - 1 <= c->inbuf_len; i++) {
+        if (memcmp(c->inbuf + i, welcome_end, sizeof(welcome_end) - 1) == 0) {
+            offset = i + sizeof(welcome_end) - 1;
+            break;
+        }
+    }
+    if (offset < 0) return 0;
+    int frame_len = proto_frame_length(c->inbuf + offset, c->inbuf_len - offset);
+    if (frame_len <= 0) return frame_len;
+    if (frame_len < (int)sizeof(HelloMsg)) return -1;
+
+    memcpy(&c->hello, c->inbuf + offset, sizeof(c->hello));
+    if (c->hello.hdr.type != MSG_HELLO || c->hello.version != PROTO_VERSION) return -1;
+    c->state = TC_READY;
+    if (c->callbacks.on_ready) c->callbacks.on_ready(c, &c->hello);
+    return offset + frame_len;
+}
+
+// Read what the socket has and run every complete frame
+static int read_input(TcClient* c) {
+    int eof = 0;
+    for (;;) {
+        if (c->inbuf_capacity - c->inbuf_len < TC_IO_CHUNK) {
+            c->inbuf_capacity = c->inbuf_capacity ? c->inbuf_capacity * 2 : TC_IO_CHUNK * 2;
+            c->inbuf = realloc(c->inbuf, c->inbuf_capacity);
+        }
+        ssize_t bytes = recv(c->fd, c->inbuf + c->inbuf_len, c->inbuf_capacity - c->inbuf_len, 0);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            shut(c, errno, 1);
+            return -1;
+        }
+        if (bytes == 0) {
+            eof = 1;
+            break;
+        }
+        c->inbuf_len += bytes;
+    }
+
+    // Frames are handed out in place; a callback may close the client under us
+    int offset = 0;
+    if (c->state == TC_HANDSHAKE) {
+        offset = handshake(c);
+        if (offset < 0) {
+            shut(c, ECONNREFUSED, 1);
+            return -1;
+        }
+        if (c->state == TC_CLOSED) return -1;
+    }
+    while (c->state == TC_READY) {
+        int frame_len = proto_frame_length(c->inbuf + offset, c->inbuf_len - offset);
+        if (frame_len < 0) {
+            shut(c, EPROTO, 1);
+            return -1;
+        }
+        if (frame_len == 0) break;
+        dispatch(c, c->inbuf + offset, frame_len);
+        if (c->state == TC_CLOSED) return -1;
+        offset += frame_len;
+    }
+    memmove(c->inbuf, c->inbuf + offset, c->inbuf_len - offset);
+    c->inbuf_len -= offset;
+
+    if (eof) {
+        shut(c, c->state == TC_READY ? 0 : ECONNREFUSED, 1);
+        return -1;
+    }
+    return 0;
+}
+
+// Event loop hook: finish connecting, send queued requests and handle replies.
+// revents are the poll() events seen on tc_fd(); returns -1 once closed.
+int tc_process(TcClient* c, int revents) {
+    if (c->state == TC_CLOSED) return -1;
+
+    if (c->state == TC_CONNECTING) {
+        if (!(revents & (POLLOUT | POLLERR | POLLHUP))) return 0;
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error) {
+            shut(c, error, 1);
+            return -1;
+        }
+        c->state = TC_HANDSHAKE;
+    }
+    if (tc_flush(c) < 0) return -1;
+    if (revents & (POLLIN | POLLERR | POLLHUP)) {
+        if (read_input(c) < 0) return -1;
+        if (tc_flush(c) < 0) return -1; // Requests issued by callbacks
+    }
+    return 0;
+}
+
+// Minimal event loop for programs without their own: wait up to timeout_ms and process
+int tc_poll(TcClient* c, int timeout_ms) {
+    if (tc_flush(c) < 0) return -1;
+    struct pollfd pfd = { c->fd, (short)tc_events(c), 0 };
+    int n = poll(&pfd, 1, timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+    if (n == 0) return 0;
+    return tc_process(c, pfd.revents);
+}
+
+// Queue a frame whose header type and length are set; assigns its request ID
+static uint32_t submit(TcClient* c, FrameHeader* hdr, TcReplyFn fn, void* arg) {
+    if (c->state == TC_CLOSED) return 0;
+    uint32_t request_id = c->next_request_id++;
+    if (c->next_request_id == 0) c->next_request_id = 1;
+    hdr->request_id = request_id;
+    append_out(c, hdr, hdr->length);
+    push_pending(c, request_id, fn, arg);
+    return request_id;
+}
+
+// Market order (side SIDE_BUY / SIDE_SELL): answered with FILL or ERROR
+uint32_t tc_order(TcClient* c, uint32_t symbol_id, int side, int quantity, TcReplyFn fn, void* arg) {
+    OrderMsg order;
+    memset(&order, 0, sizeof(order));
+    proto_header(&order.hdr, MSG_ORDER, sizeof(order), 0);
+    order.symbol_id = symbol_id;
+    order.side = side;
+    order.quantity = quantity;
+    return submit(c, &order.hdr, fn, arg);
+}
+
+// Limit order: answered with ORDER_ACK or ERROR; later executions arrive as EXEC
+uint32_t tc_limit(TcClient* c, uint32_t symbol_id, int side, int quantity, double price, TcReplyFn fn, void* arg) {
+    LimitOrderMsg order;
+    memset(&order, 0, sizeof(order));
+    proto_header(&order.hdr, MSG_LIMIT, sizeof(order), 0);
+    order.symbol_id = symbol_id;
+    order.side = side;
+    order.quantity = quantity;
+    order.price = price;
+    return submit(c, &order.hdr, fn, arg);
+}
+
+// Market orders in one request (at most PROTO_MAX_BATCH): answered with BATCH_REPORT or ERROR.
+// With atomic, either every order fills or none does; returns 0 if the request was not sent
+uint32_t tc_batch(TcClient* c, const BatchOrderEntry* orders, int count, int atomic, TcReplyFn fn, void* arg) {
+    if (count < 0 || count > PROTO_MAX_BATCH) return 0;
+    int len = sizeof(BatchMsg) + count * sizeof(BatchOrderEntry);
+    BatchMsg* req = calloc(1, len);
+    if (!req) return 0;
+    proto_header(&req->hdr, MSG_ORDER_BATCH, len, 0);
+    req->count = count;
+    req->atomic = atomic ? 1 : 0;
+    memcpy(req + 1, orders, count * sizeof(BatchOrderEntry));
+    uint32_t request_id = submit(c, &req->hdr, fn, arg);
+    free(req);
+    return request_id;
+}
+
+// Answered with CANCELED or ERROR
+uint32_t tc_cancel(TcClient* c, uint64_t order_id, TcReplyFn fn, void* arg) {
+    CancelMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_CANCEL, sizeof(req), 0);
+    req.order_id = order_id;
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Answered with OK or ERROR; alerts then reach on_alert
+uint32_t tc_subscribe(TcClient* c, uint32_t symbol_id, double threshold, TcReplyFn fn, void* arg) {
+    SubscribeMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_SUBSCRIBE, sizeof(req), 0);
+    req.symbol_id = symbol_id;
+    req.threshold = threshold;
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Answered with OK or ERROR
+uint32_t tc_login(TcClient* c, const char* name, TcReplyFn fn, void* arg) {
+    LoginMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_LOGIN, sizeof(req), 0);
+    snprintf(req.name, sizeof(req.name), "%s", name);
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Portfolio updates to on_pnl at most every interval_ms (0 = stop); answered with OK
+uint32_t tc_watch(TcClient* c, uint32_t interval_ms, TcReplyFn fn, void* arg) {
+    WatchMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_WATCH, sizeof(req), 0);
+    req.interval_ms = interval_ms;
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Quote stream for one symbol or PROTO_ALL_SYMBOLS: answered with a SNAPSHOT of their
+// current quotes, then QUOTE updates reach on_quote. interval_ms and min_change pace
+// every stream of the connection.
+uint32_t tc_stream(TcClient* c, uint32_t symbol_id, uint32_t interval_ms, double min_change, TcReplyFn fn, void* arg) {
+    StreamMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_STREAM, sizeof(req), 0);
+    req.symbol_id = symbol_id;
+    req.interval_ms = interval_ms;
+    req.min_change = min_change;
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Answered with OK
+uint32_t tc_unstream(TcClient* c, uint32_t symbol_id, TcReplyFn fn, void* arg) {
+    StreamMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_UNSTREAM, sizeof(req), 0);
+    req.symbol_id = symbol_id;
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Answered with SYMBOLS (at most PROTO_MAX_SYMBOLS_PER_LIST names from first_id)
+uint32_t tc_symbols(TcClient* c, uint32_t first_id, TcReplyFn fn, void* arg) {
+    SymbolsReqMsg req;
+    memset(&req, 0, sizeof(req));
+    proto_header(&req.hdr, MSG_SYMBOLS_REQ, sizeof(req), 0);
+    req.first_id = first_id;
+    return submit(c, &req.hdr, fn, arg);
+}
+
+// Requests without a body: MSG_PORTFOLIO_REQ, MSG_SNAPSHOT_REQ, MSG_ORDERS_REQ,
+// MSG_SESSION_REQ, MSG_STATS_REQ or MSG_QUIT
+uint32_t tc_request(TcClient* c, int type, TcReplyFn fn, void* arg) {
+    FrameHeader req;
+    proto_header(&req, type, sizeof(req), 0);
+    return submit(c, &req, fn, arg);
+}
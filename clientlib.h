@@ -0,0 +1,93 @@
+#ifndef CLIENTLIB_H
+#define CLIENTLIB_H
+
+#include <stdint.h>
+#include "protocol.h"
+
+// Embeddable client for the binary protocol: one connection per TcClient, no threads
+// and no global state. The caller owns the event loop: watch tc_fd() for the events
+// tc_events() asks for and call tc_process() when it is ready (or let tc_poll() do
+// both). Requests are encoded into an output buffer, so any number can be in flight;
+// each reply is matched to its request by ID. Frames handed to callbacks point into
+// the receive buffer and are only valid until the callback returns.
+
+// Constants
+#define TC_DEFAULT_PORT 8888
+#define TC_IO_CHUNK 65536
+
+// Connection states
+enum {
+    TC_CONNECTING,              // Non-blocking connect in progress
+    TC_HANDSHAKE,               // Connected; waiting for the welcome text and HELLO
+    TC_READY,                   // HELLO received
+    TC_CLOSED
+};
+
+struct TcClient;
+
+// Reply to one request: FILL, ORDER_ACK, CANCELED, OK, ERROR, PORTFOLIO, SNAPSHOT,
+// SYMBOLS, ORDERS, SESSION, STATS or BYE. frame is NULL when the connection closed
+// before the reply arrived. len covers the whole frame.
+typedef void (*TcReplyFn)(struct TcClient* c, const FrameHeader* frame, int len, void* arg);
+
+// Unsolicited traffic; any callback may be NULL
+typedef struct {
+    void (*on_ready)(struct TcClient* c, const HelloMsg* hello);
+    void (*on_fill)(struct TcClient* c, const FillMsg* fill);       // Every market order fill (before its reply callback)
+    void (*on_exec)(struct TcClient* c, const ExecMsg* exec);       // A resting order traded
+    void (*on_alert)(struct TcClient* c, const AlertMsg* alert);
+    void (*on_quote)(struct TcClient* c, const QuoteMsg* quote);
+    void (*on_pnl)(struct TcClient* c, const PnlMsg* pnl);
+    void (*on_close)(struct TcClient* c, int error);                // 0 = orderly (BYE or EOF)
+} TcCallbacks;
+
+// Request awaiting its reply
+typedef struct {
+    uint32_t request_id;        // 0 once answered out of order (skipped when it reaches the head)
+    TcReplyFn fn;
+    void* arg;
+} TcPending;
+
+typedef struct TcClient {
+    int fd;
+    int state;                  // TC_*
+    int error;                  // errno that closed the connection (0 = orderly)
+    TcCallbacks callbacks;
+    void* user;                 // Free for the caller
+    HelloMsg hello;
+    char* inbuf;
+    int inbuf_len;
+    int inbuf_capacity;
+    char* outbuf;
+    int out_len;
+    int out_capacity;
+    TcPending* pending;         // FIFO ring: the server answers a session in order
+    int pending_head;
+    int pending_count;
+    int pending_capacity;
+    uint32_t next_request_id;
+} TcClient;
+
+// Function prototypes
+int tc_connect(TcClient* c, const char* ip, int port, const TcCallbacks* callbacks);
+void tc_close(TcClient* c);
+int tc_fd(const TcClient* c);
+int tc_events(const TcClient* c);
+int tc_process(TcClient* c, int revents);
+int tc_poll(TcClient* c, int timeout_ms);
+int tc_flush(TcClient* c);
+int tc_pending(const TcClient* c);
+
+uint32_t tc_order(TcClient* c, uint32_t symbol_id, int side, int quantity, TcReplyFn fn, void* arg);
+uint32_t tc_limit(TcClient* c, uint32_t symbol_id, int side, int quantity, double price, TcReplyFn fn, void* arg);
+uint32_t tc_batch(TcClient* c, const BatchOrderEntry* orders, int count, int atomic, TcReplyFn fn, void* arg);
+uint32_t tc_cancel(TcClient* c, uint64_t order_id, TcReplyFn fn, void* arg);
+uint32_t tc_subscribe(TcClient* c, uint32_t symbol_id, double threshold, TcReplyFn fn, void* arg);
+uint32_t tc_login(TcClient* c, const char* name, TcReplyFn fn, void* arg);
+uint32_t tc_watch(TcClient* c, uint32_t interval_ms, TcReplyFn fn, void* arg);
+uint32_t tc_stream(TcClient* c, uint32_t symbol_id, uint32_t interval_ms, double min_change, TcReplyFn fn, void* arg);
+uint32_t tc_unstream(TcClient* c, uint32_t symbol_id, TcReplyFn fn, void* arg);
+uint32_t tc_symbols(TcClient* c, uint32_t first_id, TcReplyFn fn, void* arg);
+uint32_t tc_request(TcClient* c, int type, TcReplyFn fn, void* arg);
+
+#endif
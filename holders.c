@@ -0,0 +1,166 @@
+#include "holders.h"
+#include "accounts.h"
+#include <stdlib.h>
+
+// Incremental mark-to-market. Each holding carries the price it was last valued at
+// and each portfolio the sum of its holdings at those marks (market_value), so a tick
+// only touches the accounts in that symbol's holder list: value += qty * (new - mark).
+// Fills go through holders_fill, which keeps the list and the marks in step.
+
+// Per-symbol holder lists, chunked like the market so they grow with the universe
+static SymbolHolders* holder_chunks[MAX_SYMBOL_CHUNKS];
+
+// Holder list of one listed symbol; its chunk is created on first use
+SymbolHolders* holders_get(int stock_id) {
+    int c = stock_id >> SYMBOL_CHUNK_SHIFT;
+    SymbolHolders* chunk = __atomic_load_n(&holder_chunks[c], __ATOMIC_ACQUIRE);
+
+    if (!chunk) {
+        SymbolHolders* fresh = calloc(SYMBOL_CHUNK_SIZE, sizeof(SymbolHolders));
+        for (int i = 0; i < SYMBOL_CHUNK_SIZE; i++) {
+            pthread_mutex_init(&fresh[i].lock, NULL);
+        }
+        if (__atomic_compare_exchange_n(&holder_chunks[c], &chunk, fresh, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            chunk = fresh;
+        } else {
+            free(fresh); // Another thread won the race; chunk now holds its copy
+        }
+    }
+    return &chunk[stock_id & (SYMBOL_CHUNK_SIZE - 1)];
+}
+
+void holders_destroy_all() {
+    for (int c = 0; c < MAX_SYMBOL_CHUNKS; c++) {
+        if (!holder_chunks[c]) continue;
+        for (int i = 0; i < SYMBOL_CHUNK_SIZE; i++) {
+            free(holder_chunks[c][i].slots);
+            pthread_mutex_destroy(&holder_chunks[c][i].lock);
+        }
+        free(holder_chunks[c]);
+        holder_chunks[c] = NULL;
+    }
+}
+
+// Append account; returns its slot. Caller holds holders->lock.
+static int slot_add(SymbolHolders* holders, Account* account) {
+    if (holders->count == holders->capacity) {
+        int capacity = holders->capacity ? holders->capacity * 2 : HOLDERS_INITIAL_CAPACITY;
+        holders->slots = realloc(holders->slots, sizeof(Account*) * capacity);
+        holders->capacity = capacity;
+    }
+    holders->slots[holders->count] = account;
+    return holders->count++;
+}
+
+// Book one execution (portfolio_fill) and revalue the holding at the current quote.
+// Caller holds holders->lock, then the account lock. Returns the realized P/L.
+double holders_fill(SymbolHolders* holders, Account* account, int stock_id, int side, int qty,
+                    double price, double* cost_basis) {
+    Portfolio* p = &account->portfolio;
+    int holding_idx = find_holding(p, stock_id);
+    double before = 0.0;
+    int pos = -1;
+    if (holding_idx >= 0) {
+        before = p->holdings[holding_idx].quantity * p->holdings[holding_idx].mark_price;
+        pos = p->holdings[holding_idx].holder_pos;
+    }
+
+    double pl = portfolio_fill(p, stock_id, side, qty, price, cost_basis);
+
+    Stock s;
+    market_read(stock_id, &s);
+    holding_idx = find_holding(p, stock_id);
+    if (holding_idx >= 0) {
+        Holding* h = &p->holdings[holding_idx];
+        h->holder_pos = pos >= 0 ? pos : slot_add(holders, account);
+        h->mark_price = s.price;
+        p->market_value += h->quantity * s.price - before;
+    } else {
+        if (pos >= 0) holders->slots[pos] = NULL; // Position closed
+        p->market_value -= before;
+    }
+    if (p->holding_count == 0) p->market_value = 0.0; // No drift left behind
+    p->mark_seq++;
+    return pl;
+}
+
+// Revalue every holder of stock_id at its latest price (producer, once per round)
+void holders_mark(int stock_id) {
+    SymbolHolders* holders = holders_get(stock_id);
+    Stock s;
+    market_read(stock_id, &s);
+
+    pthread_mutex_lock(&holders->lock);
+    int kept = 0;
+    for (int i = 0; i < holders->count; i++) {
+        Account* account = holders->slots[i];
+        if (!account) continue;
+
+        Portfolio* p = &account->portfolio;
+        account_lock(account);
+        int holding_idx = find_holding(p, stock_id);
+        if (holding_idx >= 0) {
+            Holding* h = &p->holdings[holding_idx];
+            if (h->mark_price != s.price) {
+                p->market_value += h->quantity * (s.price - h->mark_price);
+                h->mark_price = s.price;
+                p->mark_seq++;
+            }
+            h->holder_pos = kept;
+            holders->slots[kept++] = account;
+        }
+        account_unlock(account);
+    }
+    holders->count = kept;
+    pthread_mutex_unlock(&holders->lock);
+}
+
+// Enter a recovered account's holdings in the lists and mark them (startup, before
+// any session or producer runs)
+void holders_restore(Account* account) {
+    Portfolio* p = &account->portfolio;
+    p->market_value = 0.0;
+    for (int i = 0; i < p->holding_count; i++) {
+        Holding* h = &p->holdings[i];
+        SymbolHolders* holders = holders_get(h->stock_id);
+        Stock s;
+        market_read(h->stock_id, &s);
+
+        pthread_mutex_lock(&holders->lock);
+        h->holder_pos = slot_add(holders, account);
+        pthread_mutex_unlock(&holders->lock);
+        h->mark_price = s.price;
+        p->market_value += h->quantity * s.price;
+    }
+}
+
+// Take an account that is about to be freed out of every holder list. The slot of
+// a holding is only stable under its list's lock, which ranks above the account
+// lock, so the symbol is looked up first and the slot read once both are held.
+void holders_release(Account* account) {
+    Portfolio* p = &account->portfolio;
+    for (;;) {
+        int stock_id = -1;
+        account_lock(account);
+        for (int i = 0; i < p->holding_count; i++) {
+            if (p->holdings[i].holder_pos >= 0) {
+                stock_id = p->holdings[i].stock_id;
+                break;
+            }
+        }
+        account_unlock(account);
+        if (stock_id < 0) return;
+
+        SymbolHolders* holders = holders_get(stock_id);
+        pthread_mutex_lock(&holders->lock);
+        account_lock(account);
+        int holding_idx = find_holding(p, stock_id);
+        if (holding_idx >= 0 && p->holdings[holding_idx].holder_pos >= 0) {
+            holders->slots[p->holdings[holding_idx].holder_pos] = NULL;
+            p->holdings[holding_idx].holder_pos = -1;
+        }
+        account_unlock(account);
+        pthread_mutex_unlock(&holders->lock);
+    }
+}
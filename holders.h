@@ -0,0 +1,33 @@
+#ifndef HOLDERS_H
+#define HOLDERS_H
+
+#include <pthread.h>
+#include "market.h"
+
+// Constants
+#define HOLDERS_INITIAL_CAPACITY 8
+
+struct Account;
+
+// Structures
+
+// Accounts with a position in one symbol, so a tick revalues only those accounts.
+// A holding remembers its slot; closing the position leaves a hole that the next
+// mark pass squeezes out (that pass already holds each account's lock).
+typedef struct {
+    pthread_mutex_t lock;       // Taken before any account lock (book, holders, account)
+    struct Account** slots;     // NULL = hole left by a closed position
+    int count;                  // Slots in use, holes included
+    int capacity;
+} SymbolHolders;
+
+// Function prototypes
+SymbolHolders* holders_get(int stock_id);
+void holders_destroy_all();
+double holders_fill(SymbolHolders* holders, struct Account* account, int stock_id, int side, int qty,
+                    double price, double* cost_basis);
+void holders_mark(int stock_id);
+void holders_restore(struct Account* account);
+void holders_release(struct Account* account);
+
+#endif
@@ -0,0 +1,698 @@
+#include "journal.h"
+#include "accounts.h"
+#include "holders.h"
+#include "reactor.h"
+#include "protocol.h"
+#include "log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Write-ahead trade journal. Every fill and every new named account is appended as a
+// fixed-size record while the account lock is held, so record order matches the order
+// the portfolios changed. Appends only copy into a memory buffer; a writer thread
+// swaps the buffer out, writes it and makes it durable with one fdatasync (group
+// commit: however many trades arrived during the previous sync share the next one).
+// Replies that report a trade are held by the reactors until their record is durable.
+//
+// The journal is cut into segments by snapshots of the account store, written by a
+// thread of their own while commits go on. Startup loads the newest snapshot and
+// replays the segments after it; a record is applied only if it is newer than its
+// account's last_seq, so a snapshot taken while trading goes on is still exact.
+
+extern volatile sig_atomic_t server_running;
+
+static int enabled = 0;
+static int journal_fd = -1;
+static off_t journal_size = 0;          // Bytes of the segment known to hold whole, synced records
+static int journal_failed = 0;          // A batch could not be made durable: nothing more is written
+static char journal_path[PATH_MAX];
+static char old_path[PATH_MAX];         // Segment covered by the snapshot being written
+static char snapshot_path[PATH_MAX];
+static char temp_path[PATH_MAX];
+
+static pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER; // Append buffer and sequence
+static pthread_cond_t journal_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writer_tid;
+static int writer_running = 0;
+static JournalRecord* active;           // Appends go here
+static int active_count = 0;
+static int active_capacity = 0;
+static JournalRecord* writing;          // Writer-private buffer swapped with active
+static int writing_capacity = 0;
+static uint64_t last_seq = 0;           // Last sequence number handed out
+static uint64_t durable_seq = 0;        // Every record up to here is on disk
+
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER; // Checkpoint handoff
+static pthread_cond_t snapshot_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t snapshot_tid;
+static int snapshot_running = 0;
+static int snapshot_busy = 0;           // A checkpoint is queued for or running on the snapshot thread
+static uint64_t snapshot_seq = 0;       // Records up to here are covered by that checkpoint
+
+static __thread uint64_t thread_seq;    // Newest record appended by this thread
+
+static uint32_t crc_table[256];
+
+static void crc_init() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32(uint32_t crc, const void* data, size_t len) {
+    const unsigned char* p = data;
+    crc = ~crc;
+    while (len--) crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t record_crc(const JournalRecord* rec) {
+    return crc32(0, (const char*)rec + sizeof(rec->crc), sizeof(*rec) - sizeof(rec->crc));
+}
+
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void journal_error(const char* what, const char* path) {
+    char msg[PATH_MAX + 128]; // Cut to LOG_TEXT_LEN by the logger
+    snprintf(msg, sizeof(msg), "ERROR: Journal %s %s: %s", what, path, strerror(errno));
+    log_message(msg);
+}
+
+static int write_all(int fd, const void* data, size_t len) {
+    const char* p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Make a rename or unlink in the journal's directory durable
+static void sync_directory(const char* path) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char* slash = strrchr(dir, '/');
+    if (slash) *(slash == dir ? slash + 1 : slash) = '\0';
+    else snprintf(dir, sizeof(dir), ".");
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+// Start an empty segment at path
+static int segment_create(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        journal_error("create", path);
+        return -1;
+    }
+
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    if (write_all(fd, &header, sizeof(header)) < 0 || fdatasync(fd) < 0) {
+        journal_error("write", path);
+        close(fd);
+        return -1;
+    }
+    sync_directory(path);
+    return fd;
+}
+
+// --- Snapshots ---
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+    uint32_t count;
+    int failed;
+} SnapshotBuffer;
+
+static void snapshot_put(SnapshotBuffer* buf, const void* data, size_t len) {
+    if (buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity * 2 : 64 * 1024;
+        while (capacity < buf->len + len) capacity *= 2;
+        char* grown = realloc(buf->data, capacity);
+        if (!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+// accounts_each callback; runs under the account's shard lock. Resting orders do not
+// survive a restart, so what they set aside is recorded as released.
+static void snapshot_account(Account* account, void* ctx) {
+    SnapshotBuffer* buf = ctx;
+    Portfolio* p = &account->portfolio;
+
+    SnapshotAccount entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id = account->id;
+    entry.holding_count = p->holding_count;
+    entry.last_seq = account->last_seq;
+    entry.wallet_balance = p->wallet_balance + p->reserved_cash;
+    entry.total_invested = p->total_invested;
+    snprintf(entry.name, sizeof(entry.name), "%s", account->name);
+    snapshot_put(buf, &entry, sizeof(entry));
+
+    for (int i = 0; i < p->holding_count; i++) {
+        SnapshotHolding h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.symbol, market_stock(p->holdings[i].stock_id)->symbol, SYMBOL_LEN);
+        h.quantity = p->holdings[i].quantity;
+        h.avg_buy_price = p->holdings[i].avg_buy_price;
+        snapshot_put(buf, &h, sizeof(h));
+    }
+    buf->count++;
+}
+
+// Write every named account to a new snapshot and atomically replace the old one.
+// Records up to seq are on disk and reflected in the accounts copied here.
+static int snapshot_write(uint64_t seq) {
+    SnapshotBuffer buf;
+    memset(&buf, 0, sizeof(buf));
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    snapshot_put(&buf, &header, sizeof(header));
+    accounts_each(snapshot_account, &buf);
+    if (buf.failed) {
+        free(buf.data);
+        log_message("ERROR: Journal snapshot: out of memory");
+        return -1;
+    }
+
+    JournalHeader* h = (JournalHeader*)buf.data;
+    memcpy(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic));
+    h->version = JOURNAL_VERSION;
+    h->count = buf.count;
+    h->seq = seq;
+    uint32_t crc = crc32(0, buf.data, buf.len);
+    snapshot_put(&buf, &crc, sizeof(crc));
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int ok = fd >= 0 && !buf.failed && write_all(fd, buf.data, buf.len) == 0 && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    free(buf.data);
+    if (!ok || rename(temp_path, snapshot_path) < 0) {
+        journal_error("snapshot", temp_path);
+        unlink(temp_path);
+        return -1;
+    }
+    sync_directory(snapshot_path);
+    return 0;
+}
+
+// Start a new segment; the old one goes once a snapshot covers it. A segment left by a
+// failed snapshot is kept (and replayed) until a snapshot succeeds, so no new one is cut.
+static void journal_rotate() {
+    if (access(old_path, F_OK) == 0) return;
+    if (rename(journal_path, old_path) < 0) {
+        journal_error("rotate", journal_path);
+        return;
+    }
+    int fd = segment_create(journal_path);
+    if (fd < 0) {
+        // Keep appending to the old segment; it is still the newest one
+        rename(old_path, journal_path);
+        return;
+    }
+    close(journal_fd);
+    journal_fd = fd;
+    journal_size = sizeof(JournalHeader);
+}
+
+// Writer: rotate and hand the snapshot of records up to seq to the snapshot thread, so
+// walking the accounts never delays a commit. Returns 0 if the last one is still running.
+static int journal_checkpoint(uint64_t seq) {
+    pthread_mutex_lock(&snapshot_mutex);
+    int idle = !snapshot_busy;
+    if (idle) {
+        journal_rotate();
+        snapshot_seq = seq;
+        snapshot_busy = 1;
+        pthread_cond_broadcast(&snapshot_cond);
+    }
+    pthread_mutex_unlock(&snapshot_mutex);
+    return idle;
+}
+
+static void* snapshot_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&snapshot_mutex);
+    for (;;) {
+        while (!snapshot_busy && snapshot_running) pthread_cond_wait(&snapshot_cond, &snapshot_mutex);
+        if (!snapshot_busy) break;
+        uint64_t seq = snapshot_seq;
+        pthread_mutex_unlock(&snapshot_mutex);
+
+        if (snapshot_write(seq) == 0) {
+            unlink(old_path);
+            sync_directory(old_path);
+        }
+
+        pthread_mutex_lock(&snapshot_mutex);
+        snapshot_busy = 0;
+        pthread_cond_broadcast(&snapshot_cond);
+    }
+    pthread_mutex_unlock(&snapshot_mutex);
+    return NULL;
+}
+
+// Runs a queued checkpoint, if any, before the thread exits
+static void snapshot_stop() {
+    pthread_mutex_lock(&snapshot_mutex);
+    snapshot_running = 0;
+    pthread_cond_broadcast(&snapshot_cond);
+    pthread_mutex_unlock(&snapshot_mutex);
+    pthread_join(snapshot_tid, NULL);
+}
+
+// --- Writer ---
+
+// Write one swapped-out batch and make it durable, then release the replies waiting on it.
+// A failed write or sync is cut off the segment again (a torn record mid-segment would end
+// recovery there) and retried; the replies stay held meanwhile. If the server stops before
+// the batch gets through, nothing after it is written either.
+static void journal_commit(JournalRecord* records, int count) {
+    if (journal_failed) return;
+    size_t len = sizeof(JournalRecord) * count;
+    for (int i = 0; i < count; i++) records[i].crc = record_crc(&records[i]);
+
+    int64_t backoff_ns = JOURNAL_RETRY_MIN_NS;
+    while (write_all(journal_fd, records, len) < 0 || fdatasync(journal_fd) < 0) {
+        journal_error("write", journal_path);
+        if (ftruncate(journal_fd, journal_size) < 0) journal_error("truncate", journal_path);
+        if (!server_running) {
+            char msg[LOG_TEXT_LEN];
+            snprintf(msg, sizeof(msg), "ERROR: Journal stopped; records from seq %" PRIu64 " are not durable",
+                     records[0].seq);
+            log_message(msg);
+            journal_failed = 1;
+            return;
+        }
+        struct timespec ts = {backoff_ns / 1000000000, backoff_ns % 1000000000};
+        nanosleep(&ts, NULL);
+        if (backoff_ns < JOURNAL_RETRY_MAX_NS) backoff_ns *= 2;
+    }
+    journal_size += len;
+    __atomic_store_n(&durable_seq, records[count - 1].seq, __ATOMIC_RELEASE);
+    if (server_running) reactor_wake_all();
+}
+
+static void* journal_thread(void* arg) {
+    (void)arg;
+    uint64_t since_snapshot = 0;
+    int64_t snapshot_ns = monotonic_ns();
+
+    pthread_mutex_lock(&journal_mutex);
+    for (;;) {
+        while (active_count == 0 && writer_running) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += 1;
+            pthread_cond_timedwait(&journal_cond, &journal_mutex, &deadline);
+            if (since_snapshot && monotonic_ns() - snapshot_ns >= JOURNAL_SNAPSHOT_SECONDS * 1000000000LL) break;
+        }
+        if (active_count == 0 && !writer_running) break;
+
+        // Swap buffers so appends continue while this batch is written
+        JournalRecord* batch = active;
+        int count = active_count;
+        int capacity = active_capacity;
+        active = writing;
+        active_capacity = writing_capacity;
+        active_count = 0;
+        uint64_t seq = last_seq;
+        pthread_mutex_unlock(&journal_mutex);
+        writing = batch;
+        writing_capacity = capacity;
+
+        if (count > 0) {
+            journal_commit(batch, count);
+            since_snapshot += count;
+        }
+        if ((since_snapshot >= JOURNAL_SNAPSHOT_RECORDS ||
+             (since_snapshot && monotonic_ns() - snapshot_ns >= JOURNAL_SNAPSHOT_SECONDS * 1000000000LL)) &&
+            journal_checkpoint(seq)) {
+            since_snapshot = 0;
+            snapshot_ns = monotonic_ns();
+        }
+        pthread_mutex_lock(&journal_mutex);
+    }
+    pthread_mutex_unlock(&journal_mutex);
+
+    // Clean shutdown: the next start only has to load the snapshot
+    if (since_snapshot) {
+        pthread_mutex_lock(&snapshot_mutex);
+        while (snapshot_busy) pthread_cond_wait(&snapshot_cond, &snapshot_mutex);
+        pthread_mutex_unlock(&snapshot_mutex);
+        journal_checkpoint(last_seq);
+    }
+    return NULL;
+}
+
+static uint64_t append(int type, uint32_t account_id, const char* text, int side, int quantity, double price) {
+    if (!enabled) return 0;
+
+    pthread_mutex_lock(&journal_mutex);
+    if (!enabled) { // Closed while this thread was waiting
+        pthread_mutex_unlock(&journal_mutex);
+        return 0;
+    }
+    if (active_count == active_capacity) {
+        int capacity = active_capacity * 2;
+        JournalRecord* grown = realloc(active, sizeof(JournalRecord) * capacity);
+        if (!grown) {
+            pthread_mutex_unlock(&journal_mutex);
+            log_message("ERROR: Journal buffer full; record lost");
+            return 0;
+        }
+        active = grown;
+        active_capacity = capacity;
+    }
+
+    JournalRecord* rec = &active[active_count++];
+    memset(rec, 0, sizeof(*rec));
+    rec->type = type;
+    rec->side = side;
+    rec->seq = ++last_seq;
+    rec->account_id = account_id;
+    rec->quantity = quantity;
+    rec->price = price;
+    snprintf(rec->text, sizeof(rec->text), "%s", text);
+    uint64_t seq = rec->seq;
+    if (active_count == 1) pthread_cond_signal(&journal_cond);
+    pthread_mutex_unlock(&journal_mutex);
+
+    thread_seq = seq;
+    return seq;
+}
+
+// Journal a new named account; caller holds its shard lock. Returns the record's sequence number.
+uint64_t journal_account(uint32_t account_id, const char* name, double balance) {
+    return append(JOURNAL_OPEN, account_id, name, 0, 0, balance);
+}
+
+// Journal one execution; caller holds the account lock. Returns the record's sequence number.
+uint64_t journal_fill(uint32_t account_id, const char* symbol, int side, int quantity, double price) {
+    return append(JOURNAL_FILL, account_id, symbol, side, quantity, price);
+}
+
+// Newest sequence number known to be on disk
+uint64_t journal_durable() {
+    return __atomic_load_n(&durable_seq, __ATOMIC_ACQUIRE);
+}
+
+// Newest record appended by the calling thread (0 if none)
+uint64_t journal_last() {
+    return thread_seq;
+}
+
+// --- Recovery ---
+
+// Account ID -> account while replaying (open addressing, IDs are never 0)
+typedef struct {
+    Account** slots;
+    uint32_t mask;
+    uint32_t count;
+} AccountMap;
+
+static Account* map_get(AccountMap* map, uint32_t id) {
+    if (!map->slots) return NULL;
+    for (uint32_t i = (id * 2654435761u) & map->mask;; i = (i + 1) & map->mask) {
+        if (!map->slots[i]) return NULL;
+        if (map->slots[i]->id == id) return map->slots[i];
+    }
+}
+
+static void map_put(AccountMap* map, Account* account) {
+    if ((map->count + 1) * 2 > map->mask + 1 || !map->slots) {
+        AccountMap grown = {NULL, map->slots ? map->mask * 2 + 1 : 1023, 0};
+        grown.slots = calloc(grown.mask + 1, sizeof(Account*));
+        for (uint32_t i = 0; map->slots && i <= map->mask; i++) {
+            if (map->slots[i]) map_put(&grown, map->slots[i]);
+        }
+        free(map->slots);
+        *map = grown;
+    }
+    uint32_t i = (account->id * 2654435761u) & map->mask;
+    while (map->slots[i] && map->slots[i] != account) i = (i + 1) & map->mask;
+    if (!map->slots[i]) map->count++;
+    map->slots[i] = account;
+}
+
+// Symbol ID for a journaled symbol, listing it if the symbol file no longer does
+static int recovered_stock(const char* symbol, double price) {
+    int stock_id = find_stock(symbol);
+    if (stock_id < 0) stock_id = market_add_symbol(symbol, price > 0.0 ? price : 1.0, DEFAULT_VOLUME, 0.0);
+    return stock_id;
+}
+
+// Map a whole file read-only; returns its size, 0 if missing or empty, -1 on error
+static ssize_t map_file(const char* path, const char** data) {
+    *data = NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    *data = map;
+    return st.st_size;
+}
+
+// Load the snapshot into the account store; returns its sequence number, -1 if unusable
+static int64_t snapshot_load(AccountMap* map) {
+    const char* data;
+    ssize_t size = map_file(snapshot_path, &data);
+    if (size <= 0) {
+        if (size < 0) journal_error("open", snapshot_path);
+        return size;
+    }
+
+    const JournalHeader* header = (const JournalHeader*)data;
+    uint32_t crc;
+    if ((size_t)size < sizeof(*header) + sizeof(crc) ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != JOURNAL_VERSION) {
+        log_message("ERROR: Journal snapshot has an unknown format");
+        munmap((void*)data, size);
+        return -1;
+    }
+    memcpy(&crc, data + size - sizeof(crc), sizeof(crc));
+    if (crc32(0, data, size - sizeof(crc)) != crc) {
+        log_message("ERROR: Journal snapshot is corrupt");
+        munmap((void*)data, size);
+        return -1;
+    }
+
+    size_t pos = sizeof(*header);
+    size_t end = size - sizeof(crc);
+    for (uint32_t n = 0; n < header->count && pos + sizeof(SnapshotAccount) <= end; n++) {
+        SnapshotAccount entry;
+        memcpy(&entry, data + pos, sizeof(entry));
+        pos += sizeof(entry);
+        entry.name[JOURNAL_NAME_LEN - 1] = '\0';
+
+        Account* account = account_restore(entry.name, entry.id, entry.wallet_balance);
+        if (account) {
+            account->last_seq = entry.last_seq;
+            account->portfolio.total_invested = entry.total_invested;
+            map_put(map, account);
+        }
+        for (int i = 0; i < entry.holding_count && pos + sizeof(SnapshotHolding) <= end; i++) {
+            SnapshotHolding h;
+            memcpy(&h, data + pos, sizeof(h));
+            pos += sizeof(h);
+            h.symbol[SYMBOL_LEN - 1] = '\0';
+            int stock_id = account ? recovered_stock(h.symbol, h.avg_buy_price) : -1;
+            if (stock_id < 0 || find_holding(&account->portfolio, stock_id) >= 0) continue;
+            Holding* holding = add_holding(&account->portfolio, stock_id);
+            holding->quantity = h.quantity;
+            holding->avg_buy_price = h.avg_buy_price;
+        }
+    }
+
+    int64_t seq = (int64_t)header->seq;
+    munmap((void*)data, size);
+    return seq;
+}
+
+// Apply a segment's records up to the first torn or corrupt one; *max_seq tracks the
+// newest valid record. Returns records applied, -1 if the file is not a journal.
+static int64_t segment_replay(const char* path, AccountMap* map, uint64_t* max_seq) {
+    const char* data;
+    ssize_t size = map_file(path, &data);
+    if (size <= 0) {
+        if (size < 0) journal_error("open", path);
+        return size;
+    }
+
+    const JournalHeader* header = (const JournalHeader*)data;
+    if ((size_t)size < sizeof(*header) || memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0) {
+        char msg[PATH_MAX + 64];
+        snprintf(msg, sizeof(msg), "ERROR: %s is not a trade journal", path);
+        log_message(msg);
+        munmap((void*)data, size);
+        return -1;
+    }
+
+    int64_t applied = 0;
+    const JournalRecord* rec = (const JournalRecord*)(data + sizeof(*header));
+    const JournalRecord* end = rec + (size - sizeof(*header)) / sizeof(JournalRecord);
+    for (; rec < end; rec++) {
+        if (rec->crc != record_crc(rec)) break;
+        if (rec->seq > *max_seq) *max_seq = rec->seq;
+
+        char text[JOURNAL_NAME_LEN];
+        memcpy(text, rec->text, sizeof(text));
+        text[JOURNAL_NAME_LEN - 1] = '\0';
+        Account* account = map_get(map, rec->account_id);
+
+        if (rec->type == JOURNAL_OPEN) {
+            if (account) continue;
+            account = account_restore(text, rec->account_id, rec->price);
+            if (!account) continue;
+            account->last_seq = rec->seq;
+            map_put(map, account);
+        } else if (rec->type == JOURNAL_FILL) {
+            if (!account || rec->seq <= account->last_seq) continue;
+            int stock_id = recovered_stock(text, rec->price);
+            if (stock_id < 0) continue;
+            double cost_basis = 0.0;
+            portfolio_fill(&account->portfolio, stock_id, rec->side, rec->quantity, rec->price, &cost_basis);
+            account->last_seq = rec->seq;
+        } else {
+            continue;
+        }
+        applied++;
+    }
+    if (rec < end || (size - sizeof(*header)) % sizeof(JournalRecord)) {
+        char msg[PATH_MAX + 64];
+        snprintf(msg, sizeof(msg), "Journal %s: torn tail after seq %" PRIu64 " ignored", path, *max_seq);
+        log_message(msg);
+    }
+    munmap((void*)data, size);
+    return applied;
+}
+
+// Recover the account store from PREFIX.snapshot and PREFIX.journal, checkpoint it,
+// and start journaling. NULL prefix leaves durability off. Returns -1 if the files
+// are unusable (the server should not start over them).
+int journal_open(const char* prefix) {
+    if (!prefix) {
+        log_message("Journal disabled: balances will not survive a restart");
+        return 0;
+    }
+
+    snprintf(journal_path, sizeof(journal_path), "%s.journal", prefix);
+    snprintf(old_path, sizeof(old_path), "%s.journal.old", prefix);
+    snprintf(snapshot_path, sizeof(snapshot_path), "%s.snapshot", prefix);
+    snprintf(temp_path, sizeof(temp_path), "%s.snapshot.tmp", prefix);
+    crc_init();
+
+    int64_t start = monotonic_ns();
+    AccountMap map = {NULL, 0, 0};
+    int64_t snapshot_seq = snapshot_load(&map);
+    uint64_t max_seq = snapshot_seq > 0 ? (uint64_t)snapshot_seq : 0;
+    int64_t replayed_old = snapshot_seq < 0 ? -1 : segment_replay(old_path, &map, &max_seq);
+    int64_t replayed = replayed_old < 0 ? -1 : segment_replay(journal_path, &map, &max_seq);
+    uint32_t recovered = map.count;
+    for (uint32_t i = 0; map.slots && i <= map.mask; i++) {
+        if (map.slots[i]) holders_restore(map.slots[i]);
+    }
+    free(map.slots);
+    if (replayed < 0) return -1;
+
+    last_seq = durable_seq = max_seq;
+    if (snapshot_write(last_seq) < 0) return -1;
+    unlink(old_path);
+    journal_fd = segment_create(journal_path);
+    if (journal_fd < 0) return -1;
+    journal_size = sizeof(JournalHeader);
+
+    active_capacity = writing_capacity = JOURNAL_INITIAL_RECORDS;
+    active = malloc(sizeof(JournalRecord) * active_capacity);
+    writing = malloc(sizeof(JournalRecord) * writing_capacity);
+    snapshot_running = 1;
+    if (pthread_create(&snapshot_tid, NULL, snapshot_thread, NULL) != 0) {
+        log_message("ERROR: Journal snapshot thread creation failed");
+        snapshot_running = 0;
+        return -1;
+    }
+    enabled = 1;
+    writer_running = 1;
+    if (pthread_create(&writer_tid, NULL, journal_thread, NULL) != 0) {
+        log_message("ERROR: Journal thread creation failed");
+        enabled = writer_running = 0;
+        snapshot_stop();
+        return -1;
+    }
+
+    char msg[LOG_TEXT_LEN];
+    snprintf(msg, sizeof(msg), "Journal: %d account(s), %" PRId64 " record(s) replayed in %.1f ms",
+             (int)recovered, replayed_old + replayed, (monotonic_ns() - start) / 1e6);
+    log_message(msg);
+    return 0;
+}
+
+// Stop appending, write what is buffered and leave a snapshot for the next start
+void journal_close() {
+    if (!enabled) return;
+
+    pthread_mutex_lock(&journal_mutex);
+    enabled = 0;
+    writer_running = 0;
+    pthread_cond_signal(&journal_cond);
+    pthread_mutex_unlock(&journal_mutex);
+    pthread_join(writer_tid, NULL);
+
+    snapshot_stop();
+
+    close(journal_fd);
+    journal_fd = -1;
+    free(active);
+    free(writing);
+    active = writing = NULL;
+}
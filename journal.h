@@ -0,0 +1,69 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include "market.h"
+
+// Constants
+#define JOURNAL_DEFAULT_PREFIX "trades"     // trades.journal + trades.snapshot
+#define JOURNAL_MAGIC "TJRNL01"
+#define SNAPSHOT_MAGIC "TSNAP01"
+#define JOURNAL_VERSION 1
+#define JOURNAL_INITIAL_RECORDS 4096        // Append buffer, doubled under load
+#define JOURNAL_SNAPSHOT_RECORDS 1000000    // Rotate and snapshot after this many records...
+#define JOURNAL_SNAPSHOT_SECONDS 300        // ...or this long after the last snapshot, if any were written
+#define JOURNAL_NAME_LEN 32
+#define JOURNAL_RETRY_MIN_NS 10000000LL     // Failed commits are retried after 10 ms,
+#define JOURNAL_RETRY_MAX_NS 1000000000LL   // backing off to once a second
+
+enum { JOURNAL_OPEN = 1, JOURNAL_FILL = 2 };
+
+// Structures
+
+// One 64-byte journal entry. crc covers everything after it; a short or corrupt
+// record ends recovery (a torn tail left by a crash mid-write).
+typedef struct {
+    uint32_t crc;
+    uint16_t type;                  // JOURNAL_OPEN / JOURNAL_FILL
+    uint8_t side;                   // SIDE_BUY / SIDE_SELL (fills)
+    uint8_t reserved;
+    uint64_t seq;                   // Dense, starting at 1 across restarts
+    uint32_t account_id;
+    int32_t quantity;
+    double price;                   // Fill price, or opening balance
+    char text[JOURNAL_NAME_LEN];    // Account name (open) or symbol (fill)
+} JournalRecord;
+
+// Start of every journal segment and snapshot file
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;                 // Snapshot: accounts that follow (0 in journals)
+    uint64_t seq;                   // Snapshot: every record up to seq is included
+} JournalHeader;
+
+// Snapshot entry, followed by holding_count SnapshotHolding entries
+typedef struct {
+    uint32_t id;
+    int32_t holding_count;
+    uint64_t last_seq;              // Newest journal record already applied
+    double wallet_balance;          // Cash set aside for resting orders included
+    double total_invested;
+    char name[JOURNAL_NAME_LEN];
+} SnapshotAccount;
+
+typedef struct {
+    char symbol[SYMBOL_LEN];
+    int32_t quantity;
+    double avg_buy_price;
+} SnapshotHolding;
+
+// Function prototypes
+int journal_open(const char* prefix);
+void journal_close();
+uint64_t journal_account(uint32_t account_id, const char* name, double balance);
+uint64_t journal_fill(uint32_t account_id, const char* symbol, int side, int quantity, double price);
+uint64_t journal_durable();
+uint64_t journal_last();
+
+#endif
@@ -0,0 +1,203 @@
+#include "log.h"
+#include "market.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+static FILE* log_file;
+static LogRing* rings[MAX_LOG_RINGS];
+static int ring_count = 0;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER; // Registration only
+static uint64_t unregistered_dropped = 0;   // Threads that found no free ring
+static pthread_t writer_tid;
+static volatile int writer_running = 0;
+static uint64_t dropped_reported = 0;
+
+static __thread LogRing* my_ring;
+
+// This thread's ring, registered on first use
+static LogRing* thread_ring() {
+    if (my_ring) return my_ring;
+
+    pthread_mutex_lock(&ring_mutex);
+    if (ring_count < MAX_LOG_RINGS) {
+        my_ring = calloc(1, sizeof(LogRing));
+        if (my_ring) {
+            __atomic_store_n(&rings[ring_count], my_ring, __ATOMIC_RELEASE);
+            __atomic_store_n(&ring_count, ring_count + 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&ring_mutex);
+    return my_ring;
+}
+
+// Claim the next free record in this thread's ring, or NULL (and count a drop)
+static LogRecord* reserve() {
+    LogRing* r = thread_ring();
+    if (!r) {
+        __atomic_add_fetch(&unregistered_dropped, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (r->head - tail >= LOG_RING_SIZE) {
+        __atomic_add_fetch(&r->dropped, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    LogRecord* rec = &r->records[r->head & (LOG_RING_SIZE - 1)];
+    rec->ts_ns = realtime_ns();
+    return rec;
+}
+
+static void commit() {
+    __atomic_store_n(&my_ring->head, my_ring->head + 1, __ATOMIC_RELEASE);
+}
+
+// Free-form log line (copied, truncated to LOG_TEXT_LEN)
+void log_message(const char* message) {
+    LogRecord* rec = reserve();
+    if (!rec) return;
+    rec->event = LOG_TEXT;
+    strncpy(rec->text, message, LOG_TEXT_LEN - 1);
+    rec->text[LOG_TEXT_LEN - 1] = '\0';
+    commit();
+}
+
+// Hot-path log entry: no formatting, no I/O, never blocks
+void log_event(int event, int64_t i0, int64_t i1, int64_t i2, double d0, double d1) {
+    LogRecord* rec = reserve();
+    if (!rec) return;
+    rec->event = event;
+    rec->i[0] = i0;
+    rec->i[1] = i1;
+    rec->i[2] = i2;
+    rec->d[0] = d0;
+    rec->d[1] = d1;
+    commit();
+}
+
+uint64_t log_dropped() {
+    uint64_t total = __atomic_load_n(&unregistered_dropped, __ATOMIC_RELAXED);
+    int count = __atomic_load_n(&ring_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        total += __atomic_load_n(&rings[i]->dropped, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+// Render one record as "[ctime] message"
+static void format_record(const LogRecord* rec, FILE* out) {
+    char timestamp[26];
+    time_t secs = rec->ts_ns / 1000000000;
+    ctime_r(&secs, timestamp);
+    timestamp[24] = '\0'; // Remove trailing newline from ctime_r
+
+    const char* symbol = "?";
+    if (rec->event == LOG_PRICE_UPDATE || rec->event == LOG_TRADE_BUY || rec->event == LOG_TRADE_SELL) {
+        int stock_id = (int)(rec->event == LOG_PRICE_UPDATE ? rec->i[0] : rec->i[1]);
+        if (stock_id >= 0 && stock_id < market_symbol_count()) symbol = market_stock(stock_id)->symbol;
+    }
+
+    switch (rec->event) {
+    case LOG_PRICE_UPDATE:
+        fprintf(out, "[%s] Price update: %s $%.2f (%+.2f%%)\n", timestamp, symbol, rec->d[0], rec->d[1]);
+        break;
+    case LOG_TRADE_BUY:
+        fprintf(out, "[%s] Client User%lld bought %lld %s at $%.2f\n", timestamp,
+                (long long)rec->i[0], (long long)rec->i[2], symbol, rec->d[0]);
+        break;
+    case LOG_TRADE_SELL:
+        fprintf(out, "[%s] Client User%lld sold %lld %s at $%.2f (P/L: $%.2f)\n", timestamp,
+                (long long)rec->i[0], (long long)rec->i[2], symbol, rec->d[0], rec->d[1]);
+        break;
+    default:
+        fprintf(out, "[%s] %s\n", timestamp, rec->text);
+        break;
+    }
+}
+
+// Format everything currently queued, merged across rings in timestamp order;
+// returns the number of records written
+static int drain_rings() {
+    uint64_t heads[MAX_LOG_RINGS];
+    uint64_t tails[MAX_LOG_RINGS];
+    int written = 0;
+    int count = __atomic_load_n(&ring_count, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < count; i++) {
+        heads[i] = __atomic_load_n(&rings[i]->head, __ATOMIC_ACQUIRE);
+        tails[i] = rings[i]->tail;
+    }
+
+    while (written < LOG_BATCH * count) {
+        int next = -1;
+        for (int i = 0; i < count; i++) {
+            if (tails[i] == heads[i]) continue;
+            if (next < 0 || rings[i]->records[tails[i] & (LOG_RING_SIZE - 1)].ts_ns <
+                            rings[next]->records[tails[next] & (LOG_RING_SIZE - 1)].ts_ns) {
+                next = i;
+            }
+        }
+        if (next < 0) break;
+
+        const LogRecord* rec = &rings[next]->records[tails[next] & (LOG_RING_SIZE - 1)];
+        format_record(rec, log_file);
+        format_record(rec, stdout); // Also print to console
+        tails[next]++;
+        written++;
+    }
+
+    // Hand the consumed slots back to their owners
+    for (int i = 0; i < count; i++) {
+        __atomic_store_n(&rings[i]->tail, tails[i], __ATOMIC_RELEASE);
+    }
+
+    // Surface losses in the log itself
+    uint64_t dropped = log_dropped();
+    if (dropped != dropped_reported) {
+        fprintf(log_file, "[log] %llu message(s) dropped (ring full)\n",
+                (unsigned long long)(dropped - dropped_reported));
+        dropped_reported = dropped;
+    }
+
+    if (written > 0) {
+        fflush(log_file);
+        fflush(stdout);
+    }
+    return written;
+}
+
+// Background writer: batches records from every ring into server.log and the console
+static void* writer_thread(void* arg) {
+    (void)arg;
+    while (__atomic_load_n(&writer_running, __ATOMIC_ACQUIRE)) {
+        if (drain_rings() == 0) usleep(LOG_IDLE_US);
+    }
+    while (drain_rings() > 0) {}
+    return NULL;
+}
+
+// Open the log file and start the writer thread
+int log_init(const char* path) {
+    log_file = fopen(path, "a");
+    if (!log_file) return -1;
+    writer_running = 1;
+    if (pthread_create(&writer_tid, NULL, writer_thread, NULL) != 0) {
+        fclose(log_file);
+        log_file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Flush everything queued so far, stop the writer and close the file
+void log_shutdown() {
+    if (!log_file) return;
+    __atomic_store_n(&writer_running, 0, __ATOMIC_RELEASE);
+    pthread_join(writer_tid, NULL);
+    fclose(log_file);
+    log_file = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+// Constants
+#define LOG_RING_SIZE 4096          // Records per thread (power of two)
+#define MAX_LOG_RINGS 64            // Threads that can hold a ring
+#define LOG_TEXT_LEN 80
+#define LOG_BATCH 256               // Records formatted per ring per pass
+#define LOG_IDLE_US 2000            // Writer sleep when every ring is empty
+
+// Binary log events; arguments are formatted by the writer thread
+enum {
+    LOG_TEXT = 0,                   // text
+    LOG_PRICE_UPDATE,               // i0 = stock_id, d0 = price, d1 = change_percent
+    LOG_TRADE_BUY,                  // i0 = client_id, i1 = stock_id, i2 = qty, d0 = price
+    LOG_TRADE_SELL                  // i0 = client_id, i1 = stock_id, i2 = qty, d0 = price, d1 = profit
+};
+
+// Structures
+typedef struct {
+    int64_t ts_ns;                  // CLOCK_REALTIME at the call site
+    int32_t event;
+    int32_t reserved;
+    int64_t i[3];
+    double d[2];
+    char text[LOG_TEXT_LEN];
+} LogRecord;
+
+// Single-producer/single-consumer ring owned by one logging thread
+typedef struct {
+    LogRecord records[LOG_RING_SIZE];
+    uint64_t head;                  // Next slot the owner writes
+    char pad[56];
+    uint64_t tail;                  // Next slot the writer reads
+    uint64_t dropped;               // Records lost because the ring was full
+} LogRing;
+
+// Function prototypes
+int log_init(const char* path);
+void log_shutdown();
+void log_message(const char* message);
+void log_event(int event, int64_t i0, int64_t i1, int64_t i2, double d0, double d1);
+uint64_t log_dropped();
+
+#endif
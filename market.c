@@ -0,0 +1,282 @@
+#include "market.h"
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+MarketData market_data;
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Upper-case a symbol into out; returns its length or -1 if it does not fit
+static int normalize_symbol(const char* symbol, char* out) {
+    int len = 0;
+    while (symbol[len]) {
+        if (len == SYMBOL_LEN - 1) return -1;
+        out[len] = toupper((unsigned char)symbol[len]);
+        len++;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// FNV-1a over the normalized symbol
+static uint32_t symbol_hash(const char* symbol) {
+    uint32_t h = 2166136261u;
+    while (*symbol) {
+        h ^= (unsigned char)*symbol++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Helper function to initialize market data from the symbol file
+void init_market_data(const char* path) {
+    const char* symbols[] = {"AAPL", "GOOGL", "MSFT", "TSLA", "AMZN", "NFLX", "META", "NVDA", "AMD", "INTC"};
+    double prices[] = {150.00, 2800.00, 300.00, 250.00, 3300.00, 450.00, 320.00, 500.00, 120.00, 45.00};
+    char msg[128];
+    
+    pthread_mutex_init(&market_data.mutex, NULL);
+    market_data.stock_count = 0;
+    for (int i = 0; i < MAX_MARKET_SHARDS; i++) {
+        pthread_mutex_init(&market_data.shards[i].mutex, NULL);
+        market_data.shards[i].version = 0;
+    }
+    market_data.shard_count = 1;
+    
+    if (market_load_file(path) <= 0) {
+        // No symbol file: fall back to the built-in demo universe
+        for (int i = 0; i < 10; i++) {
+            market_add_symbol(symbols[i], prices[i], DEFAULT_VOLUME, 0.0);
+        }
+    }
+    
+    sprintf(msg, "Market initialized with %d simulated stocks", market_symbol_count());
+    log_message(msg);
+}
+
+// Load "SYMBOL PRICE [VOLUME [RATE]]" lines, adding symbols not yet listed; returns how many were added
+int market_load_file(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    
+    char line[256];
+    int added = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char symbol[64];
+        double price;
+        int volume = DEFAULT_VOLUME;
+        double tick_rate = 0.0;
+        
+        if (line[0] == '#') continue;
+        int n = sscanf(line, "%63s %lf %d %lf", symbol, &price, &volume, &tick_rate);
+        if (n < 2 || price <= 0.0 || tick_rate < 0.0) continue;
+        if (find_stock(symbol) >= 0) continue;
+        if (market_add_symbol(symbol, price, volume, tick_rate) >= 0) added++;
+    }
+    fclose(f);
+    return added;
+}
+
+// Append a symbol to the universe and publish it in the hash index; returns its ID
+int market_add_symbol(const char* symbol, double price, int volume, double tick_rate) {
+    char key[SYMBOL_LEN];
+    if (normalize_symbol(symbol, key) <= 0) return -1;
+    
+    metrics_lock(&market_data.mutex);
+    
+    uint32_t slot = symbol_hash(key) & (SYMBOL_HASH_SIZE - 1);
+    for (;;) {
+        int entry = market_data.hash[slot];
+        if (entry == 0) break;
+        if (strcmp(market_stock(entry - 1)->symbol, key) == 0) {
+            pthread_mutex_unlock(&market_data.mutex);
+            return entry - 1; // Already listed
+        }
+        slot = (slot + 1) & (SYMBOL_HASH_SIZE - 1);
+    }
+    
+    int id = market_data.stock_count;
+    if (id >= MAX_SYMBOLS) {
+        pthread_mutex_unlock(&market_data.mutex);
+        return -1;
+    }
+    
+    int chunk = id >> SYMBOL_CHUNK_SHIFT;
+    if (!market_data.chunks[chunk]) {
+        Stock* stocks = calloc(SYMBOL_CHUNK_SIZE, sizeof(Stock));
+        if (!stocks) {
+            pthread_mutex_unlock(&market_data.mutex);
+            return -1;
+        }
+        __atomic_store_n(&market_data.chunks[chunk], stocks, __ATOMIC_RELEASE);
+    }
+    
+    Stock* s = &market_data.chunks[chunk][id & (SYMBOL_CHUNK_SIZE - 1)];
+    strcpy(s->symbol, key);
+    s->seq = 0;
+    s->price = price;
+    s->base_price = price;
+    s->change_percent = 0.0;
+    s->volume = volume;
+    s->updated_ns = realtime_ns();
+    s->tick_rate = tick_rate;
+    
+    // Publish: the stock is complete before its hash slot and the count become visible
+    __atomic_store_n(&market_data.hash[slot], id + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&market_data.stock_count, id + 1, __ATOMIC_RELEASE);
+    
+    pthread_mutex_unlock(&market_data.mutex);
+    return id;
+}
+
+int market_symbol_count() {
+    return __atomic_load_n(&market_data.stock_count, __ATOMIC_ACQUIRE);
+}
+
+// Stable address of a listed stock
+Stock* market_stock(int stock_id) {
+    Stock* chunk = __atomic_load_n(&market_data.chunks[stock_id >> SYMBOL_CHUNK_SHIFT], __ATOMIC_ACQUIRE);
+    return &chunk[stock_id & (SYMBOL_CHUNK_SIZE - 1)];
+}
+
+// Case-insensitive symbol lookup; returns the dense symbol ID or -1. Lock-free.
+int find_stock(const char* symbol) {
+    char key[SYMBOL_LEN];
+    if (normalize_symbol(symbol, key) <= 0) return -1;
+    
+    uint32_t slot = symbol_hash(key) & (SYMBOL_HASH_SIZE - 1);
+    for (;;) {
+        int entry = __atomic_load_n(&market_data.hash[slot], __ATOMIC_ACQUIRE);
+        if (entry == 0) return -1;
+        if (strcmp(market_stock(entry - 1)->symbol, key) == 0) return entry - 1;
+        slot = (slot + 1) & (SYMBOL_HASH_SIZE - 1);
+    }
+}
+
+// Seqlock read: copy a consistent view of one stock without blocking the producer
+void market_read(int stock_id, Stock* out) {
+    Stock* s = market_stock(stock_id);
+    unsigned seq;
+    
+    for (;;) {
+        seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            cpu_relax(); // Publication in progress
+            continue;
+        }
+        __atomic_load(&s->price, &out->price, __ATOMIC_RELAXED);
+        __atomic_load(&s->change_percent, &out->change_percent, __ATOMIC_RELAXED);
+        __atomic_load(&s->volume, &out->volume, __ATOMIC_RELAXED);
+        out->updated_ns = __atomic_load_n(&s->updated_ns, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq) break;
+    }
+    
+    // Immutable after the symbol is published
+    memcpy(out->symbol, s->symbol, sizeof(out->symbol));
+    out->base_price = s->base_price;
+    out->tick_rate = s->tick_rate;
+    out->seq = seq;
+}
+
+// Read several stocks as of one moment without blocking the producers: the versions
+// of their shards are read before and after the stocks, and the reads retried if a
+// round was in progress (odd version) or landed in between. Only if rounds keep
+// landing are the shards held, in index order, for one read. Negative IDs are skipped.
+void market_read_many(const int* stock_ids, int count, Stock* out) {
+    int shards = market_data.shard_count;
+    unsigned long before[MAX_MARKET_SHARDS];
+    unsigned mask = 0;
+    for (int i = 0; i < count; i++) {
+        if (stock_ids[i] >= 0) mask |= 1u << (stock_ids[i] % shards);
+    }
+
+    for (int attempt = 0; attempt < MARKET_READ_RETRIES; attempt++) {
+        int busy = 0;
+        for (int k = 0; k < shards; k++) {
+            if (!(mask & (1u << k))) continue;
+            before[k] = market_shard_version(k);
+            busy |= before[k] & 1;
+        }
+        if (busy) {
+            cpu_relax();
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            if (stock_ids[i] >= 0) market_read(stock_ids[i], &out[i]);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        int moved = 0;
+        for (int k = 0; k < shards; k++) {
+            if (mask & (1u << k)) moved |= market_shard_version(k) != before[k];
+        }
+        if (!moved) return;
+    }
+
+    for (int k = 0; k < shards; k++) {
+        if (mask & (1u << k)) pthread_mutex_lock(&market_data.shards[k].mutex);
+    }
+    for (int i = 0; i < count; i++) {
+        if (stock_ids[i] >= 0) market_read(stock_ids[i], &out[i]);
+    }
+    for (int k = shards - 1; k >= 0; k--) {
+        if (mask & (1u << k)) pthread_mutex_unlock(&market_data.shards[k].mutex);
+    }
+}
+
+// Seqlock write: caller holds the stock's shard mutex (one publisher per stock at a time)
+void market_publish(int stock_id, double price, double change_percent, int volume, int64_t tick_ns) {
+    Stock* s = market_stock(stock_id);
+    unsigned seq = s->seq;
+    
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store(&s->price, &price, __ATOMIC_RELAXED);
+    __atomic_store(&s->change_percent, &change_percent, __ATOMIC_RELAXED);
+    __atomic_store(&s->volume, &volume, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->updated_ns, tick_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Split publication across count producers (before any of them starts)
+void market_set_shards(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_MARKET_SHARDS) count = MAX_MARKET_SHARDS;
+    market_data.shard_count = count;
+}
+
+int market_shard_count() {
+    return market_data.shard_count;
+}
+
+MarketShard* market_shard(int shard) {
+    return &market_data.shards[shard];
+}
+
+// Open a publication round of one shard: its version stays odd until market_advance
+void market_begin(int shard) {
+    __atomic_add_fetch(&market_data.shards[shard].version, 1, __ATOMIC_RELEASE);
+}
+
+// Close a publication round of one shard: readers comparing versions see the new state
+void market_advance(int shard) {
+    __atomic_add_fetch(&market_data.shards[shard].version, 1, __ATOMIC_RELEASE);
+}
+
+// Whole-market version: changes whenever any shard has published a round
+unsigned long market_version() {
+    unsigned long version = 0;
+    for (int i = 0; i < market_data.shard_count; i++) version += market_shard_version(i);
+    return version;
+}
+
+unsigned long market_shard_version(int shard) {
+    return __atomic_load_n(&market_data.shards[shard].version, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,76 @@
+#ifndef MARKET_H
+#define MARKET_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+// Constants
+#define SYMBOL_LEN 12               // Max symbol length + NUL
+#define SYMBOL_CHUNK_SHIFT 10       // Stocks are stored in chunks of 1024 so they never move
+#define SYMBOL_CHUNK_SIZE (1 << SYMBOL_CHUNK_SHIFT)
+#define MAX_SYMBOL_CHUNKS 64
+#define MAX_SYMBOLS (SYMBOL_CHUNK_SIZE * MAX_SYMBOL_CHUNKS)
+#define SYMBOL_HASH_SIZE (MAX_SYMBOLS * 2) // Open addressing, load factor <= 0.5
+#define SYMBOLS_FILE "symbols.txt"
+#define DEFAULT_VOLUME 1000000
+#define MAX_MARKET_SHARDS 16         // Producer threads; symbol N belongs to shard N % count
+#define MARKET_READ_RETRIES 8        // Lock-free snapshot attempts before market_read_many holds the shards
+
+// Structures
+typedef struct {
+    char symbol[SYMBOL_LEN];    // Upper case; immutable once published
+    unsigned seq;               // Seqlock sequence: odd while the producer is writing
+    double price;
+    double base_price;
+    double change_percent;
+    int volume;
+    int64_t updated_ns;         // Publication time (CLOCK_REALTIME)
+    double tick_rate;           // Ticks per second from the symbol file (0 = engine default)
+} Stock;
+
+// One producer's slice of the market. Padded so shard versions bumped by different
+// producers do not share a cache line.
+typedef struct {
+    pthread_mutex_t mutex;      // Held by the shard's producer while it publishes a round
+    unsigned long version;      // Bumped at both ends of a publication round: odd while one runs
+} __attribute__((aligned(64))) MarketShard;
+
+typedef struct {
+    pthread_mutex_t mutex;      // Serializes symbol inserts; readers never take it
+    Stock* chunks[MAX_SYMBOL_CHUNKS];
+    int stock_count;            // Dense symbol IDs are 0 .. stock_count-1
+    int shard_count;            // Fixed before the producers start
+    MarketShard shards[MAX_MARKET_SHARDS];
+    int hash[SYMBOL_HASH_SIZE]; // Symbol ID + 1 (0 = empty slot)
+} MarketData;
+
+// Globals
+extern MarketData market_data;
+
+// Wall-clock nanoseconds, the time base for tick and alert timestamps
+static inline int64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Function prototypes
+void init_market_data(const char* path);
+int market_load_file(const char* path);
+int market_add_symbol(const char* symbol, double price, int volume, double tick_rate);
+int market_symbol_count();
+Stock* market_stock(int stock_id);
+int find_stock(const char* symbol);
+void market_read(int stock_id, Stock* out);
+void market_read_many(const int* stock_ids, int count, Stock* out);
+void market_publish(int stock_id, double price, double change_percent, int volume, int64_t tick_ns);
+void market_set_shards(int count);
+int market_shard_count();
+MarketShard* market_shard(int shard);
+void market_begin(int shard);
+void market_advance(int shard);
+unsigned long market_version();
+unsigned long market_shard_version(int shard);
+
+#endif
@@ -0,0 +1,285 @@
+#include "metrics.h"
+#include "sessions.h"
+#include "log.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Hot-path instrumentation. Each thread records into its own shard with plain
+// stores (no atomics read-modify-write, no shared cache lines); STATS and the scrape
+// endpoint merge every shard when they are read, so a report may trail the hot
+// paths by a few samples but never slows them down.
+
+extern volatile sig_atomic_t server_running;
+
+static MetricsShard* shards[MAX_METRIC_THREADS];
+static int shard_count = 0;
+static pthread_mutex_t shard_mutex = PTHREAD_MUTEX_INITIALIZER; // Registration only
+static __thread MetricsShard* my_shard;
+
+static int listen_fd = -1;
+static pthread_t endpoint_tid;
+static int endpoint_running = 0;
+
+static const char* hist_names[HIST_COUNT] = {"command", "tick_to_alert", "market_lock_wait", "send_queue"};
+static const char* counter_names[CTR_COUNT] = {"commands", "ticks", "alerts", "io_syscalls"};
+
+// This thread's shard, registered on first use; NULL once every shard is taken
+static MetricsShard* thread_shard() {
+    if (my_shard) return my_shard;
+
+    pthread_mutex_lock(&shard_mutex);
+    if (shard_count < MAX_METRIC_THREADS) {
+        my_shard = calloc(1, sizeof(MetricsShard));
+        if (my_shard) {
+            __atomic_store_n(&shards[shard_count], my_shard, __ATOMIC_RELEASE);
+            __atomic_store_n(&shard_count, shard_count + 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&shard_mutex);
+    return my_shard;
+}
+
+// Single-writer increment: a relaxed load and store, so readers never see a torn value
+static inline void bump(uint64_t* counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline int hist_bucket(uint64_t value) {
+    if (value < HIST_SUB_COUNT) return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    if (msb >= HIST_MAX_BITS) return HIST_BUCKETS - 1;
+    int shift = msb - HIST_SUB_BITS + 1;
+    return HIST_SUB_COUNT + (shift - 1) * HIST_HALF + (int)(value >> shift) - HIST_HALF;
+}
+
+// Largest value that lands in a bucket
+static uint64_t bucket_high(int bucket) {
+    if (bucket < HIST_SUB_COUNT) return bucket;
+    int k = bucket - HIST_SUB_COUNT;
+    int shift = k / HIST_HALF + 1;
+    uint64_t low = (uint64_t)(k % HIST_HALF + HIST_HALF) << shift;
+    return low + (1ULL << shift) - 1;
+}
+
+void metrics_record(int hist, int64_t value) {
+    MetricsShard* shard = thread_shard();
+    if (!shard) return;
+
+    Histogram* h = &shard->hist[hist];
+    uint64_t v = value > 0 ? (uint64_t)value : 0;
+    bump(&h->counts[hist_bucket(v)], 1);
+    bump(&h->total, 1);
+    bump(&h->sum, v);
+    if (v > h->max) __atomic_store_n(&h->max, v, __ATOMIC_RELAXED);
+}
+
+void metrics_count(int counter, uint64_t n) {
+    MetricsShard* shard = thread_shard();
+    if (shard) bump(&shard->counters[counter], n);
+}
+
+// Lock a contended mutex, recording how long the caller waited for it
+void metrics_lock(pthread_mutex_t* mutex) {
+    if (pthread_mutex_trylock(mutex) == 0) {
+        metrics_record(HIST_LOCK_WAIT, 0);
+        return;
+    }
+    int64_t start = metrics_now();
+    pthread_mutex_lock(mutex);
+    metrics_record(HIST_LOCK_WAIT, metrics_now() - start);
+}
+
+// Merge every shard into one view
+static void merge(Histogram* hists, uint64_t* counters) {
+    memset(hists, 0, sizeof(Histogram) * HIST_COUNT);
+    memset(counters, 0, sizeof(uint64_t) * CTR_COUNT);
+
+    int count = __atomic_load_n(&shard_count, __ATOMIC_ACQUIRE);
+    for (int s = 0; s < count; s++) {
+        MetricsShard* shard = __atomic_load_n(&shards[s], __ATOMIC_ACQUIRE);
+        for (int i = 0; i < HIST_COUNT; i++) {
+            Histogram* src = &shard->hist[i];
+            Histogram* dst = &hists[i];
+            for (int b = 0; b < HIST_BUCKETS; b++) dst->counts[b] += __atomic_load_n(&src->counts[b], __ATOMIC_RELAXED);
+            dst->total += __atomic_load_n(&src->total, __ATOMIC_RELAXED);
+            dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+            uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+            if (max > dst->max) dst->max = max;
+        }
+        for (int c = 0; c < CTR_COUNT; c++) counters[c] += __atomic_load_n(&shard->counters[c], __ATOMIC_RELAXED);
+    }
+}
+
+// Value at quantile q (upper edge of its bucket, never above the recorded max)
+static uint64_t hist_quantile(const Histogram* h, double q) {
+    uint64_t total = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) total += h->counts[b];
+    if (total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(q * total);
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen > rank) {
+            uint64_t value = bucket_high(b);
+            return value < h->max ? value : h->max;
+        }
+    }
+    return h->max;
+}
+
+// Human-readable duration or plain count
+static void format_value(char* out, size_t size, uint64_t value, int bytes) {
+    if (bytes) snprintf(out, size, "%" PRIu64 "B", value);
+    else if (value < 10000) snprintf(out, size, "%" PRIu64 "ns", value);
+    else if (value < 10000000) snprintf(out, size, "%.1fus", value / 1e3);
+    else if (value < 10000000000ULL) snprintf(out, size, "%.1fms", value / 1e6);
+    else snprintf(out, size, "%.1fs", value / 1e9);
+}
+
+static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// STATS reply (text) or the scrape endpoint's body (Prometheus text format); caller frees
+char* metrics_render(int prometheus, size_t* len) {
+    Histogram* hists = malloc(sizeof(Histogram) * HIST_COUNT);
+    uint64_t counters[CTR_COUNT];
+    SessionStats sessions;
+    char* out = NULL;
+    FILE* f = open_memstream(&out, len);
+    if (!hists || !f) {
+        free(hists);
+        if (f) fclose(f);
+        free(out);
+        return NULL;
+    }
+    merge(hists, counters);
+    session_stats(&sessions);
+
+    if (prometheus) {
+        for (int i = 0; i < HIST_COUNT; i++) {
+            int bytes = i == HIST_QUEUE_DEPTH;
+            double scale = bytes ? 1.0 : 1e-9;
+            const char* unit = bytes ? "bytes" : "seconds";
+            fprintf(f, "# TYPE trading_%s_%s summary\n", hist_names[i], unit);
+            for (int q = 0; q < 4; q++) {
+                fprintf(f, "trading_%s_%s{quantile=\"%g\"} %.9g\n", hist_names[i], unit, quantiles[q],
+                        hist_quantile(&hists[i], quantiles[q]) * scale);
+            }
+            fprintf(f, "trading_%s_%s_sum %.9g\n", hist_names[i], unit, hists[i].sum * scale);
+            fprintf(f, "trading_%s_%s_count %" PRIu64 "\n", hist_names[i], unit, hists[i].total);
+        }
+        for (int c = 0; c < CTR_COUNT; c++) {
+            fprintf(f, "# TYPE trading_%s_total counter\ntrading_%s_total %" PRIu64 "\n",
+                    counter_names[c], counter_names[c], counters[c]);
+        }
+        fprintf(f, "# TYPE trading_sessions_open gauge\ntrading_sessions_open %d\n", sessions.open);
+        fprintf(f, "# TYPE trading_sessions_accepted_total counter\ntrading_sessions_accepted_total %" PRIu64 "\n",
+                sessions.accepted);
+        fprintf(f, "# TYPE trading_log_dropped_total counter\ntrading_log_dropped_total %" PRIu64 "\n",
+                log_dropped());
+    } else {
+        fprintf(f, "\n📈 SERVER STATS (all threads since start)\n");
+        fprintf(f, "%-17s %10s %8s %8s %8s %8s %8s\n", "metric", "count", "p50", "p90", "p99", "p99.9", "max");
+        for (int i = 0; i < HIST_COUNT; i++) {
+            char cells[5][16];
+            for (int q = 0; q < 4; q++) {
+                format_value(cells[q], sizeof(cells[q]), hist_quantile(&hists[i], quantiles[q]), i == HIST_QUEUE_DEPTH);
+            }
+            format_value(cells[4], sizeof(cells[4]), hists[i].max, i == HIST_QUEUE_DEPTH);
+            fprintf(f, "%-17s %10" PRIu64 " %8s %8s %8s %8s %8s\n", hist_names[i], hists[i].total,
+                    cells[0], cells[1], cells[2], cells[3], cells[4]);
+        }
+        fprintf(f, "Commands: %" PRIu64 "  Ticks: %" PRIu64 "  Alerts: %" PRIu64 "  I/O syscalls: %" PRIu64 "\n",
+                counters[CTR_COMMANDS], counters[CTR_TICKS], counters[CTR_ALERTS], counters[CTR_IO_CALLS]);
+        fprintf(f, "Sessions: %d open, %d peak, %" PRIu64 " accepted; log records dropped: %" PRIu64 "\n",
+                sessions.open, sessions.peak, sessions.accepted, log_dropped());
+    }
+    fclose(f);
+    free(hists);
+    return out;
+}
+
+// Scrape endpoint: one short-lived connection per request, any path, answered and closed
+static void* endpoint_thread(void* arg) {
+    (void)arg;
+    while (server_running && __atomic_load_n(&endpoint_running, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 1000) <= 0) continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        // The request itself is not interpreted; wait briefly so it is not reset unread
+        struct timeval tv = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char request[1024];
+        if (recv(fd, request, sizeof(request), 0) < 0) {
+            close(fd);
+            continue;
+        }
+
+        size_t len = 0;
+        char* body = metrics_render(1, &len);
+        char header[128];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\n\r\n", body ? len : 0);
+        send(fd, header, header_len, MSG_NOSIGNAL);
+        if (body) send(fd, body, len, MSG_NOSIGNAL);
+        free(body);
+        close(fd);
+    }
+    return NULL;
+}
+
+// Serve the metrics endpoint on 127.0.0.1:port (0 = no endpoint)
+int metrics_start(int port) {
+    if (port <= 0) return 0;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) return -1;
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0) {
+        log_message("ERROR: Metrics endpoint bind failed");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    endpoint_running = 1;
+    if (pthread_create(&endpoint_tid, NULL, endpoint_thread, NULL) != 0) {
+        endpoint_running = 0;
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    char msg[64];
+    sprintf(msg, "Metrics endpoint on 127.0.0.1:%d", port);
+    log_message(msg);
+    return 0;
+}
+
+void metrics_stop() {
+    if (!endpoint_running) return;
+    __atomic_store_n(&endpoint_running, 0, __ATOMIC_RELEASE);
+    pthread_join(endpoint_tid, NULL);
+    close(listen_fd);
+    listen_fd = -1;
+}
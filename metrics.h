@@ -0,0 +1,68 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// Constants
+#define HIST_SUB_BITS 5                 // 16 buckets per power of two above 32: ~3% value error
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_HALF (HIST_SUB_COUNT / 2)
+#define HIST_MAX_BITS 40                // Largest distinct value 2^40 (ns: ~18 minutes)
+#define HIST_BUCKETS (HIST_SUB_COUNT + (HIST_MAX_BITS - HIST_SUB_BITS) * HIST_HALF)
+#define MAX_METRIC_THREADS 64           // Threads that can hold a shard (like log rings)
+#define METRICS_PORT 8889               // Plain-text scrape endpoint on 127.0.0.1 (0 = off)
+
+// Histograms
+enum {
+    HIST_COMMAND,                   // Text command or binary frame handling, ns
+    HIST_TICK_ALERT,                // Tick publication to alert queued on its session, ns
+    HIST_LOCK_WAIT,                 // Wait for a market shard or symbol insert mutex, ns (0 when uncontended)
+    HIST_QUEUE_DEPTH,               // Session send queue at flush, bytes
+    HIST_COUNT
+};
+
+// Counters
+enum {
+    CTR_COMMANDS,
+    CTR_TICKS,
+    CTR_ALERTS,
+    CTR_IO_CALLS,                   // Session I/O syscalls made by reactors (send, recv, wait)
+    CTR_COUNT
+};
+
+// Structures
+
+// Log-linear (HDR-style) histogram: exact below HIST_SUB_COUNT, then HIST_HALF
+// buckets per power of two
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} Histogram;
+
+// One thread's metrics; only the owner writes, readers merge every shard
+typedef struct {
+    Histogram hist[HIST_COUNT];
+    uint64_t counters[CTR_COUNT];
+} MetricsShard;
+
+// Monotonic nanoseconds for interval timing
+static inline int64_t metrics_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Function prototypes
+void metrics_record(int hist, int64_t value);
+void metrics_count(int counter, uint64_t n);
+void metrics_lock(pthread_mutex_t* mutex);
+char* metrics_render(int prometheus, size_t* len);
+int metrics_start(int port);
+void metrics_stop();
+
+#endif
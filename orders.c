@@ -0,0 +1,505 @@
+#include "orders.h"
+#include "server.h"
+#include "journal.h"
+#include "holders.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Order execution: a limit order book per symbol in front of the simulated market.
+// A BUY/SELL without a price sweeps resting orders at least as good as the quote and
+// the simulated market fills the rest at the quote. A priced order trades against the
+// book and rests whatever is left. Cash or shares an order may need are set aside
+// before it reaches the book, so a fill never fails and a maker's portfolio can be
+// settled from the taker's thread (lock order: book, holder list, then account).
+
+// Per-symbol books, chunked like the market so they grow with the universe
+static SymbolBook* book_chunks[MAX_SYMBOL_CHUNKS];
+
+// Execution reports for makers, handed to their reactors once per order
+static __thread BroadcastBatch reports;
+
+// Taker side of one incoming order while it matches
+typedef struct {
+    ClientInfo* taker;
+    int stock_id;
+    int side;
+    double reserved_price;      // Cash per share a buy set aside
+    int filled;
+    double amount;
+    double realized_pl;
+    double cost_basis;
+} FillContext;
+
+// Book of one listed symbol; its chunk is created on first use
+SymbolBook* orders_book(int stock_id) {
+    int c = stock_id >> SYMBOL_CHUNK_SHIFT;
+    SymbolBook* chunk = __atomic_load_n(&book_chunks[c], __ATOMIC_ACQUIRE);
+
+    if (!chunk) {
+        SymbolBook* fresh = calloc(SYMBOL_CHUNK_SIZE, sizeof(SymbolBook));
+        for (int i = 0; i < SYMBOL_CHUNK_SIZE; i++) {
+            uint64_t symbol = (uint64_t)(c * SYMBOL_CHUNK_SIZE + i) + 1;
+            pthread_mutex_init(&fresh[i].lock, NULL);
+            book_init(&fresh[i].book, symbol << ORDER_ID_SYMBOL_SHIFT);
+        }
+        if (__atomic_compare_exchange_n(&book_chunks[c], &chunk, fresh, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            chunk = fresh;
+        } else {
+            free(fresh); // Another thread won the race; chunk now holds its copy
+        }
+    }
+    return &chunk[stock_id & (SYMBOL_CHUNK_SIZE - 1)];
+}
+
+// Symbol an order ID belongs to, -1 if it cannot be one of ours
+int orders_symbol(uint64_t order_id) {
+    uint64_t symbol = order_id >> ORDER_ID_SYMBOL_SHIFT;
+    if (symbol == 0 || symbol > (uint64_t)market_symbol_count()) return -1;
+    return (int)symbol - 1;
+}
+
+void orders_destroy_all() {
+    for (int c = 0; c < MAX_SYMBOL_CHUNKS; c++) {
+        if (!book_chunks[c]) continue;
+        for (int i = 0; i < SYMBOL_CHUNK_SIZE; i++) {
+            book_destroy(&book_chunks[c][i].book);
+            pthread_mutex_destroy(&book_chunks[c][i].lock);
+        }
+        free(book_chunks[c]);
+        book_chunks[c] = NULL;
+    }
+}
+
+// Session's resting order list; caller holds the account lock
+static void order_track(ClientInfo* client, uint64_t order_id) {
+    if (client->order_count == client->order_capacity) {
+        client->order_capacity = client->order_capacity ? client->order_capacity * 2 : 8;
+        client->orders = realloc(client->orders, sizeof(uint64_t) * client->order_capacity);
+    }
+    client->orders[client->order_count++] = order_id;
+}
+
+static void order_untrack(ClientInfo* client, uint64_t order_id) {
+    for (int i = 0; i < client->order_count; i++) {
+        if (client->orders[i] != order_id) continue;
+        memmove(&client->orders[i], &client->orders[i + 1], sizeof(uint64_t) * (client->order_count - i - 1));
+        client->order_count--;
+        return;
+    }
+}
+
+// Book one execution into a portfolio; a buy pays out of the reserved price per share and
+// gets the difference back, a sell delivers reserved shares. Fills of named accounts are
+// journaled under the same lock. done_id (if any) left the book with this fill. Returns
+// the wallet balance afterwards.
+static double settle(ClientInfo* client, int stock_id, int side, int qty, double price, double reserved,
+                     uint64_t done_id, double* realized_pl, double* cost_basis) {
+    Account* account = client->account;
+    Portfolio* p = &account->portfolio;
+    SymbolHolders* holders = holders_get(stock_id);
+
+    pthread_mutex_lock(&holders->lock);
+    account_lock(account);
+    if (side == SIDE_BUY) {
+        p->reserved_cash -= reserved * qty;
+        p->wallet_balance += reserved * qty;
+    } else {
+        p->holdings[find_holding(p, stock_id)].reserved -= qty;
+    }
+    double pl = holders_fill(holders, account, stock_id, side, qty, price, cost_basis);
+    if (account->named) {
+        account->last_seq = journal_fill(account->id, market_stock(stock_id)->symbol, side, qty, price);
+    }
+    if (side == SIDE_BUY) {
+        log_event(LOG_TRADE_BUY, client->client_id, stock_id, qty, price, 0.0);
+    } else {
+        *realized_pl += pl;
+        log_event(LOG_TRADE_SELL, client->client_id, stock_id, qty, price, pl);
+    }
+    if (done_id) order_untrack(client, done_id);
+    double balance = p->wallet_balance;
+    account_unlock(account);
+    pthread_mutex_unlock(&holders->lock);
+    return balance;
+}
+
+// Give back what an order set aside for qty it will no longer trade
+static void release(ClientInfo* client, int stock_id, int side, int qty, double price, uint64_t order_id) {
+    Portfolio* p = &client->account->portfolio;
+
+    account_lock(client->account);
+    if (side == SIDE_BUY) {
+        p->reserved_cash -= price * qty;
+        p->wallet_balance += price * qty;
+    } else {
+        int holding_idx = find_holding(p, stock_id);
+        if (holding_idx >= 0) p->holdings[holding_idx].reserved -= qty;
+    }
+    if (order_id) order_untrack(client, order_id);
+    account_unlock(client->account);
+}
+
+// Execution report for the owner of a resting order
+static Message* exec_report(const Order* maker, int stock_id, double price, int qty,
+                            double realized_pl, double balance, int binary) {
+    if (!binary) {
+        return message_format("\n📣 ORDER %" PRIu64 ": %s %d %s at $%.2f (%d still resting)\n"
+                              "Balance: $%.2f\n",
+                              maker->id, maker->side == SIDE_BUY ? "BOUGHT" : "SOLD", qty,
+                              market_stock(stock_id)->symbol, price, maker->quantity, balance);
+    }
+
+    ExecMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    proto_header(&frame.hdr, MSG_EXEC, sizeof(frame), 0);
+    frame.order_id = maker->id;
+    frame.symbol_id = stock_id;
+    frame.side = maker->side;
+    frame.quantity = qty;
+    frame.remaining = maker->quantity;
+    frame.price = price;
+    frame.amount = price * qty;
+    frame.realized_pl = realized_pl;
+    frame.balance = balance;
+    return message_create((const char*)&frame, sizeof(frame));
+}
+
+// Book callback: settle both sides of one execution and report it to the maker
+static void on_fill(void* arg, const Order* maker, int64_t ticks, int qty) {
+    FillContext* ctx = arg;
+    ClientInfo* owner = maker->owner;
+    double price = book_price_value(ticks);
+    double realized_pl = 0.0, cost_basis = 0.0;
+
+    double balance = settle(owner, ctx->stock_id, maker->side, qty, price, book_price_value(maker->price),
+                            maker->quantity == 0 ? maker->id : 0, &realized_pl, &cost_basis);
+    Message* report = exec_report(maker, ctx->stock_id, price, qty, realized_pl, balance,
+                                  __atomic_load_n(&owner->binary, __ATOMIC_RELAXED));
+    if (report) {
+        // Held by the owner's reactor until the fill just journaled is on disk
+        Delivery* d = broadcast_stage(&reports, owner, report, 0);
+        d->hold_seq = journal_last();
+        message_unref(report);
+    }
+
+    ctx->filled += qty;
+    ctx->amount += price * qty;
+    settle(ctx->taker, ctx->stock_id, ctx->side, qty, price, ctx->reserved_price, 0,
+           &ctx->realized_pl, &ctx->cost_basis);
+}
+
+// Match an order whose cash or shares are already set aside at price. A limit order
+// (rest) joins the book with what is left; a market order takes book prices no worse
+// than the quote and the simulated market fills the remainder at the quote.
+static void execute_order(ClientInfo* client, int stock_idx, int side, int qty, double price,
+                          int rest, TradeResult* result) {
+    SymbolBook* sb = orders_book(stock_idx);
+    FillContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.taker = client;
+    ctx.stock_id = stock_idx;
+    ctx.side = side;
+    ctx.reserved_price = price;
+
+    int64_t limit = side == SIDE_BUY ? (int64_t)floor(price * PRICE_SCALE + 1e-6)
+                                     : (int64_t)ceil(price * PRICE_SCALE - 1e-6);
+
+    pthread_mutex_lock(&sb->lock);
+    book_match(&sb->book, side, limit, qty, on_fill, &ctx);
+    int remaining = qty - ctx.filled;
+    if (remaining > 0 && rest) {
+        Order* order = book_add(&sb->book, side, limit, remaining, client, client->client_id);
+        if (order) {
+            account_lock(client->account);
+            order_track(client, order->id);
+            account_unlock(client->account);
+            result->order_id = order->id;
+            result->resting = remaining;
+            remaining = 0;
+        }
+    }
+    pthread_mutex_unlock(&sb->lock);
+    broadcast_commit(&reports);
+
+    if (remaining > 0 && rest) {
+        // Pools exhausted: the unfilled part is dropped rather than rested
+        release(client, stock_idx, side, remaining, price, 0);
+        if (ctx.filled == 0) result->error = ERR_BOOK_FULL;
+        log_message("Order book full; unfilled quantity dropped");
+    } else if (remaining > 0) {
+        ctx.filled += remaining;
+        ctx.amount += price * remaining;
+        settle(client, stock_idx, side, remaining, price, price, 0, &ctx.realized_pl, &ctx.cost_basis);
+    }
+
+    result->filled = ctx.filled;
+    result->price = ctx.filled ? ctx.amount / ctx.filled : 0.0;
+    result->amount = ctx.amount;
+    result->realized_pl = ctx.realized_pl;
+    result->cost_basis = ctx.cost_basis;
+    account_lock(client->account);
+    result->balance = client->account->portfolio.wallet_balance;
+    account_unlock(client->account);
+}
+
+// Set aside cash (buy) or shares (sell) for qty at price; returns ERR_*
+static int reserve(ClientInfo* client, int stock_idx, int side, int qty, double price, TradeResult* result) {
+    Portfolio* p = &client->account->portfolio;
+    int error = ERR_NONE;
+
+    account_lock(client->account);
+    result->balance = p->wallet_balance;
+    if (side == SIDE_BUY) {
+        double cost = price * qty;
+        if (cost > p->wallet_balance) {
+            error = ERR_INSUFFICIENT_FUNDS;
+        } else {
+            p->wallet_balance -= cost;
+            p->reserved_cash += cost;
+        }
+    } else {
+        int holding_idx = stock_idx >= 0 ? find_holding(p, stock_idx) : -1;
+        if (holding_idx < 0) {
+            error = ERR_NOT_OWNED;
+        } else {
+            Holding* h = &p->holdings[holding_idx];
+            result->held = h->quantity - h->reserved;
+            if (qty > result->held) {
+                error = ERR_INSUFFICIENT_SHARES;
+            } else {
+                h->reserved += qty;
+            }
+        }
+    }
+    account_unlock(client->account);
+    return error;
+}
+
+// Trade: BUY at the market; fills result, returns ERR_* (ERR_NONE on success)
+int execute_buy(ClientInfo* client, int stock_idx, int qty, TradeResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->stock_id = stock_idx;
+    result->side = SIDE_BUY;
+    result->quantity = qty;
+
+    if (qty <= 0) return result->error = ERR_INVALID_QUANTITY;
+    if (stock_idx < 0) return result->error = ERR_UNKNOWN_SYMBOL;
+
+    // Lock-free price snapshot; book fills can only improve on it
+    Stock s;
+    market_read(stock_idx, &s);
+    result->price = s.price;
+    result->amount = s.price * qty;
+
+    if ((result->error = reserve(client, stock_idx, SIDE_BUY, qty, s.price, result)) != ERR_NONE) {
+        return result->error;
+    }
+    execute_order(client, stock_idx, SIDE_BUY, qty, s.price, 0, result);
+    return result->error;
+}
+
+// Trade: SELL at the market; fills result, returns ERR_* (ERR_NONE on success)
+int execute_sell(ClientInfo* client, int stock_idx, int qty, TradeResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->stock_id = stock_idx;
+    result->side = SIDE_SELL;
+    result->quantity = qty;
+
+    if (qty <= 0) return result->error = ERR_INVALID_QUANTITY;
+    if ((result->error = reserve(client, stock_idx, SIDE_SELL, qty, 0.0, result)) != ERR_NONE) {
+        return result->error;
+    }
+
+    Stock s;
+    market_read(stock_idx, &s);
+    execute_order(client, stock_idx, SIDE_SELL, qty, s.price, 0, result);
+    return result->error;
+}
+
+// Trade: limit order; executes what crosses the book now and rests the rest
+int execute_limit(ClientInfo* client, int stock_idx, int side, int qty, double limit, TradeResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->stock_id = stock_idx;
+    result->side = side;
+    result->quantity = qty;
+
+    if (side != SIDE_BUY && side != SIDE_SELL) return result->error = ERR_BAD_REQUEST;
+    if (qty <= 0) return result->error = ERR_INVALID_QUANTITY;
+    if (stock_idx < 0) return result->error = ERR_UNKNOWN_SYMBOL;
+    if (!(limit > 0.0) || limit > ORDER_MAX_PRICE || book_price_ticks(limit) == 0) {
+        return result->error = ERR_BAD_PRICE;
+    }
+
+    // The book trades in cents; the order is priced (and its cash set aside) there
+    double price = book_price_value(book_price_ticks(limit));
+    result->limit = price;
+    result->amount = price * qty;
+    if ((result->error = reserve(client, stock_idx, side, qty, price, result)) != ERR_NONE) {
+        return result->error;
+    }
+    execute_order(client, stock_idx, side, qty, price, 1, result);
+    return result->error;
+}
+
+// Trade: several market orders for the session's account in one pass. Prices come from
+// one market snapshot, and what every order needs is set aside under a single account
+// lock: shares for the sells first, then cash for the buys against the wallet plus what
+// the sells raise at snapshot prices (their fills can only do better). With atomic, one
+// failing order leaves the others unexecuted (ERR_BATCH_ABORTED). Sells execute before
+// buys. Returns the first error in request order, ERR_NONE if every order filled.
+int execute_batch(ClientInfo* client, const BatchOrder* orders, int count, int atomic, TradeResult* results) {
+    Portfolio* p = &client->account->portfolio;
+    int* ids = malloc(sizeof(int) * (count ? count : 1));
+    Stock* quotes = malloc(sizeof(Stock) * (count ? count : 1));
+    int first_error = ERR_NONE;
+
+    for (int i = 0; i < count; i++) {
+        TradeResult* r = &results[i];
+        memset(r, 0, sizeof(*r));
+        r->stock_id = orders[i].stock_id;
+        r->side = orders[i].side;
+        r->quantity = orders[i].quantity;
+        if (r->side != SIDE_BUY && r->side != SIDE_SELL) r->error = ERR_BAD_REQUEST;
+        else if (r->quantity <= 0) r->error = ERR_INVALID_QUANTITY;
+        else if (r->stock_id < 0) r->error = ERR_UNKNOWN_SYMBOL;
+        ids[i] = r->error == ERR_NONE ? r->stock_id : -1;
+    }
+    market_read_many(ids, count, quotes);
+
+    account_lock(client->account);
+    double funding = p->wallet_balance;
+    for (int pass = 0; pass < 2; pass++) {
+        int side = pass == 0 ? SIDE_SELL : SIDE_BUY;
+        for (int i = 0; i < count; i++) {
+            TradeResult* r = &results[i];
+            if (r->side != side || r->error != ERR_NONE) continue;
+            r->price = quotes[i].price;
+            r->amount = quotes[i].price * r->quantity;
+
+            if (side == SIDE_BUY) {
+                if (r->amount > funding) {
+                    r->error = ERR_INSUFFICIENT_FUNDS;
+                    r->balance = funding;
+                } else {
+                    funding -= r->amount;
+                }
+                continue;
+            }
+            int holding_idx = find_holding(p, r->stock_id);
+            if (holding_idx < 0) {
+                r->error = ERR_NOT_OWNED;
+                continue;
+            }
+            Holding* h = &p->holdings[holding_idx];
+            r->held = h->quantity - h->reserved;
+            if (r->quantity > r->held) {
+                r->error = ERR_INSUFFICIENT_SHARES;
+                continue;
+            }
+            h->reserved += r->quantity;
+            funding += r->amount;
+        }
+    }
+    for (int i = 0; i < count && first_error == ERR_NONE; i++) first_error = results[i].error;
+
+    double cost = 0.0;
+    for (int i = 0; i < count; i++) {
+        TradeResult* r = &results[i];
+        if (r->error != ERR_NONE) continue;
+        if (atomic && first_error != ERR_NONE) {
+            if (r->side == SIDE_SELL) p->holdings[find_holding(p, r->stock_id)].reserved -= r->quantity;
+            r->error = ERR_BATCH_ABORTED;
+        } else if (r->side == SIDE_BUY) {
+            cost += r->amount;
+        }
+    }
+    // May dip below zero until the sells below settle; the buys are funded by them
+    p->wallet_balance -= cost;
+    p->reserved_cash += cost;
+    account_unlock(client->account);
+
+    for (int pass = 0; pass < 2; pass++) {
+        int side = pass == 0 ? SIDE_SELL : SIDE_BUY;
+        for (int i = 0; i < count; i++) {
+            TradeResult* r = &results[i];
+            if (r->side != side || r->error != ERR_NONE) continue;
+            execute_order(client, r->stock_id, side, r->quantity, quotes[i].price, 0, r);
+        }
+    }
+    free(ids);
+    free(quotes);
+    return first_error;
+}
+
+// Take one of the session's resting orders off the book; *remaining receives its unfilled quantity
+int execute_cancel(ClientInfo* client, uint64_t order_id, int* remaining) {
+    int stock_idx = orders_symbol(order_id);
+    *remaining = 0;
+    if (stock_idx < 0) return ERR_UNKNOWN_ORDER;
+
+    SymbolBook* sb = orders_book(stock_idx);
+    pthread_mutex_lock(&sb->lock);
+    Order* order = book_find(&sb->book, order_id);
+    if (!order || order->owner != client || order->owner_id != client->client_id) {
+        pthread_mutex_unlock(&sb->lock);
+        return ERR_UNKNOWN_ORDER;
+    }
+    int side = order->side;
+    double price = book_price_value(order->price);
+    *remaining = book_cancel(&sb->book, order_id);
+    release(client, stock_idx, side, *remaining, price, order_id);
+    pthread_mutex_unlock(&sb->lock);
+    return ERR_NONE;
+}
+
+// Snapshot of the session's resting orders, oldest first; caller frees *entries
+int list_orders(ClientInfo* client, OrderEntry** entries) {
+    account_lock(client->account);
+    int count = client->order_count;
+    uint64_t* ids = malloc(sizeof(uint64_t) * (count ? count : 1));
+    memcpy(ids, client->orders, sizeof(uint64_t) * count);
+    account_unlock(client->account);
+
+    *entries = malloc(sizeof(OrderEntry) * (count ? count : 1));
+    int listed = 0;
+    for (int i = 0; i < count; i++) {
+        int stock_idx = orders_symbol(ids[i]);
+        if (stock_idx < 0) continue;
+        SymbolBook* sb = orders_book(stock_idx);
+        pthread_mutex_lock(&sb->lock);
+        Order* order = book_find(&sb->book, ids[i]);
+        if (order) {
+            OrderEntry* e = &(*entries)[listed++];
+            memset(e, 0, sizeof(*e));
+            e->order_id = order->id;
+            e->symbol_id = stock_idx;
+            e->side = order->side;
+            e->quantity = order->quantity;
+            e->price = book_price_value(order->price);
+        }
+        pthread_mutex_unlock(&sb->lock);
+    }
+    free(ids);
+    return listed;
+}
+
+// Pull every resting order of a closing session so no fill can reach its slot
+void cancel_all_orders(ClientInfo* client) {
+    for (;;) {
+        account_lock(client->account);
+        uint64_t order_id = client->order_count ? client->orders[client->order_count - 1] : 0;
+        account_unlock(client->account);
+        if (!order_id) break;
+
+        int remaining;
+        if (execute_cancel(client, order_id, &remaining) != ERR_NONE) {
+            account_lock(client->account);
+            order_untrack(client, order_id);
+            account_unlock(client->account);
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef ORDERS_H
+#define ORDERS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "book.h"
+
+// Constants
+#define ORDER_ID_SYMBOL_SHIFT 48        // Order IDs carry symbol ID + 1 above the book's own bits
+#define ORDER_MAX_PRICE 1e9             // Highest accepted limit price
+
+// Structures
+
+// Limit order book of one symbol; lock serializes matching, resting and cancels
+typedef struct {
+    pthread_mutex_t lock;
+    OrderBook book;
+} SymbolBook;
+
+// Function prototypes
+SymbolBook* orders_book(int stock_id);
+int orders_symbol(uint64_t order_id);
+void orders_destroy_all();
+
+#endif
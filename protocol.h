@@ -0,0 +1,353 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+// Binary wire protocol shared by the server and programmatic clients.
+//
+// A session starts in text mode. Sending the line "BINARY" switches it: the
+// server answers with a HELLO frame and from then on both directions carry
+// length-prefixed frames. All integers and doubles are little-endian; every
+// frame starts with a FrameHeader whose length covers the whole frame.
+
+#include <stdint.h>
+#include <string.h>
+
+// Constants
+#define PROTO_VERSION 1
+#define PROTO_HANDSHAKE "BINARY"
+#define PROTO_SYMBOL_LEN 12
+#define PROTO_MAX_FRAME (1 << 24)
+#define PROTO_MAX_SYMBOLS_PER_LIST 1024
+#define PROTO_ALL_SYMBOLS UINT32_MAX    // StreamMsg symbol_id: every listed symbol
+#define PROTO_MAX_BATCH 256             // Orders in one BatchMsg
+
+// Frame types: client -> server
+#define MSG_ORDER           1       // OrderMsg
+#define MSG_SUBSCRIBE       2       // SubscribeMsg
+#define MSG_PORTFOLIO_REQ   3       // FrameHeader only
+#define MSG_SNAPSHOT_REQ    4       // FrameHeader only
+#define MSG_SYMBOLS_REQ     5       // SymbolsReqMsg
+#define MSG_QUIT            6       // FrameHeader only
+#define MSG_SESSION_REQ     7       // FrameHeader only
+#define MSG_LIMIT           8       // LimitOrderMsg
+#define MSG_CANCEL          9       // CancelMsg
+#define MSG_ORDERS_REQ      10      // FrameHeader only
+#define MSG_LOGIN           11      // LoginMsg (answered with OK)
+#define MSG_WATCH           12      // WatchMsg (answered with OK, then PNL updates)
+#define MSG_STATS_REQ       13      // FrameHeader only
+#define MSG_STREAM          14      // StreamMsg (answered with SNAPSHOT, then QUOTE updates)
+#define MSG_UNSTREAM        15      // StreamMsg (answered with OK; pacing fields ignored)
+#define MSG_ORDER_BATCH     16      // BatchMsg + BatchOrderEntry[count] (answered with BATCH_REPORT)
+
+// Frame types: server -> client
+#define MSG_HELLO           64      // HelloMsg
+#define MSG_OK              65      // FrameHeader only (SUBSCRIBE or LOGIN accepted)
+#define MSG_ERROR           66      // ErrorMsg
+#define MSG_FILL            67      // FillMsg
+#define MSG_ALERT           68      // AlertMsg (request_id set when fired by SUBSCRIBE itself)
+#define MSG_QUOTE           69      // QuoteMsg (unsolicited while streaming)
+#define MSG_PORTFOLIO       70      // PortfolioMsg + HoldingEntry[count]
+#define MSG_SNAPSHOT        71      // SnapshotMsg + QuoteEntry[count]
+#define MSG_SYMBOLS         72      // SymbolsMsg + SymbolEntry[count]
+#define MSG_BYE             73      // FrameHeader only
+#define MSG_SESSION         74      // SessionMsg
+#define MSG_ORDER_ACK       75      // OrderAckMsg
+#define MSG_EXEC            76      // ExecMsg (unsolicited: a resting order traded)
+#define MSG_CANCELED        77      // CanceledMsg
+#define MSG_ORDERS          78      // OrdersMsg + OrderEntry[count]
+#define MSG_PNL             79      // PnlMsg (unsolicited while watching the portfolio)
+#define MSG_STATS           80      // FrameHeader + report text (same as the STATS command)
+#define MSG_BATCH_REPORT    81      // BatchReportMsg + BatchResultEntry[count]
+
+// Order sides
+#define SIDE_BUY  1
+#define SIDE_SELL 2
+
+// Error codes carried by ErrorMsg
+#define ERR_NONE                0
+#define ERR_BAD_REQUEST         1
+#define ERR_INVALID_QUANTITY    2
+#define ERR_UNKNOWN_SYMBOL      3
+#define ERR_INSUFFICIENT_FUNDS  4
+#define ERR_NOT_OWNED           5
+#define ERR_INSUFFICIENT_SHARES 6
+#define ERR_BAD_THRESHOLD       7
+#define ERR_BAD_PRICE           8
+#define ERR_UNKNOWN_ORDER       9
+#define ERR_BOOK_FULL           10
+#define ERR_BAD_ACCOUNT         11
+#define ERR_ORDERS_OPEN         12
+#define ERR_BATCH_ABORTED       13      // All-or-nothing batch: another order in it failed
+
+// Structures
+typedef struct __attribute__((packed)) {
+    uint32_t length;                // Whole frame, header included
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t request_id;            // Chosen by the client, echoed in the reply (0 = unsolicited)
+} FrameHeader;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t symbol_id;
+    uint8_t side;                   // SIDE_BUY / SIDE_SELL
+    uint8_t pad[3];
+    int32_t quantity;
+} OrderMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t symbol_id;
+    uint8_t side;
+    uint8_t pad[3];
+    int32_t quantity;
+    uint32_t pad2;
+    double price;                   // Limit; the unfilled rest of the order joins the book
+} LimitOrderMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint64_t order_id;
+} CancelMsg;
+
+typedef struct __attribute__((packed)) {
+    uint32_t symbol_id;
+    uint8_t side;                   // SIDE_BUY / SIDE_SELL
+    uint8_t pad[3];
+    int32_t quantity;
+} BatchOrderEntry;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint16_t count;                 // BatchOrderEntries that follow (at most PROTO_MAX_BATCH)
+    uint8_t atomic;                 // 1 = execute every order or none of them
+    uint8_t pad[5];
+} BatchMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    char name[32];                  // Account name, NUL padded; created on first use
+} LoginMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t symbol_id;
+    uint32_t pad;
+    double threshold;               // Percent move that fires an alert
+} SubscribeMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t interval_ms;           // Most one update per interval (0 = stop watching)
+    uint32_t pad;
+} WatchMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t symbol_id;             // PROTO_ALL_SYMBOLS = every symbol, later listings included
+    uint32_t interval_ms;           // Most one QUOTE per symbol per interval (0 = server default)
+    double min_change;              // Percent move since the last QUOTE sent (0 = any change)
+} StreamMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t first_id;              // Symbol IDs first_id .. first_id + count - 1
+} SymbolsReqMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint16_t version;
+    uint16_t pad;
+    uint32_t session_id;
+    uint32_t symbol_count;
+} HelloMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint16_t code;                  // ERR_*
+    uint16_t pad;
+    uint32_t symbol_id;
+    char text[48];                  // Human-readable detail, NUL padded
+} ErrorMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t symbol_id;
+    uint8_t side;
+    uint8_t pad[3];
+    int32_t quantity;
+    uint32_t pad2;
+    double price;
+    double amount;                  // Cost of a buy, proceeds of a sell
+    double realized_pl;             // Sells only
+    double balance;                 // Wallet after the fill
+} FillMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint64_t order_id;              // 0 when nothing was left to rest
+    uint32_t symbol_id;
+    uint8_t side;
+    uint8_t pad[3];
+    int32_t quantity;
+    int32_t filled;                 // Executed on arrival
+    int32_t resting;                // Left in the book
+    uint32_t pad2;
+    double price;                   // Limit (rounded to the cent)
+    double avg_price;               // Of the arrival fills
+    double balance;                 // Wallet after the order (cash for resting buys is set aside)
+} OrderAckMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint64_t order_id;
+    uint32_t symbol_id;
+    uint8_t side;
+    uint8_t pad[3];
+    int32_t quantity;               // This execution
+    int32_t remaining;              // Still resting (0 = order done)
+    double price;
+    double amount;
+    double realized_pl;             // Sells only
+    double balance;
+} ExecMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint64_t order_id;
+    int32_t quantity;               // Unfilled quantity taken off the book
+    uint32_t pad;
+} CanceledMsg;
+
+typedef struct __attribute__((packed)) {
+    uint32_t symbol_id;
+    uint8_t side;
+    uint8_t pad;
+    uint16_t error;                 // ERR_* (ERR_NONE = filled)
+    int32_t quantity;
+    uint32_t pad2;
+    double price;                   // Average fill price
+    double amount;                  // Cost of a buy, proceeds of a sell
+    double realized_pl;             // Sells only
+} BatchResultEntry;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint16_t count;                 // One BatchResultEntry per order, in request order
+    uint16_t filled;
+    uint8_t atomic;                 // Echoed from the request: filled < count means none executed
+    uint8_t pad[3];
+    double balance;                 // Wallet after the batch
+} BatchReportMsg;
+
+typedef struct __attribute__((packed)) {
+    uint64_t order_id;
+    uint32_t symbol_id;
+    uint8_t side;
+    uint8_t pad[3];
+    int32_t quantity;               // Remaining
+    uint32_t pad2;
+    double price;
+} OrderEntry;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t count;
+    uint32_t pad;
+} OrdersMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t symbol_id;
+    uint8_t side;                   // SIDE_BUY (price dropped) / SIDE_SELL (price rose)
+    uint8_t pad[3];
+    double price;
+    double change_percent;
+    int64_t tick_ns;                // Producer publication time (CLOCK_REALTIME)
+} AlertMsg;
+
+typedef struct __attribute__((packed)) {
+    uint32_t symbol_id;
+    uint32_t volume;
+    double price;
+    double change_percent;
+} QuoteEntry;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    double market_value;            // Holdings at current prices
+    double unrealized_pl;           // market_value - total invested
+    double value_change;            // Since the previous update (0 on the first)
+    double wallet_balance;
+    uint32_t holding_count;
+    uint32_t pad;
+} PnlMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    QuoteEntry quote;
+    int64_t tick_ns;                // Publication time of the price (CLOCK_REALTIME)
+} QuoteMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint64_t version;               // Market version the snapshot was taken at
+    uint32_t count;                 // QuoteEntries follow grouped by market shard, not by id
+    uint32_t pad;
+} SnapshotMsg;
+
+typedef struct __attribute__((packed)) {
+    uint32_t symbol_id;
+    int32_t quantity;
+    double avg_buy_price;
+    double price;
+} HoldingEntry;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    double wallet_balance;
+    double total_invested;
+    uint32_t count;
+    uint32_t pad;
+} PortfolioMsg;
+
+typedef struct __attribute__((packed)) {
+    char symbol[PROTO_SYMBOL_LEN];
+} SymbolEntry;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t first_id;
+    uint32_t count;
+    uint32_t total;                 // Symbols listed on the server
+    uint32_t pad;
+} SymbolsMsg;
+
+typedef struct __attribute__((packed)) {
+    FrameHeader hdr;
+    uint32_t queued;                // Messages waiting in the session's output queue
+    uint32_t pad;
+    uint64_t queued_bytes;
+    uint64_t peak_bytes;
+    uint64_t conflated;             // Market updates replaced by newer ones before sending
+    uint64_t limit_bytes;           // Backlog tolerated before the session is dropped
+} SessionMsg;
+
+// Fill in a frame header
+static inline void proto_header(FrameHeader* hdr, uint16_t type, uint32_t length, uint32_t request_id) {
+    hdr->length = length;
+    hdr->type = type;
+    hdr->reserved = 0;
+    hdr->request_id = request_id;
+}
+
+// Length of the frame at the start of buf, 0 if more bytes are needed, -1 if malformed
+static inline int proto_frame_length(const char* buf, int available) {
+    FrameHeader hdr;
+    if (available < (int)sizeof(FrameHeader)) return 0;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.length < sizeof(FrameHeader) || hdr.length > PROTO_MAX_FRAME) return -1;
+    if ((int)hdr.length > available) return 0;
+    return (int)hdr.length;
+}
+
+#endif
@@ -0,0 +1,689 @@
+#include "reactor.h"
+#include "server.h"
+#include "broadcast.h"
+#include "uring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+extern volatile sig_atomic_t server_running;
+
+static Reactor reactors[MAX_REACTORS];
+static int reactor_total = 0;
+static int next_reactor = 0;
+
+// Wake token registered in epoll for the eventfd (sessions use their ClientInfo*)
+static char wake_token;
+
+// io_uring requests carry one of these as user_data. Session requests name their
+// session by handle, so a completion that arrives after the session closed (or its
+// slot was reused) is recognised and only releases what the request held.
+enum { URING_WAKE, URING_RECV, URING_SEND };
+
+typedef struct {
+    int kind;
+    SessionHandle session;
+} UringOp;
+
+typedef struct {
+    UringOp op;
+    int count;
+    struct msghdr mh;
+    struct iovec iov[OUTQ_MAX_IOV];
+    Message* msgs[OUTQ_MAX_IOV];        // Kept alive until the kernel has written them
+} UringSend;
+
+static UringOp wake_op = { URING_WAKE, 0 };
+
+// Disconnect a session whose backlog stayed over the limit past the grace period
+static void check_backlog(Reactor* r, ClientInfo* client) {
+    OutQueue* q = &client->outq;
+    if (q->bytes <= OUTQ_LIMIT_BYTES) {
+        if (q->over_since_ns) {
+            q->over_since_ns = 0;
+            r->backlogged--;
+        }
+        return;
+    }
+
+    int64_t now = realtime_ns();
+    if (!q->over_since_ns) {
+        q->over_since_ns = now;
+        r->backlogged++;
+    }
+    if (client->active && (q->bytes > OUTQ_HARD_LIMIT_BYTES || now - q->over_since_ns > OUTQ_GRACE_NS)) {
+        char msg[128];
+        sprintf(msg, "Client %s too slow: %zu bytes queued, %" PRIu64 " updates conflated",
+                client->username, q->bytes, q->conflated);
+        log_message(msg);
+        client->active = 0;
+    }
+}
+
+// Hand queued output to the kernel as one SENDMSG (at most one in flight per session);
+// it goes out with the reactor's next io_uring_enter
+static void uring_send(Reactor* r, ClientInfo* client) {
+    OutQueue* q = &client->outq;
+    UringSend* send = malloc(sizeof(UringSend));
+    struct io_uring_sqe* sqe = send ? uring_sqe(r->ring) : NULL;
+    if (!sqe) {
+        free(send);
+        client->active = 0;
+        return;
+    }
+    send->op.kind = URING_SEND;
+    send->op.session = session_handle(client);
+    send->count = outq_iov(q, send->iov, send->msgs, OUTQ_MAX_IOV);
+    memset(&send->mh, 0, sizeof(send->mh));
+    send->mh.msg_iov = send->iov;
+    send->mh.msg_iovlen = send->count;
+    q->sending = send->count;
+    uring_prep_sendmsg(sqe, client->socket, &send->mh, send);
+    r->ring_ops++;
+}
+
+// Write queued output, watching EPOLLOUT only while a backlog remains. Output that
+// reports a journaled trade stays queued until the record is durable; the journal
+// writer wakes every reactor after each commit.
+static void flush_session(Reactor* r, ClientInfo* client) {
+    int want_write = 0;
+    if (client->hold_seq > journal_durable()) {
+        if (!client->held) {
+            client->held = 1;
+            r->held++;
+        }
+    } else {
+        client->hold_seq = 0;
+        if (client->held) {
+            client->held = 0;
+            r->held--;
+        }
+        if (client->outq.count && !client->outq.sending) {
+            metrics_record(HIST_QUEUE_DEPTH, client->outq.bytes);
+        }
+        if (r->ring) {
+            // The kernel waits for socket space itself; the completion sends the rest
+            if (client->outq.count && !client->outq.sending) uring_send(r, client);
+        } else if (outq_flush(&client->outq, client->socket) < 0) {
+            client->active = 0;
+            return;
+        }
+        want_write = !r->ring && client->outq.count > 0;
+    }
+
+    if (want_write != client->want_write) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+        ev.data.ptr = client;
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_MOD, client->socket, &ev);
+        client->want_write = want_write;
+    }
+    check_backlog(r, client);
+}
+
+// Arm (or re-arm) the multishot receive of a session
+static int uring_recv(Reactor* r, ClientInfo* client, UringOp* op) {
+    struct io_uring_sqe* sqe = uring_sqe(r->ring);
+    if (!sqe) return -1;
+    op->kind = URING_RECV;
+    op->session = session_handle(client);
+    uring_prep_recv(sqe, client->socket, op);
+    return 0;
+}
+
+// Link a session into the reactor's owned list and start watching its socket
+static void adopt_session(Reactor* r, ClientInfo* client) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = client;
+
+    client->prev = NULL;
+    client->next = r->sessions;
+    if (r->sessions) r->sessions->prev = client;
+    r->sessions = client;
+    r->session_count++;
+
+    client->want_write = 0;
+    if (r->ring) {
+        UringOp* op = malloc(sizeof(UringOp));
+        if (!op || uring_recv(r, client, op) < 0) {
+            log_message("ERROR: io_uring recv submission failed");
+            free(op);
+            client->active = 0;
+            return;
+        }
+        r->ring_ops++;
+    } else if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, client->socket, &ev) < 0) {
+        log_message("ERROR: epoll_ctl ADD failed");
+        client->active = 0;
+        return;
+    }
+    flush_session(r, client); // Welcome text queued by the acceptor
+}
+
+// Unlink a session and hand it back to the server for cleanup
+static void drop_session(Reactor* r, ClientInfo* client) {
+    if (r->ring) {
+        // Requests still naming the socket must reach the kernel before it is closed.
+        // Shutting down the read side ends the receive; a send in flight may finish,
+        // unless the session is being dropped as too slow or the server is stopping.
+        uint64_t enters = r->ring->enters;
+        uring_enter(r->ring, 0);
+        metrics_count(CTR_IO_CALLS, r->ring->enters - enters);
+        int slow = client->outq.bytes > OUTQ_LIMIT_BYTES;
+        shutdown(client->socket, server_running && !slow ? SHUT_RD : SHUT_RDWR);
+    } else {
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, client->socket, NULL);
+    }
+
+    if (client->prev) client->prev->next = client->next;
+    else r->sessions = client->next;
+    if (client->next) client->next->prev = client->prev;
+    client->next = client->prev = NULL;
+    r->session_count--;
+    if (client->outq.over_since_ns) r->backlogged--;
+    if (client->held) r->held--;
+    client->held = 0;
+    client->hold_seq = 0;
+    if (client->watch_interval_ns) r->watching--;
+    client->watch_interval_ns = 0;
+    if (client->stream_interval_ns) r->streaming--;
+    client->stream_interval_ns = 0;
+
+    session_closed(client);
+}
+
+// Move sessions queued by the acceptor into this reactor
+static void drain_pending(Reactor* r) {
+    pthread_mutex_lock(&r->pending_mutex);
+    ClientInfo* list = r->pending;
+    r->pending = NULL;
+    pthread_mutex_unlock(&r->pending_mutex);
+
+    while (list) {
+        ClientInfo* next = list->next;
+        adopt_session(r, list);
+        if (!list->active) drop_session(r, list);
+        list = next;
+    }
+}
+
+// Queue broadcast deliveries to their sessions, then flush each touched session once
+static void drain_inbox(Reactor* r) {
+    pthread_mutex_lock(&r->inbox_mutex);
+    Delivery* list = r->inbox;
+    int count = r->inbox_count;
+    int capacity = r->inbox_capacity;
+    r->inbox = r->draining;
+    r->inbox_capacity = r->draining_capacity;
+    r->inbox_count = 0;
+    pthread_mutex_unlock(&r->inbox_mutex);
+    r->draining = list;
+    r->draining_capacity = capacity;
+
+    if (r->touched_capacity < count) {
+        free(r->touched);
+        r->touched = malloc(sizeof(ClientInfo*) * count);
+        r->touched_capacity = count;
+    }
+
+    int touched = 0;
+    int alerts = 0;
+    int64_t now = count ? realtime_ns() : 0;
+    for (int i = 0; i < count; i++) {
+        // The session may have closed (and its slot been reused) since this was staged
+        ClientInfo* client = session_resolve(list[i].session);
+        if (!client || client->reactor != r || !client->active) {
+            message_unref(list[i].msg);
+            continue;
+        }
+        if (list[i].hold_seq > client->hold_seq) client->hold_seq = list[i].hold_seq;
+        if (list[i].tick_ns) {
+            metrics_record(HIST_TICK_ALERT, now - list[i].tick_ns);
+            alerts++;
+        }
+        outq_push(&client->outq, list[i].msg, list[i].key);
+        if (!client->touched) {
+            client->touched = 1;
+            r->touched[touched++] = client;
+        }
+    }
+
+    if (alerts) metrics_count(CTR_ALERTS, alerts);
+
+    for (int i = 0; i < touched; i++) {
+        ClientInfo* client = r->touched[i];
+        client->touched = 0;
+        flush_session(r, client);
+        if (!client->active) drop_session(r, client);
+    }
+}
+
+// Flush sessions whose journal records have become durable since they were held
+static void release_held(Reactor* r) {
+    uint64_t durable = journal_durable();
+    ClientInfo* client = r->sessions;
+    while (client && r->held) {
+        ClientInfo* next = client->next;
+        if (client->held && client->hold_seq <= durable) {
+            flush_session(r, client);
+            if (!client->active) drop_session(r, client);
+        }
+        client = next;
+    }
+}
+
+// Push a P/L update to each watching session whose interval has passed and whose
+// account was revalued since its last update
+static void poll_watchers(Reactor* r) {
+    int64_t now = realtime_ns();
+    if (now < r->watch_due_ns) return;
+    r->watch_due_ns = now + WATCH_MIN_MS * 1000000LL;
+
+    ClientInfo* client = r->sessions;
+    while (client) {
+        ClientInfo* next = client->next;
+        if (client->watch_interval_ns && now >= client->watch_due_ns) {
+            Message* update = portfolio_update(client);
+            if (update) {
+                session_queue(client, update);
+                client->watch_due_ns = now + client->watch_interval_ns;
+                flush_session(r, client);
+                if (!client->active) drop_session(r, client);
+            }
+        }
+        client = next;
+    }
+}
+
+// Queue quote updates for each streaming session whose interval has passed, and note
+// when the next one falls due
+static void poll_streams(Reactor* r) {
+    int64_t now = realtime_ns();
+    if (now < r->stream_due_ns) return;
+
+    int64_t next = INT64_MAX;
+    ClientInfo* client = r->sessions;
+    while (client) {
+        ClientInfo* next_client = client->next;
+        if (client->stream_interval_ns) {
+            if (now >= client->stream_due_ns) {
+                client->stream_due_ns = now + client->stream_interval_ns;
+                if (stream_updates(client)) {
+                    flush_session(r, client);
+                    if (!client->active) drop_session(r, client);
+                }
+            }
+            if (client->stream_interval_ns && client->stream_due_ns < next) next = client->stream_due_ns;
+        }
+        client = next_client;
+    }
+    r->stream_due_ns = next;
+}
+
+// How long a reactor may sleep: backlogged sessions are rechecked even when their
+// sockets stay silent, watched portfolios are polled while anyone watches, and quote
+// streams wake it when the earliest falls due
+static int wait_timeout(Reactor* r) {
+    int timeout = r->backlogged ? 1000 : -1;
+    if (r->watching) timeout = WATCH_MIN_MS;
+    if (r->streaming) {
+        int64_t wait = (r->stream_due_ns - realtime_ns() + 999999) / 1000000;
+        if (wait < 0) wait = 0;
+        if (timeout < 0 || wait < timeout) timeout = (int)wait;
+    }
+    return timeout;
+}
+
+// Work that follows every wakeup, whichever backend delivered it
+static void after_wakeup(Reactor* r, int woken) {
+    if (r->backlogged) {
+        ClientInfo* client = r->sessions;
+        while (client) {
+            ClientInfo* next = client->next;
+            check_backlog(r, client);
+            if (!client->active) drop_session(r, client);
+            client = next;
+        }
+    }
+
+    if (woken) {
+        drain_pending(r);
+        drain_inbox(r);
+        if (r->held) release_held(r);
+    }
+    if (r->watching) poll_watchers(r);
+    if (r->streaming) poll_streams(r);
+}
+
+static void epoll_loop(Reactor* r) {
+    struct epoll_event events[MAX_EVENTS];
+
+    while (server_running) {
+        int n = epoll_wait(r->epoll_fd, events, MAX_EVENTS, wait_timeout(r));
+        metrics_count(CTR_IO_CALLS, 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_message("ERROR: epoll_wait failed");
+            break;
+        }
+
+        int woken = 0;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == &wake_token) {
+                uint64_t value;
+                while (read(r->wake_fd, &value, sizeof(value)) > 0) {}
+                metrics_count(CTR_IO_CALLS, 2);
+                woken = 1;
+                continue;
+            }
+
+            ClientInfo* client = (ClientInfo*)events[i].data.ptr;
+            if (!client->active) continue;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                // Replies to commands that journaled a trade wait for the record
+                uint64_t journaled = journal_last();
+                session_readable(client);
+                uint64_t seq = journal_last();
+                if (seq != journaled && seq > client->hold_seq) client->hold_seq = seq;
+            }
+            // Replies from this wakeup, or backlog the socket can now take
+            flush_session(r, client);
+            if (!client->active) drop_session(r, client);
+        }
+
+        after_wakeup(r, woken);
+    }
+}
+
+static void arm_wake(Reactor* r) {
+    struct io_uring_sqe* sqe = uring_sqe(r->ring);
+    if (sqe) uring_prep_read(sqe, r->wake_fd, &r->wake_value, sizeof(r->wake_value), &wake_op);
+}
+
+// One read of a session's multishot receive. The request ends (no IORING_CQE_F_MORE)
+// at end of stream, on error, or when the provided buffers ran out; only the last is
+// re-armed.
+static void uring_received(Reactor* r, UringOp* op, const struct io_uring_cqe* cqe) {
+    ClientInfo* client = session_resolve(op->session);
+    if (client && (client->reactor != r || !client->active)) client = NULL;
+    int more = cqe->flags & IORING_CQE_F_MORE;
+
+    if (client) {
+        if (cqe->res > 0) {
+            // Replies to commands that journaled a trade wait for the record
+            uint64_t journaled = journal_last();
+            session_input(client, uring_buffer(r->ring, cqe), cqe->res);
+            uint64_t seq = journal_last();
+            if (seq != journaled && seq > client->hold_seq) client->hold_seq = seq;
+        } else if (cqe->res == 0) {
+            session_input(client, NULL, 0); // Client disconnected
+        } else if (cqe->res != -ENOBUFS) {
+            client->active = 0;
+        }
+    }
+    uring_buffer_recycle(r->ring, cqe);
+
+    if (!more) {
+        if (client && client->active && uring_recv(r, client, op) == 0) {
+            more = 1; // Same request object, re-armed
+        } else {
+            free(op);
+            r->ring_ops--;
+        }
+    }
+    if (!client) return;
+    flush_session(r, client);
+    if (!client->active) drop_session(r, client);
+}
+
+// A SENDMSG finished: retire what it wrote and send the rest
+static void uring_sent(Reactor* r, UringSend* send, int res) {
+    ClientInfo* client = session_resolve(send->op.session);
+    if (client && client->reactor == r) {
+        client->outq.sending = 0;
+        if (res < 0) {
+            client->active = 0;
+        } else {
+            outq_consume(&client->outq, res);
+        }
+    } else {
+        client = NULL;
+    }
+    for (int i = 0; i < send->count; i++) message_unref(send->msgs[i]);
+    free(send);
+    r->ring_ops--;
+
+    if (!client) return;
+    if (client->active) flush_session(r, client);
+    if (!client->active) drop_session(r, client);
+}
+
+// Handle every completion ready; returns 1 if the wake eventfd fired
+static int uring_reap(Reactor* r) {
+    int woken = 0;
+    struct io_uring_cqe* ready;
+    while ((ready = uring_peek(r->ring))) {
+        struct io_uring_cqe cqe = *ready;
+        uring_advance(r->ring);
+
+        UringOp* op = (UringOp*)(uintptr_t)cqe.user_data;
+        switch (op->kind) {
+        case URING_WAKE:
+            woken = 1;
+            arm_wake(r);
+            break;
+        case URING_RECV:
+            uring_received(r, op, &cqe);
+            break;
+        case URING_SEND:
+            uring_sent(r, (UringSend*)op, cqe.res);
+            break;
+        }
+    }
+    return woken;
+}
+
+// io_uring event loop: the single io_uring_enter per pass submits every send queued
+// since the last one (a whole tick's fan-out) and waits for the next completions
+static void uring_loop(Reactor* r) {
+    arm_wake(r);
+    while (server_running) {
+        uint64_t enters = r->ring->enters;
+        int failed = uring_enter(r->ring, wait_timeout(r)) < 0;
+        metrics_count(CTR_IO_CALLS, r->ring->enters - enters);
+        if (failed) {
+            log_message("ERROR: io_uring_enter failed");
+            break;
+        }
+        after_wakeup(r, uring_reap(r));
+    }
+}
+
+// Reactor thread: owns a fixed set of sessions and multiplexes them with epoll or io_uring
+static void* reactor_thread(void* arg) {
+    Reactor* r = (Reactor*)arg;
+
+    if (r->ring) {
+        uring_loop(r);
+    } else {
+        epoll_loop(r);
+    }
+
+    // Shutdown: close whatever is still attached to this reactor
+    drain_pending(r);
+    drain_inbox(r);
+    while (r->sessions) {
+        r->sessions->active = 0;
+        drop_session(r, r->sessions);
+    }
+
+    // Their sockets are shut down, so outstanding requests complete promptly
+    for (int tries = 0; r->ring && r->ring_ops > 0 && tries < 50; tries++) {
+        if (uring_enter(r->ring, 100) < 0) break;
+        uring_reap(r);
+    }
+    return NULL;
+}
+
+// Turn PORTFOLIO WATCH on or off (interval_ns 0) for a session; owning reactor only
+void reactor_watch(ClientInfo* client, int64_t interval_ns) {
+    Reactor* r = client->reactor;
+    if (!client->watch_interval_ns && interval_ns) r->watching++;
+    if (client->watch_interval_ns && !interval_ns) r->watching--;
+    client->watch_interval_ns = interval_ns;
+    client->watch_due_ns = 0;   // First update on the next poll
+    client->watch_seq = WATCH_UNSENT;
+}
+
+// Turn quote streaming on, retune it or off (interval_ns 0) for a session; owning
+// reactor only. The snapshot goes out with the reply, so the first poll is one
+// interval away.
+void reactor_stream(ClientInfo* client, int64_t interval_ns) {
+    Reactor* r = client->reactor;
+    if (!client->stream_interval_ns && interval_ns) r->streaming++;
+    if (client->stream_interval_ns && !interval_ns) r->streaming--;
+    client->stream_interval_ns = interval_ns;
+    client->stream_version = 0;
+    if (!interval_ns) return;
+    client->stream_due_ns = realtime_ns() + interval_ns;
+    if (r->streaming == 1 || client->stream_due_ns < r->stream_due_ns) r->stream_due_ns = client->stream_due_ns;
+}
+
+static void wake(Reactor* r) {
+    uint64_t one = 1;
+    if (write(r->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        log_message("ERROR: Reactor wakeup failed");
+    }
+}
+
+// Start the reactor pool; 0 means one reactor per online CPU. With use_uring each
+// reactor drives its sessions through its own io_uring, or falls back to epoll if
+// the ring cannot be set up.
+int reactor_start_all(int count, int use_uring) {
+    if (count <= 0) count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) count = 1;
+    if (count > MAX_REACTORS) count = MAX_REACTORS;
+
+    for (int i = 0; i < count; i++) {
+        Reactor* r = &reactors[i];
+        memset(r, 0, sizeof(*r));
+        r->id = i;
+        pthread_mutex_init(&r->pending_mutex, NULL);
+        pthread_mutex_init(&r->inbox_mutex, NULL);
+
+        r->epoll_fd = -1;
+        if (use_uring) {
+            r->ring = malloc(sizeof(Uring));
+            if (!r->ring || uring_init(r->ring, URING_ENTRIES) < 0 || uring_buffers_init(r->ring) < 0) {
+                log_message("WARNING: io_uring setup failed, reactor falls back to epoll");
+                if (r->ring) uring_destroy(r->ring);
+                free(r->ring);
+                r->ring = NULL;
+            }
+        }
+
+        if (r->ring) {
+            // Blocking: the ring's read of it waits for the next wakeup
+            r->wake_fd = eventfd(0, EFD_CLOEXEC);
+        } else {
+            r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            r->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        }
+        if ((!r->ring && r->epoll_fd < 0) || r->wake_fd < 0) {
+            log_message("ERROR: Reactor creation failed");
+            return -1;
+        }
+
+        if (!r->ring) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = &wake_token;
+            epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, r->wake_fd, &ev);
+        }
+
+        if (pthread_create(&r->thread, NULL, reactor_thread, r) != 0) {
+            log_message("ERROR: Reactor thread creation failed");
+            return -1;
+        }
+        reactor_total++;
+    }
+
+    char msg[64];
+    sprintf(msg, "Started %d reactor thread(s)", reactor_total);
+    log_message(msg);
+    return 0;
+}
+
+// Stop and join every reactor; sessions are closed by their owners
+void reactor_stop_all() {
+    reactor_wake_all();
+    for (int i = 0; i < reactor_total; i++) {
+        pthread_join(reactors[i].thread, NULL);
+        if (reactors[i].ring) {
+            uring_destroy(reactors[i].ring);
+            free(reactors[i].ring);
+            reactors[i].ring = NULL;
+        } else {
+            close(reactors[i].epoll_fd);
+        }
+        close(reactors[i].wake_fd);
+        pthread_mutex_destroy(&reactors[i].pending_mutex);
+        pthread_mutex_destroy(&reactors[i].inbox_mutex);
+        free(reactors[i].inbox);
+        free(reactors[i].draining);
+        free(reactors[i].touched);
+    }
+    reactor_total = 0;
+}
+
+// Signal every reactor (market update or shutdown)
+void reactor_wake_all() {
+    for (int i = 0; i < reactor_total; i++) {
+        wake(&reactors[i]);
+    }
+}
+
+// Hand a freshly accepted session to the next reactor (round robin)
+void reactor_add_session(ClientInfo* client) {
+    Reactor* r = &reactors[next_reactor];
+    next_reactor = (next_reactor + 1) % reactor_total;
+
+    client->reactor = r;
+    pthread_mutex_lock(&r->pending_mutex);
+    client->next = r->pending;
+    r->pending = client;
+    pthread_mutex_unlock(&r->pending_mutex);
+    wake(r);
+}
+
+// Append deliveries to a reactor's inbox and wake it
+void reactor_deliver(Reactor* r, Delivery* deliveries, int count) {
+    pthread_mutex_lock(&r->inbox_mutex);
+    if (r->inbox_count + count > r->inbox_capacity) {
+        int capacity = r->inbox_capacity ? r->inbox_capacity : BROADCAST_INITIAL_BATCH;
+        while (capacity < r->inbox_count + count) capacity *= 2;
+        r->inbox = realloc(r->inbox, sizeof(Delivery) * capacity);
+        r->inbox_capacity = capacity;
+    }
+    memcpy(r->inbox + r->inbox_count, deliveries, sizeof(Delivery) * count);
+    r->inbox_count += count;
+    pthread_mutex_unlock(&r->inbox_mutex);
+    wake(r);
+}
+
+int reactor_count() {
+    return reactor_total;
+}
+
+Reactor* reactor_get(int index) {
+    return &reactors[index];
+}
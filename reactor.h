@@ -0,0 +1,55 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+// Constants
+#define MAX_REACTORS 16
+#define MAX_EVENTS 256
+
+struct ClientInfo;
+struct Delivery;
+struct Uring;
+
+// Structures
+typedef struct Reactor {
+    int id;
+    int epoll_fd;                     // -1 when the reactor runs on io_uring
+    int wake_fd;                      // eventfd: market ticks, new sessions, shutdown
+    struct Uring* ring;               // io_uring backend (NULL = epoll)
+    uint64_t wake_value;              // Target of the io_uring eventfd read
+    int ring_ops;                     // Session requests (recv, send) not yet completed
+    pthread_t thread;
+    pthread_mutex_t pending_mutex;
+    struct ClientInfo* pending;       // Sessions handed over by the acceptor
+    struct ClientInfo* sessions;      // Sessions owned by this reactor
+    int session_count;
+    pthread_mutex_t inbox_mutex;
+    struct Delivery* inbox;           // Broadcast deliveries queued by producers
+    int inbox_count;
+    int inbox_capacity;
+    struct Delivery* draining;        // Reactor-private buffer swapped with the inbox
+    int draining_capacity;
+    struct ClientInfo** touched;      // Sessions with new output in this drain
+    int touched_capacity;
+    int backlogged;                   // Sessions over OUTQ_LIMIT_BYTES (polled once a second)
+    int held;                         // Sessions whose replies wait for the journal (rechecked on wakeup)
+    int watching;                     // Sessions with PORTFOLIO WATCH on (polled every WATCH_MIN_MS)
+    int64_t watch_due_ns;             // Next watch poll
+    int streaming;                    // Sessions with quote streams (polled when the earliest is due)
+    int64_t stream_due_ns;            // Earliest stream poll due
+} Reactor;
+
+// Function prototypes
+int reactor_start_all(int count, int use_uring);
+void reactor_stop_all();
+void reactor_wake_all();
+void reactor_add_session(struct ClientInfo* client);
+void reactor_watch(struct ClientInfo* client, int64_t interval_ns);
+void reactor_stream(struct ClientInfo* client, int64_t interval_ns);
+void reactor_deliver(Reactor* r, struct Delivery* deliveries, int count);
+int reactor_count();
+Reactor* reactor_get(int index);
+
+#endif
@@ -0,0 +1,110 @@
+#include "replay.h"
+#include "market.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Map a tick file and list its symbols; returns -1 (with a log line) if it is unusable
+int replay_open(Replay* replay, const char* path, double speed) {
+    char msg[128];
+    struct stat st;
+
+    memset(replay, 0, sizeof(*replay));
+    replay->speed = speed;
+    replay->fd = open(path, O_RDONLY);
+    if (replay->fd < 0 || fstat(replay->fd, &st) < 0 || st.st_size < (off_t)sizeof(TickFileHeader)) {
+        sprintf(msg, "ERROR: Cannot read tick file %.80s", path);
+        log_message(msg);
+        replay_close(replay);
+        return -1;
+    }
+
+    replay->size = st.st_size;
+    replay->map = mmap(NULL, replay->size, PROT_READ, MAP_PRIVATE, replay->fd, 0);
+    if (replay->map == MAP_FAILED) {
+        replay->map = NULL;
+        log_message("ERROR: Tick file mmap failed");
+        replay_close(replay);
+        return -1;
+    }
+    madvise(replay->map, replay->size, MADV_SEQUENTIAL); // Read-ahead; pages behind us can go
+
+    const TickFileHeader* h = replay->map;
+    size_t symbols_size = (size_t)h->symbol_count * sizeof(TickSymbol);
+    if (memcmp(h->magic, TICKFILE_MAGIC, sizeof(h->magic)) != 0 || h->version != TICKFILE_VERSION ||
+        symbols_size > replay->size - sizeof(*h) ||
+        h->tick_count > (replay->size - sizeof(*h) - symbols_size) / sizeof(TickRecord)) {
+        log_message("ERROR: Not a valid tick file");
+        replay_close(replay);
+        return -1;
+    }
+    replay->header = h;
+    replay->symbols = (const TickSymbol*)(h + 1);
+    replay->ticks = (const TickRecord*)(replay->symbols + h->symbol_count);
+
+    // Symbols the market does not list yet are added with the file's opening price
+    replay->stock_ids = malloc(sizeof(int) * (h->symbol_count ? h->symbol_count : 1));
+    for (uint32_t i = 0; i < h->symbol_count; i++) {
+        char symbol[TICKFILE_SYMBOL_LEN + 1];
+        memcpy(symbol, replay->symbols[i].symbol, TICKFILE_SYMBOL_LEN);
+        symbol[TICKFILE_SYMBOL_LEN] = '\0';
+        int id = find_stock(symbol);
+        if (id < 0) id = market_add_symbol(symbol, replay->symbols[i].open_price, DEFAULT_VOLUME, 0.0);
+        replay->stock_ids[i] = id;
+    }
+
+    if (speed > 0) {
+        sprintf(msg, "Replay: %llu ticks, %u symbols at %.1fx speed",
+                (unsigned long long)h->tick_count, h->symbol_count, speed);
+    } else {
+        sprintf(msg, "Replay: %llu ticks, %u symbols as fast as possible",
+                (unsigned long long)h->tick_count, h->symbol_count);
+    }
+    log_message(msg);
+    return 0;
+}
+
+void replay_close(Replay* replay) {
+    if (replay->map) munmap(replay->map, replay->size);
+    if (replay->fd >= 0) close(replay->fd);
+    free(replay->stock_ids);
+    memset(replay, 0, sizeof(*replay));
+    replay->fd = -1;
+}
+
+int replay_done(const Replay* replay) {
+    return replay->next >= replay->header->tick_count;
+}
+
+// Ticks due at monotonic time now (at most limit); when none are, *wait_ns says how long to sleep
+int replay_due(Replay* replay, int64_t now, int limit, int64_t* wait_ns) {
+    uint64_t remaining = replay->header->tick_count - replay->next;
+    if (remaining < (uint64_t)limit) limit = (int)remaining;
+    if (replay->wall_start == 0) replay->wall_start = now;
+    if (replay->speed <= 0.0) return limit;
+
+    // Source time reached so far, scaled by the speed multiplier
+    int64_t file_now = replay->header->first_ns + (int64_t)((now - replay->wall_start) * replay->speed);
+    int due = 0;
+    while (due < limit && replay->ticks[replay->next + due].ts_ns <= file_now) due++;
+
+    if (due == 0 && limit > 0) {
+        int64_t ahead = replay->ticks[replay->next].ts_ns - file_now;
+        *wait_ns = (int64_t)(ahead / replay->speed) + 1;
+    }
+    return due;
+}
+
+// Consume the next tick; returns its market symbol ID (-1 if the symbol could not be listed)
+int replay_next(Replay* replay, double* price, int* volume) {
+    const TickRecord* t = &replay->ticks[replay->next++];
+    *price = t->price;
+    *volume = (int)t->volume;
+    if (t->symbol >= replay->header->symbol_count) return -1;
+    return replay->stock_ids[t->symbol];
+}
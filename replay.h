@@ -0,0 +1,31 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tickfile.h"
+
+// Structures
+
+// Historical tick source: a mapped tick file played back against the wall clock
+typedef struct {
+    int fd;
+    void* map;
+    size_t size;
+    const TickFileHeader* header;
+    const TickSymbol* symbols;
+    const TickRecord* ticks;
+    int* stock_ids;             // Market symbol ID for each file symbol
+    uint64_t next;              // Next tick to publish
+    double speed;               // Playback speed multiplier (0 = as fast as possible)
+    int64_t wall_start;         // Monotonic time playback started (0 = not yet)
+} Replay;
+
+// Function prototypes
+int replay_open(Replay* replay, const char* path, double speed);
+void replay_close(Replay* replay);
+int replay_done(const Replay* replay);
+int replay_due(Replay* replay, int64_t now, int limit, int64_t* wait_ns);
+int replay_next(Replay* replay, double* price, int* volume);
+
+#endif
@@ -1,4 +1,7 @@
 #include "server.h"
+#include "reactor.h"
+#include "alertscan.h"
+#include "uring.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,244 +10,352 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
 #include <time.h>
+#include <sys/resource.h>
 
 // Global variable definitions
-MarketData market_data;
-ClientInfo clients[MAX_CLIENTS];
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+volatile sig_atomic_t reload_symbols = 0;
 int server_socket;
 volatile sig_atomic_t server_running = 1;
-FILE* log_file;
 
-// Helper function to initialize market data
-void init_market_data() {
-    const char* symbols[] = {"AAPL", "GOOGL", "MSFT", "TSLA", "AMZN", "NFLX", "META", "NVDA", "AMD", "INTC"};
-    double prices[] = {150.00, 2800.00, 300.00, 250.00, 3300.00, 450.00, 320.00, 500.00, 120.00, 45.00};
-    
-    pthread_mutex_init(&market_data.mutex, NULL);
-    pthread_cond_init(&market_data.data_updated, NULL);
-    market_data.stock_count = MAX_STOCKS;
-    market_data.update_count = 0;
-    
-    for (int i = 0; i < MAX_STOCKS; i++) {
-        strcpy(market_data.stocks[i].symbol, symbols[i]);
-        market_data.stocks[i].price = prices[i];
-        market_data.stocks[i].base_price = prices[i];
-        market_data.stocks[i].change_percent = 0.0;
-        market_data.stocks[i].volume = 1000000;
-    }
-    log_message("Market initialized with 10 simulated stocks");
+// Helper function to initialize client portfolio: a fresh account of its own until LOGIN
+void init_client_portfolio(ClientInfo* client) {
+    client->account = account_open(client->username, 0, INITIAL_BALANCE);
+    client->orders = NULL;
+    client->order_count = 0;
+    client->order_capacity = 0;
+    client->subscriptions = NULL;
+    client->subscription_count = 0;
+    client->subscription_capacity = 0;
+    outq_init(&client->outq);
+    client->touched = 0;
+    client->hold_seq = 0;
+    client->held = 0;
+    client->watch_interval_ns = 0;
+    client->watch_due_ns = 0;
+    client->watch_seq = WATCH_UNSENT;
+    client->watch_value = 0.0;
+    client->streams = NULL;
+    client->stream_count = 0;
+    client->stream_capacity = 0;
+    client->stream_all = 0;
+    client->stream_interval_ns = 0;
+    client->stream_due_ns = 0;
+    client->stream_min_change = 0.0;
+    client->stream_version = 0;
+    client->binary = 0;
+    client->inbuf = NULL;
+    client->inbuf_len = 0;
+    client->inbuf_capacity = 0;
+    client->discarding = 0;
 }
 
-// Helper function to initialize client portfolio
-void init_client_portfolio(ClientInfo* client) {
-    client->portfolio.wallet_balance = INITIAL_BALANCE;
-    client->portfolio.total_invested = 0.0;
-    client->portfolio.holding_count = 0;
-    
-    for (int i = 0; i < MAX_STOCKS; i++) {
-        client->portfolio.holdings[i].quantity = 0;
-        client->portfolio.holdings[i].avg_buy_price = 0.0;
-        strcpy(client->portfolio.holdings[i].symbol, "");
-        
-        client->subscriptions[i].active = 0;
-        client->subscriptions[i].threshold = 5.0; // Default 5% threshold
-        client->subscriptions[i].buy_alert_sent = 0;
-        client->subscriptions[i].sell_alert_sent = 0;
-    }
+// Queue a reply behind any pending broadcast output; the reactor flushes once per wakeup
+void session_queue(ClientInfo* client, Message* msg) {
+    if (!msg) return;
+    outq_push(&client->outq, msg, 0);
 }
 
-// Helper to find stock index by symbol (case-insensitive)
-int find_stock(const char* symbol) {
-    for (int i = 0; i < market_data.stock_count; i++) {
-        if (strcasecmp(market_data.stocks[i].symbol, symbol) == 0) {
-            return i;
-        }
+// Queue a text reply
+void session_reply(ClientInfo* client, const char* text) {
+    session_queue(client, message_create(text, strlen(text)));
+}
+
+// Helper to find (or create) the session's subscription to stock_id
+Subscription* get_subscription(ClientInfo* client, int stock_id, int create) {
+    for (int i = 0; i < client->subscription_count; i++) {
+        if (client->subscriptions[i]->stock_id == stock_id) return client->subscriptions[i];
+    }
+    if (!create) return NULL;
+    
+    if (client->subscription_count == client->subscription_capacity) {
+        client->subscription_capacity = client->subscription_capacity ? client->subscription_capacity * 2 : 4;
+        client->subscriptions = realloc(client->subscriptions,
+                                        sizeof(Subscription*) * client->subscription_capacity);
     }
-    return -1;
+    Subscription* sub = malloc(sizeof(Subscription));
+    sub->stock_id = stock_id;
+    sub->active = 0;
+    sub->threshold = 5.0; // Default 5% threshold
+    sub->client = client;
+    sub->index_pos = -1;
+    client->subscriptions[client->subscription_count++] = sub;
+    return sub;
 }
 
-// Helper to find client holding index by symbol (case-insensitive)
-int find_holding(ClientInfo* client, const char* symbol) {
-    for (int i = 0; i < client->portfolio.holding_count; i++) {
-        if (strcasecmp(client->portfolio.holdings[i].symbol, symbol) == 0) {
-            return i;
+// Render a trade result as the text protocol reply
+int format_trade(char* msg, const char* symbol, const TradeResult* r) {
+    const char* name = r->stock_id >= 0 ? market_stock(r->stock_id)->symbol : symbol;
+    
+    switch (r->error) {
+    case ERR_BAD_REQUEST:
+        return sprintf(msg, "ERROR: Invalid command or arguments. Type HELP.\n");
+    case ERR_INVALID_QUANTITY:
+        return sprintf(msg, "ERROR: Invalid quantity\n");
+    case ERR_UNKNOWN_SYMBOL:
+        return sprintf(msg, "ERROR: Stock %s not found\n", symbol);
+    case ERR_INSUFFICIENT_FUNDS:
+        return sprintf(msg, "ERROR: Insufficient funds. Need $%.2f, have $%.2f\n", r->amount, r->balance);
+    case ERR_NOT_OWNED:
+        return sprintf(msg, "ERROR: You don't own %s\n", symbol);
+    case ERR_INSUFFICIENT_SHARES:
+        return sprintf(msg, "ERROR: You only have %d shares of %s available\n", r->held, name);
+    case ERR_BAD_PRICE:
+        return sprintf(msg, "ERROR: Invalid limit price\n");
+    case ERR_BOOK_FULL:
+        return sprintf(msg, "ERROR: Order book for %s is full\n", name);
+    case ERR_BATCH_ABORTED:
+        return sprintf(msg, "ERROR: Not executed, another order in the batch failed\n");
+    }
+    
+    // Limit order: what traded on arrival, then what rests in the book
+    if (r->limit > 0.0) {
+        int offset = sprintf(msg, "\n✓ %s %d %s limit $%.2f\n",
+                             r->side == SIDE_BUY ? "BUY" : "SELL", r->quantity, name, r->limit);
+        if (r->filled > 0) {
+            offset += sprintf(msg + offset, "Filled: %d at avg $%.2f\n", r->filled, r->price);
+        }
+        if (r->resting > 0) {
+            offset += sprintf(msg + offset, "Resting: %d as ORDER %" PRIu64 "\n", r->resting, r->order_id);
         }
+        return offset + sprintf(msg + offset, "Balance: $%.2f\n\n", r->balance);
     }
-    return -1;
+    
+    if (r->side == SIDE_BUY) {
+        return sprintf(msg, "\n✓ BOUGHT %d shares of %s at $%.2f\n"
+                            "Total cost: $%.2f\n"
+                            "Remaining balance: $%.2f\n\n", 
+                            r->quantity, name, r->price, r->amount, r->balance);
+    }
+    
+    double pl_pct = (r->cost_basis == 0) ? 0.0 : (r->realized_pl / r->cost_basis) * 100;
+    return sprintf(msg, "\n✓ SOLD %d shares of %s at $%.2f\n"
+                        "Proceeds: $%.2f\n"
+                        "Profit/Loss: %s$%.2f (%.2f%%)\n"
+                        "New balance: $%.2f\n\n",
+                        r->quantity, name, r->price, r->amount,
+                        r->realized_pl >= 0 ? "+" : "", r->realized_pl, pl_pct,
+                        r->balance);
 }
 
 // Command handler: BUY
 void handle_buy(ClientInfo* client, char* symbol, int qty) {
     char msg[BUFFER_SIZE];
+    TradeResult result;
     
-    if (qty <= 0) {
-        sprintf(msg, "ERROR: Invalid quantity\n");
-        send(client->socket, msg, strlen(msg), 0);
-        return;
-    }
+    execute_buy(client, find_stock(symbol), qty, &result);
+    session_queue(client, message_create(msg, format_trade(msg, symbol, &result)));
+}
+
+// Command handler: SELL
+void handle_sell(ClientInfo* client, char* symbol, int qty) {
+    char msg[BUFFER_SIZE];
+    TradeResult result;
     
-    pthread_mutex_lock(&market_data.mutex);
-    int stock_idx = find_stock(symbol);
+    execute_sell(client, find_stock(symbol), qty, &result);
+    session_queue(client, message_create(msg, format_trade(msg, symbol, &result)));
+}
+
+// Command handler: BUY/SELL with a limit price
+void handle_limit(ClientInfo* client, int side, char* symbol, int qty, double limit) {
+    char msg[BUFFER_SIZE];
+    TradeResult result;
     
-    if (stock_idx < 0) {
-        sprintf(msg, "ERROR: Stock %s not found\n", symbol);
-        pthread_mutex_unlock(&market_data.mutex);
-        send(client->socket, msg, strlen(msg), 0);
+    execute_limit(client, find_stock(symbol), side, qty, limit, &result);
+    session_queue(client, message_create(msg, format_trade(msg, symbol, &result)));
+}
+
+// Command handler: BATCH [ATOMIC] BUY|SELL <symbol> <qty> [, ...]
+void handle_batch(ClientInfo* client, char* args) {
+    BatchOrder orders[PROTO_MAX_BATCH];
+    const char* symbols[PROTO_MAX_BATCH];
+    int count = 0, atomic = 0;
+    char* save = NULL;
+    char* token = strtok_r(args, " \t,", &save);
+    
+    if (token && strcasecmp(token, "ATOMIC") == 0) {
+        atomic = 1;
+        token = strtok_r(NULL, " \t,", &save);
+    }
+    while (token) {
+        char* symbol = strtok_r(NULL, " \t,", &save);
+        char* qty = symbol ? strtok_r(NULL, " \t,", &save) : NULL;
+        int side = strcasecmp(token, "BUY") == 0 ? SIDE_BUY : strcasecmp(token, "SELL") == 0 ? SIDE_SELL : -1;
+        if (!qty || side < 0) {
+            session_reply(client, "ERROR: Usage: BATCH [ATOMIC] BUY|SELL <symbol> <qty> ...\n");
+            return;
+        }
+        // Tokens are not bounded by the line parser; no listed symbol is this long
+        if (strlen(symbol) >= SYMBOL_LEN) {
+            session_reply(client, "ERROR: Invalid symbol in BATCH\n");
+            return;
+        }
+        if (count == PROTO_MAX_BATCH) {
+            session_reply(client, "ERROR: Too many orders in one BATCH\n");
+            return;
+        }
+        symbols[count] = symbol;
+        orders[count++] = (BatchOrder){ find_stock(symbol), side, atoi(qty) };
+        token = strtok_r(NULL, " \t,", &save);
+    }
+    if (count == 0) {
+        session_reply(client, "ERROR: Usage: BATCH [ATOMIC] BUY|SELL <symbol> <qty> ...\n");
         return;
     }
     
-    double price = market_data.stocks[stock_idx].price;
-    double cost = price * qty;
-    
-    if (cost > client->portfolio.wallet_balance) {
-        sprintf(msg, "ERROR: Insufficient funds. Need $%.2f, have $%.2f\n", 
-                        cost, client->portfolio.wallet_balance);
-        pthread_mutex_unlock(&market_data.mutex);
-        send(client->socket, msg, strlen(msg), 0);
+    int capacity = BUFFER_SIZE + count * 160;
+    TradeResult* results = malloc(sizeof(TradeResult) * count);
+    Message* out = results ? message_alloc(capacity) : NULL;
+    if (!out) {
+        free(results);
         return;
     }
-    
-    // Execute trade
-    client->portfolio.wallet_balance -= cost;
-    
-    int holding_idx = find_holding(client, symbol);
-    if (holding_idx >= 0) {
-        Holding* h = &client->portfolio.holdings[holding_idx];
-        double total_cost = (h->quantity * h->avg_buy_price) + cost;
-        h->quantity += qty;
-        h->avg_buy_price = total_cost / h->quantity;
-        client->portfolio.total_invested += cost;
+    int error = execute_batch(client, orders, count, atomic, results);
+    int filled = 0;
+    for (int i = 0; i < count; i++) filled += results[i].error == ERR_NONE;
+    
+    // Each row is rendered on its own and appended only as far as the reply has room
+    char* buffer = out->data;
+    char row[BUFFER_SIZE];
+    int offset = 0, len;
+    if (atomic && error != ERR_NONE) {
+        len = snprintf(row, sizeof(row), "\n✗ BATCH ATOMIC %d orders: none executed\n", count);
     } else {
-        Holding* h = &client->portfolio.holdings[client->portfolio.holding_count];
-        strcpy(h->symbol, market_data.stocks[stock_idx].symbol);
-        h->quantity = qty;
-        h->avg_buy_price = price;
-        client->portfolio.total_invested += cost;
-        client->portfolio.holding_count++;
+        len = snprintf(row, sizeof(row), "\n✓ BATCH %d orders: %d filled, %d rejected\n",
+                       count, filled, count - filled);
     }
-    
-    pthread_mutex_unlock(&market_data.mutex);
-    
-    sprintf(msg, "\n✓ BOUGHT %d shares of %s at $%.2f\n"
-                    "Total cost: $%.2f\n"
-                    "Remaining balance: $%.2f\n\n", 
-                    qty, symbol, price, cost, client->portfolio.wallet_balance);
-    send(client->socket, msg, strlen(msg), 0);
-    
-    sprintf(msg, "Client %s bought %d %s at $%.2f", client->username, qty, symbol, price);
-    log_message(msg);
+    for (int i = 0; i <= count; i++) {
+        if (len >= (int)sizeof(row)) len = sizeof(row) - 1;
+        if (len > capacity - offset) len = capacity - offset;
+        memcpy(buffer + offset, row, len);
+        offset += len;
+        if (i == count) break;
+        
+        const TradeResult* r = &results[i];
+        const char* name = r->stock_id >= 0 ? market_stock(r->stock_id)->symbol : symbols[i];
+        if (r->error != ERR_NONE) {
+            len = snprintf(row, sizeof(row), "  %s %d %s: ", r->side == SIDE_BUY ? "BUY" : "SELL",
+                           r->quantity, name);
+            len += format_trade(row + len, symbols[i], r);
+        } else if (r->side == SIDE_BUY) {
+            len = snprintf(row, sizeof(row), "  BOUGHT %d %s at $%.2f ($%.2f)\n",
+                           r->quantity, name, r->price, r->amount);
+        } else {
+            len = snprintf(row, sizeof(row), "  SOLD %d %s at $%.2f ($%.2f, P/L %s$%.2f)\n",
+                           r->quantity, name, r->price, r->amount,
+                           r->realized_pl >= 0 ? "+" : "", r->realized_pl);
+        }
+    }
+    account_lock(client->account);
+    double balance = client->account->portfolio.wallet_balance;
+    account_unlock(client->account);
+    offset += snprintf(buffer + offset, capacity - offset, "Balance: $%.2f\n\n", balance);
+    if (offset >= capacity) offset = capacity - 1;
+    free(results);
+    
+    out->len = offset;
+    session_queue(client, out);
 }
 
-// Command handler: SELL
-void handle_sell(ClientInfo* client, char* symbol, int qty) {
+// Command handler: CANCEL
+void handle_cancel(ClientInfo* client, const char* arg) {
     char msg[BUFFER_SIZE];
+    int remaining;
+    uint64_t order_id = strtoull(arg, NULL, 10);
     
-    if (qty <= 0) {
-        sprintf(msg, "ERROR: Invalid quantity\n");
-        send(client->socket, msg, strlen(msg), 0);
-        return;
-    }
-    
-    int holding_idx = find_holding(client, symbol);
-    if (holding_idx < 0) {
-        sprintf(msg, "ERROR: You don't own %s\n", symbol);
-        send(client->socket, msg, strlen(msg), 0);
-        return;
+    if (execute_cancel(client, order_id, &remaining) != ERR_NONE) {
+        sprintf(msg, "ERROR: No open order %s\n", arg);
+    } else {
+        sprintf(msg, "✓ ORDER %" PRIu64 " cancelled (%d unfilled)\n", order_id, remaining);
     }
-    
-    Holding* h = &client->portfolio.holdings[holding_idx];
-    if (qty > h->quantity) {
-        sprintf(msg, "ERROR: You only have %d shares of %s\n", h->quantity, symbol);
-        send(client->socket, msg, strlen(msg), 0);
+    session_reply(client, msg);
+}
+
+// Command handler: ORDERS
+void show_orders(ClientInfo* client) {
+    OrderEntry* entries;
+    int count = list_orders(client, &entries);
+    Message* out = message_alloc(BUFFER_SIZE + count * 80);
+    if (!out) {
+        free(entries);
         return;
     }
+    char* buffer = out->data;
+    int offset = 0;
     
-    pthread_mutex_lock(&market_data.mutex);
-    int stock_idx = find_stock(symbol);
-    double price = market_data.stocks[stock_idx].price;
-    double proceeds = price * qty;
-    double cost_basis_sold = h->avg_buy_price * qty;
-    double profit = proceeds - cost_basis_sold;
-    
-    // Execute trade
-    client->portfolio.wallet_balance += proceeds;
-    client->portfolio.total_invested -= cost_basis_sold; // Decrease invested amount by the cost basis of sold shares
-    h->quantity -= qty;
-    
-    if (h->quantity == 0) {
-        // Remove holding if quantity is zero by shifting array elements
-        for (int i = holding_idx; i < client->portfolio.holding_count - 1; i++) {
-            client->portfolio.holdings[i] = client->portfolio.holdings[i + 1];
-        }
-        client->portfolio.holding_count--;
+    offset += sprintf(buffer + offset, "\n═══════ OPEN ORDERS ═══════\n");
+    if (count == 0) {
+        offset += sprintf(buffer + offset, "No resting orders. Add a price to BUY/SELL to place one.\n");
     } else {
-        // If holding remains, the avg_buy_price is unchanged.
+        offset += sprintf(buffer + offset, "%-20s | %-6s | %-4s | %6s | %s\n", "Order", "Stock", "Side", "Qty", "Limit");
+        for (int i = 0; i < count; i++) {
+            offset += sprintf(buffer + offset, "%-20" PRIu64 " | %-6s | %-4s | %6d | $%.2f\n",
+                              entries[i].order_id, market_stock(entries[i].symbol_id)->symbol,
+                              entries[i].side == SIDE_BUY ? "BUY" : "SELL", entries[i].quantity, entries[i].price);
+        }
     }
+    offset += sprintf(buffer + offset, "\n");
+    free(entries);
     
-    pthread_mutex_unlock(&market_data.mutex);
-    
-    double pl_pct = (cost_basis_sold == 0) ? 0.0 : (profit / cost_basis_sold) * 100;
-    
-    sprintf(msg, "\n✓ SOLD %d shares of %s at $%.2f\n"
-                    "Proceeds: $%.2f\n"
-                    "Profit/Loss: %s$%.2f (%.2f%%)\n"
-                    "New balance: $%.2f\n\n",
-                    qty, symbol, price, proceeds,
-                    profit >= 0 ? "+" : "", profit, pl_pct,
-                    client->portfolio.wallet_balance);
-    send(client->socket, msg, strlen(msg), 0);
-    
-    sprintf(msg, "Client %s sold %d %s at $%.2f (P/L: $%.2f)", 
-            client->username, qty, symbol, price, profit);
-    log_message(msg);
+    out->len = offset;
+    session_queue(client, out);
 }
 
 // Command handler: PORTFOLIO
 void show_portfolio(ClientInfo* client) {
-    char buffer[BUFFER_SIZE * 2];
+    Portfolio* p = &client->account->portfolio;
+    
+    // Other sessions and resting order fills may be changing the account meanwhile
+    account_lock(client->account);
+    
+    // Sized for the header, footer and one row per holding
+    int capacity = BUFFER_SIZE + p->holding_count * 96;
+    Message* out = message_alloc(capacity);
+    if (!out) {
+        account_unlock(client->account);
+        return;
+    }
+    char* buffer = out->data;
     int offset = 0;
     
     offset += sprintf(buffer + offset, "\n╔══════════════════════════════════════════════════╗\n");
     offset += sprintf(buffer + offset, "║           PORTFOLIO - %s%-24s║\n", client->username, "");
     offset += sprintf(buffer + offset, "╚══════════════════════════════════════════════════╝\n");
-    offset += sprintf(buffer + offset, "💰 Wallet: $%.2f\n", client->portfolio.wallet_balance);
+    offset += sprintf(buffer + offset, "💰 Wallet: $%.2f\n", p->wallet_balance);
+    if (client->order_count > 0) {
+        offset += sprintf(buffer + offset, "🔒 Open orders: %d (cash set aside: $%.2f)\n",
+                          client->order_count, p->reserved_cash);
+    }
     
-    if (client->portfolio.holding_count == 0) {
+    if (p->holding_count == 0) {
         offset += sprintf(buffer + offset, "📊 Invested: $%.2f\n\n", 0.00);
         offset += sprintf(buffer + offset, "No holdings. Use BUY command to purchase stocks.\n");
     } else {
-        pthread_mutex_lock(&market_data.mutex);
-        
         offset += sprintf(buffer + offset, "Holdings:\n");
         offset += sprintf(buffer + offset, "%-6s | Qty | Avg Buy | Current | Value    | P/L\n", "Stock");
         offset += sprintf(buffer + offset, "--------------------------------------------------------\n");
         
-        double total_market_value = 0;
-        double total_invested_cost = 0;
+        // Holdings are valued at their marks, kept current by the producer (holders.c)
+        double total_market_value = p->market_value;
+        double total_invested_cost = p->total_invested;
 
-        for (int i = 0; i < client->portfolio.holding_count; i++) {
-            Holding* h = &client->portfolio.holdings[i];
-            int stock_idx = find_stock(h->symbol);
-            double current_price = market_data.stocks[stock_idx].price;
+        for (int i = 0; i < p->holding_count; i++) {
+            Holding* h = &p->holdings[i];
+            double current_price = h->mark_price;
             
             double cost_basis = h->quantity * h->avg_buy_price;
             double value = h->quantity * current_price;
             double pl = value - cost_basis;
             double pl_pct = (h->avg_buy_price == 0) ? 0.0 : ((current_price - h->avg_buy_price) / h->avg_buy_price) * 100;
             
-            total_market_value += value;
-            total_invested_cost += cost_basis;
-            
             offset += sprintf(buffer + offset, "%-6s | %3d | $%6.2f | $%6.2f | $%7.2f | %s%.2f%%\n",
-                                h->symbol, h->quantity, h->avg_buy_price, current_price, 
-                                value, pl >= 0 ? "+" : "", pl_pct);
+                                market_stock(h->stock_id)->symbol, h->quantity, h->avg_buy_price,
+                                current_price, value, pl >= 0 ? "+" : "", pl_pct);
         }
         
-        pthread_mutex_unlock(&market_data.mutex);
-        
         double total_portfolio_pl = total_market_value - total_invested_cost;
         
         offset += sprintf(buffer + offset, "--------------------------------------------------------\n");
@@ -253,109 +364,412 @@ void show_portfolio(ClientInfo* client) {
         offset += sprintf(buffer + offset, "Total P/L: %s$%.2f\n", 
                             total_portfolio_pl >= 0 ? "+" : "", total_portfolio_pl);
     }
+    account_unlock(client->account);
     
     offset += sprintf(buffer + offset, "\n");
-    send(client->socket, buffer, offset, 0);
+    out->len = offset;
+    session_queue(client, out);
 }
 
-// Command handler: AVAILABLE
+// Command handler: AVAILABLE (rendered once per market version, see available_message)
 void show_available(ClientInfo* client) {
-    char buffer[BUFFER_SIZE];
-    int offset = 0;
-    
-    pthread_mutex_lock(&market_data.mutex);
-    
-    offset += sprintf(buffer + offset, "\n═══════ AVAILABLE STOCKS (Simulated) ═══════\n");
-    offset += sprintf(buffer + offset, "%-6s | %-8s | %-6s\n", "Symbol", "Price", "Change");
-    offset += sprintf(buffer + offset, "----------------------------------------\n");
-    for (int i = 0; i < market_data.stock_count; i++) {
-        offset += sprintf(buffer + offset, "%-6s | $%8.2f | %+.2f%%\n",
-                            market_data.stocks[i].symbol, 
-                            market_data.stocks[i].price,
-                            market_data.stocks[i].change_percent);
+    session_queue(client, available_message());
+}
+
+// Arm (or re-arm) an alert subscription; *alert receives an alert that fires right away
+int execute_subscribe(ClientInfo* client, int stock_idx, double threshold, Message** alert) {
+    *alert = NULL;
+    if (stock_idx < 0) return ERR_UNKNOWN_SYMBOL;
+    if (threshold <= 0.0) return ERR_BAD_THRESHOLD;
+    
+    Stock s;
+    market_read(stock_idx, &s);
+    
+    SymbolSubs* index = subindex_get(stock_idx);
+    Subscription* sub = get_subscription(client, stock_idx, 1);
+    
+    // Re-key the subscription: the index columns hold the old threshold
+    pthread_mutex_lock(&index->lock);
+    subindex_remove(index, sub);
+    sub->active = 1;
+    sub->threshold = threshold;
+    
+    // Alerts are evaluated per tick of the symbol, so check the current move right away
+    if (s.change_percent <= -threshold) {
+        *alert = alert_message(stock_idx, &s, 1, client->binary);
+        subindex_arm(index, sub, 0, 1);
+    } else if (s.change_percent >= threshold) {
+        *alert = alert_message(stock_idx, &s, 0, client->binary);
+        subindex_arm(index, sub, 1, 0);
+    } else {
+        subindex_arm(index, sub, 1, 1);
     }
-    offset += sprintf(buffer + offset, "════════════════════════════════════════\n");
-    
-    pthread_mutex_unlock(&market_data.mutex);
-    
-    send(client->socket, buffer, offset, 0);
+    pthread_mutex_unlock(&index->lock);
+    return ERR_NONE;
 }
 
 // Command handler: SUBSCRIBE
 void handle_subscribe(ClientInfo* client, char* symbol, double threshold) {
     char msg[BUFFER_SIZE];
+    Message* alert;
     
     int stock_idx = find_stock(symbol);
-    if (stock_idx < 0) {
-        sprintf(msg, "ERROR: Stock %s not found\n", symbol);
-        send(client->socket, msg, strlen(msg), 0);
-        return;
-    }
+    int error = execute_subscribe(client, stock_idx, threshold, &alert);
     
-    if (threshold <= 0.0) {
+    if (error == ERR_UNKNOWN_SYMBOL) {
+        sprintf(msg, "ERROR: Stock %s not found\n", symbol);
+    } else if (error == ERR_BAD_THRESHOLD) {
         sprintf(msg, "ERROR: Threshold must be positive.\n");
-        send(client->socket, msg, strlen(msg), 0);
-        return;
+    } else {
+        sprintf(msg, "✓ Subscribed to %s for price changes of %.1f%% or more.\n",
+                market_stock(stock_idx)->symbol, threshold);
     }
+    session_reply(client, msg);
+    session_queue(client, alert);
+}
 
-    client->subscriptions[stock_idx].active = 1;
-    client->subscriptions[stock_idx].threshold = threshold;
-    client->subscriptions[stock_idx].buy_alert_sent = 0;
-    client->subscriptions[stock_idx].sell_alert_sent = 0;
-    
-    sprintf(msg, "✓ Subscribed to %s for price changes of %.1f%% or more.\n", symbol, threshold);
-    send(client->socket, msg, strlen(msg), 0);
+// Attach the session to a named account, created on first use; returns ERR_*
+int execute_login(ClientInfo* client, const char* name) {
+    if (!account_name_valid(name)) return ERR_BAD_ACCOUNT;
+    
+    // Resting orders settle against the account that set their cash or shares aside
+    account_lock(client->account);
+    int open_orders = client->order_count;
+    account_unlock(client->account);
+    if (open_orders > 0) return ERR_ORDERS_OPEN;
+    
+    Account* account = account_open(name, 1, INITIAL_BALANCE);
+    if (!account) return ERR_BAD_ACCOUNT;
+    Account* previous = client->account;
+    client->account = account;
+    account_close(previous);
+    snprintf(client->username, sizeof(client->username), "%s", name);
+    client->watch_seq = WATCH_UNSENT; // A watcher gets the new account's figures next
+    return ERR_NONE;
 }
 
-// Alert checker
-void check_alerts(ClientInfo* client) {
-    char alert[BUFFER_SIZE];
-    
-    pthread_mutex_lock(&market_data.mutex);
+// Command handler: LOGIN
+void handle_login(ClientInfo* client, const char* name) {
+    char msg[BUFFER_SIZE];
+    int error = execute_login(client, name);
     
-    for (int i = 0; i < market_data.stock_count; i++) {
-        if (!client->subscriptions[i].active) continue;
-        
-        Stock* s = &market_data.stocks[i];
-        Subscription* sub = &client->subscriptions[i];
-        
-        // Check for Buy Alert (Price drop greater than or equal to threshold)
-        if (s->change_percent <= -sub->threshold && !sub->buy_alert_sent) {
-            sprintf(alert, "\n🔔 BUY ALERT: %s at $%.2f (%.2f%% drop)\n", 
-                            s->symbol, s->price, s->change_percent);
-            send(client->socket, alert, strlen(alert), 0);
-            sub->buy_alert_sent = 1;
-            sub->sell_alert_sent = 0; // Reset sell alert after a drop
-        }
-        
-        // Check for Sell Alert (Price rise greater than or equal to threshold)
-        if (s->change_percent >= sub->threshold && !sub->sell_alert_sent) {
-            sprintf(alert, "\n🔔 SELL ALERT: %s at $%.2f (%.2f%% rise)\n", 
-                            s->symbol, s->price, s->change_percent);
-            send(client->socket, alert, strlen(alert), 0);
-            sub->sell_alert_sent = 1;
-            sub->buy_alert_sent = 0; // Reset buy alert after a rise
+    if (error == ERR_BAD_ACCOUNT) {
+        sprintf(msg, "ERROR: Invalid account name (letters, digits, '_', '-', '.')\n");
+    } else if (error == ERR_ORDERS_OPEN) {
+        sprintf(msg, "ERROR: Cancel your open orders before switching accounts\n");
+    } else {
+        account_lock(client->account);
+        sprintf(msg, "✓ Logged in as %s (account %u), balance $%.2f\n",
+                client->account->name, client->account->id, client->account->portfolio.wallet_balance);
+        account_unlock(client->account);
+    }
+    session_reply(client, msg);
+}
+
+// Start, retune or stop (interval_ms 0) P/L updates; faster than WATCH_MIN_MS is clamped
+int execute_watch(ClientInfo* client, int interval_ms) {
+    if (interval_ms < 0) return ERR_BAD_REQUEST;
+    if (interval_ms > 0 && interval_ms < WATCH_MIN_MS) interval_ms = WATCH_MIN_MS;
+    reactor_watch(client, interval_ms * 1000000LL);
+    return ERR_NONE;
+}
+
+// Next PORTFOLIO WATCH update, or NULL if the account has not been revalued since the
+// last one. Only the totals are sent; PORTFOLIO still lists the holdings.
+Message* portfolio_update(ClientInfo* client) {
+    Portfolio* p = &client->account->portfolio;
+    
+    account_lock(client->account);
+    if (p->mark_seq == client->watch_seq) {
+        account_unlock(client->account);
+        return NULL;
+    }
+    double value = p->market_value;
+    double unrealized = value - p->total_invested;
+    double change = client->watch_seq == WATCH_UNSENT ? 0.0 : value - client->watch_value;
+    double wallet = p->wallet_balance;
+    int holding_count = p->holding_count;
+    client->watch_seq = p->mark_seq;
+    client->watch_value = value;
+    account_unlock(client->account);
+    
+    if (client->binary) {
+        PnlMsg frame;
+        memset(&frame, 0, sizeof(frame));
+        proto_header(&frame.hdr, MSG_PNL, sizeof(frame), 0);
+        frame.market_value = value;
+        frame.unrealized_pl = unrealized;
+        frame.value_change = change;
+        frame.wallet_balance = wallet;
+        frame.holding_count = holding_count;
+        return message_create((const char*)&frame, sizeof(frame));
+    }
+    return message_format("\n📈 P/L: value $%.2f (%s%.2f) | unrealized %s$%.2f | cash $%.2f\n",
+                          value, change >= 0 ? "+" : "", change,
+                          unrealized >= 0 ? "+" : "-", fabs(unrealized), wallet);
+}
+
+// Command handler: PORTFOLIO WATCH [ms] / PORTFOLIO UNWATCH
+void handle_watch(ClientInfo* client, const char* mode, const char* interval) {
+    char msg[BUFFER_SIZE];
+    int interval_ms = 0;
+    if (strcasecmp(mode, "WATCH") == 0) {
+        interval_ms = interval ? atoi(interval) : WATCH_DEFAULT_MS;
+        if (interval_ms <= 0) {
+            session_reply(client, "ERROR: Interval must be a positive number of milliseconds\n");
+            return;
         }
+    } else if (strcasecmp(mode, "UNWATCH") != 0) {
+        session_reply(client, "ERROR: Invalid command or arguments. Type HELP.\n");
+        return;
     }
     
-    pthread_mutex_unlock(&market_data.mutex);
+    execute_watch(client, interval_ms);
+    if (interval_ms == 0) {
+        sprintf(msg, "✓ Stopped portfolio updates\n");
+    } else {
+        sprintf(msg, "✓ Portfolio P/L pushed at most every %d ms (PORTFOLIO UNWATCH to stop)\n",
+                (int)(client->watch_interval_ns / 1000000));
+    }
+    session_reply(client, msg);
+}
+
+// Stream every listed symbol; entries are kept in ID order so lookups stay O(1)
+static void stream_all_symbols(ClientInfo* client) {
+    int count = market_symbol_count();
+    if (client->stream_capacity < count) {
+        client->streams = realloc(client->streams, sizeof(QuoteStream) * count);
+        client->stream_capacity = count;
+    }
+    for (int i = client->stream_all ? client->stream_count : 0; i < count; i++) {
+        client->streams[i].stock_id = i;
+        client->streams[i].price = NAN;
+        client->streams[i].muted = 0;
+    }
+    client->stream_count = count;
+    client->stream_all = 1;
+}
+
+// Stream entry for a symbol, appended (nothing reported yet) if missing and create is set
+static QuoteStream* get_stream(ClientInfo* client, int stock_id, int create) {
+    if (client->stream_all) {
+        // Entry i is symbol i: a newer listing grows the table rather than being appended
+        if (stock_id >= client->stream_count && create) stream_all_symbols(client);
+        return stock_id < client->stream_count ? &client->streams[stock_id] : NULL;
+    }
+    for (int i = 0; i < client->stream_count; i++) {
+        if (client->streams[i].stock_id == stock_id) return &client->streams[i];
+    }
+    if (!create) return NULL;
+
+    if (client->stream_count == client->stream_capacity) {
+        client->stream_capacity = client->stream_capacity ? client->stream_capacity * 2 : 4;
+        client->streams = realloc(client->streams, sizeof(QuoteStream) * client->stream_capacity);
+    }
+    QuoteStream* stream = &client->streams[client->stream_count++];
+    stream->stock_id = stock_id;
+    stream->price = NAN;
+    stream->muted = 0;
+    return stream;
+}
+
+// Start streaming one symbol (or STREAM_ALL) and set the session's pacing, which covers
+// all of its streams; returns ERR_*. The caller sends the snapshot the updates start
+// from and records it with stream_seen.
+int execute_stream(ClientInfo* client, int stock_idx, int interval_ms, double min_change) {
+    if (stock_idx == -1) return ERR_UNKNOWN_SYMBOL;
+    if (!(min_change >= 0.0)) return ERR_BAD_THRESHOLD;
+    if (interval_ms < 0) return ERR_BAD_REQUEST;
+    if (interval_ms < STREAM_MIN_MS) interval_ms = STREAM_MIN_MS;
+
+    if (stock_idx == STREAM_ALL) {
+        stream_all_symbols(client);
+        for (int i = 0; i < client->stream_count; i++) client->streams[i].muted = 0;
+    } else {
+        get_stream(client, stock_idx, 1)->muted = 0;
+    }
+    client->stream_min_change = min_change;
+    reactor_stream(client, interval_ms * 1000000LL);
+    return ERR_NONE;
+}
+
+// Stop streaming one symbol (or STREAM_ALL); returns ERR_*
+int execute_unstream(ClientInfo* client, int stock_idx) {
+    if (stock_idx == -1) return ERR_UNKNOWN_SYMBOL;
+
+    QuoteStream* stream = stock_idx == STREAM_ALL ? NULL : get_stream(client, stock_idx, 0);
+    if (stock_idx == STREAM_ALL) {
+        client->stream_count = 0;
+        client->stream_all = 0;
+    } else if (client->stream_all && stream) {
+        stream->muted = 1; // Later listings still join the stream
+    } else if (stream) {
+        *stream = client->streams[--client->stream_count];
+    }
+
+    if (client->stream_count == 0) {
+        free(client->streams);
+        client->streams = NULL;
+        client->stream_capacity = 0;
+        reactor_stream(client, 0);
+    }
+    return ERR_NONE;
+}
+
+// Record the quotes a snapshot showed the client, so updates are measured from them
+void stream_seen(ClientInfo* client, const QuoteEntry* quotes, int count) {
+    for (int i = 0; i < count; i++) {
+        QuoteStream* stream = get_stream(client, quotes[i].symbol_id, 0);
+        if (stream) stream->price = quotes[i].price;
+    }
+}
+
+// Queue a quote for every streamed symbol that moved at least stream_min_change since
+// the price the client last saw; returns the number queued. Only the current price is
+// read, so ticks between polls coalesce, and quotes are keyed by symbol so a
+// backlogged session keeps only the newest one per stock.
+int stream_updates(ClientInfo* client) {
+    unsigned long version = market_version();
+    if (version == client->stream_version) return 0;
+    client->stream_version = version;
+    if (client->stream_all && client->stream_count < market_symbol_count()) stream_all_symbols(client);
+
+    int queued = 0;
+    for (int i = 0; i < client->stream_count; i++) {
+        QuoteStream* stream = &client->streams[i];
+        if (stream->muted) continue;
+        Stock s;
+        market_read(stream->stock_id, &s);
+        if (s.price == stream->price) continue;
+        if (fabs(s.price - stream->price) < fabs(stream->price) * client->stream_min_change / 100) continue;
+
+        Message* msg = quote_message(stream->stock_id, &s, client->binary);
+        if (!msg) break;
+        outq_push(&client->outq, msg, QUOTE_KEY(stream->stock_id));
+        stream->price = s.price;
+        queued++;
+    }
+    return queued;
+}
+
+// Command handler: STREAM <symbol|ALL> [ms] [min%]
+void handle_stream(ClientInfo* client, const char* symbol, const char* interval, const char* min_change) {
+    char msg[BUFFER_SIZE];
+    int stock_idx = strcasecmp(symbol, "ALL") == 0 ? STREAM_ALL : find_stock(symbol);
+    int interval_ms = interval ? atoi(interval) : STREAM_DEFAULT_MS;
+    double min = min_change ? atof(min_change) : 0.0;
+    if (interval_ms <= 0) {
+        session_reply(client, "ERROR: Interval must be a positive number of milliseconds\n");
+        return;
+    }
+
+    int error = execute_stream(client, stock_idx, interval_ms, min);
+    if (error == ERR_UNKNOWN_SYMBOL) {
+        sprintf(msg, "ERROR: Stock %s not found\n", symbol);
+        session_reply(client, msg);
+        return;
+    }
+    if (error != ERR_NONE) {
+        session_reply(client, "ERROR: Minimum change must not be negative\n");
+        return;
+    }
+    sprintf(msg, "✓ Streaming %s every %d ms on moves of %.2f%% or more (UNSTREAM to stop)\n",
+            stock_idx == STREAM_ALL ? "ALL" : market_stock(stock_idx)->symbol,
+            (int)(client->stream_interval_ns / 1000000), min);
+    session_reply(client, msg);
+
+    // Snapshot first; updates follow from the prices it shows
+    if (stock_idx == STREAM_ALL) {
+        Message* parts[MAX_MARKET_SHARDS];
+        int count;
+        int shards = snapshot_quotes(parts, NULL, &count);
+        for (int k = 0; k < shards; k++) {
+            stream_seen(client, (const QuoteEntry*)parts[k]->data, parts[k]->len / sizeof(QuoteEntry));
+        }
+        if (shards) session_queue(client, render_available(parts, shards, count));
+        for (int k = 0; k < shards; k++) message_unref(parts[k]);
+    } else {
+        Stock s;
+        market_read(stock_idx, &s);
+        QuoteEntry quote = { stock_idx, s.volume, s.price, s.change_percent };
+        stream_seen(client, &quote, 1);
+        session_queue(client, quote_message(stock_idx, &s, 0));
+    }
+}
+
+// Command handler: UNSTREAM [symbol|ALL]
+void handle_unstream(ClientInfo* client, const char* symbol) {
+    char msg[BUFFER_SIZE];
+    int stock_idx = !symbol || strcasecmp(symbol, "ALL") == 0 ? STREAM_ALL : find_stock(symbol);
+
+    if (execute_unstream(client, stock_idx) != ERR_NONE) {
+        sprintf(msg, "ERROR: Stock %s not found\n", symbol);
+    } else if (stock_idx == STREAM_ALL) {
+        sprintf(msg, "✓ Stopped all quote streams\n");
+    } else {
+        sprintf(msg, "✓ Stopped streaming %s\n", market_stock(stock_idx)->symbol);
+    }
+    session_reply(client, msg);
+}
+
+// Command handler: SESSION (output queue state of this connection)
+void show_session(ClientInfo* client) {
+    OutQueue* q = &client->outq;
+    Message* out = message_format("Session %s: %d message(s) queued (%zu bytes), peak %zu bytes, "
+                                  "%" PRIu64 " update(s) conflated, limit %d bytes\n",
+                                  client->username, q->count, q->bytes, q->peak_bytes,
+                                  q->conflated, OUTQ_LIMIT_BYTES);
+    session_queue(client, out);
+}
+
+// Command handler: STATS (server-wide latency histograms and counters)
+void show_stats(ClientInfo* client) {
+    size_t len = 0;
+    char* report = metrics_render(0, &len);
+    if (!report) {
+        session_reply(client, "ERROR: Statistics unavailable\n");
+        return;
+    }
+    session_queue(client, message_create(report, (int)len));
+    free(report);
 }
 
 // Command dispatcher
 void handle_command(ClientInfo* client, char* command) {
-    char cmd[32], arg1[32], arg2[32];
-    // Read up to three arguments
-    int n = sscanf(command, "%s %s %s", cmd, arg1, arg2);
+    char cmd[32], arg1[32], arg2[32], arg3[32];
+    // Read up to four arguments
+    int n = sscanf(command, "%31s %31s %31s %31s", cmd, arg1, arg2, arg3);
     
-    if (strcasecmp(cmd, "BUY") == 0 && n == 3) {
+    if (strcasecmp(cmd, "BATCH") == 0 && n >= 2) {
+        handle_batch(client, command + strspn(command, " \t") + strlen(cmd));
+    }
+    else if (strcasecmp(cmd, "BUY") == 0 && n == 3) {
         handle_buy(client, arg1, atoi(arg2));
     }
     else if (strcasecmp(cmd, "SELL") == 0 && n == 3) {
         handle_sell(client, arg1, atoi(arg2));
     }
+    else if (strcasecmp(cmd, "BUY") == 0 && n == 4) {
+        handle_limit(client, SIDE_BUY, arg1, atoi(arg2), atof(arg3));
+    }
+    else if (strcasecmp(cmd, "SELL") == 0 && n == 4) {
+        handle_limit(client, SIDE_SELL, arg1, atoi(arg2), atof(arg3));
+    }
+    else if (strcasecmp(cmd, "CANCEL") == 0 && n == 2) {
+        handle_cancel(client, arg1);
+    }
+    else if (strcasecmp(cmd, "ORDERS") == 0 && n <= 1) {
+        show_orders(client);
+    }
+    else if (strcasecmp(cmd, "LOGIN") == 0 && n == 2) {
+        handle_login(client, arg1);
+    }
     else if (strcasecmp(cmd, "PORTFOLIO") == 0 && n <= 1) {
         show_portfolio(client);
     }
+    else if (strcasecmp(cmd, "PORTFOLIO") == 0 && n <= 3) {
+        handle_watch(client, arg1, n == 3 ? arg2 : NULL);
+    }
     else if (strcasecmp(cmd, "AVAILABLE") == 0 && n <= 1) {
         show_available(client);
     }
@@ -363,204 +777,643 @@ void handle_command(ClientInfo* client, char* command) {
         double thresh = n == 3 ? atof(arg2) : 5.0;
         handle_subscribe(client, arg1, thresh);
     }
+    else if (strcasecmp(cmd, "STREAM") == 0 && n >= 2) {
+        handle_stream(client, arg1, n >= 3 ? arg2 : NULL, n == 4 ? arg3 : NULL);
+    }
+    else if (strcasecmp(cmd, "UNSTREAM") == 0 && n <= 2) {
+        handle_unstream(client, n == 2 ? arg1 : NULL);
+    }
+    else if (strcasecmp(cmd, "SESSION") == 0 && n <= 1) {
+        show_session(client);
+    }
+    else if (strcasecmp(cmd, "STATS") == 0 && n <= 1) {
+        show_stats(client);
+    }
     else if (strcasecmp(cmd, "HELP") == 0 && n <= 1) {
         const char* help = 
             "\n╔═══════════════════════════════════════╗\n"
             "║         TRADING COMMANDS              ║\n"
             "╠═══════════════════════════════════════╣\n"
-            "║ BUY <symbol> <qty>    - Buy stocks   ║\n"
-            "║ SELL <symbol> <qty>   - Sell stocks  ║\n"
+            "║ BUY <symbol> <qty> [p] - Buy stocks  ║\n"
+            "║ SELL <symbol> <qty> [p]- Sell stocks ║\n"
+            "║ BATCH [ATOMIC] <orders> - Many orders║\n"
+            "║ ORDERS                - Open orders  ║\n"
+            "║ CANCEL <order>        - Cancel order ║\n"
             "║ PORTFOLIO             - View holdings║\n"
+            "║ PORTFOLIO WATCH [ms]  - Live P/L     ║\n"
             "║ AVAILABLE             - List stocks  ║\n"
             "║ SUBSCRIBE <symbol> [t] - Get alerts  ║\n"
+            "║ STREAM <sym|ALL> [ms] [m] - Quotes   ║\n"
+            "║ UNSTREAM [symbol]     - Stop quotes  ║\n"
+            "║ LOGIN <name>          - Use account  ║\n"
+            "║ SESSION               - Queue stats  ║\n"
+            "║ STATS                 - Server stats ║\n"
+            "║ BINARY                - Binary mode  ║\n"
             "║ HELP                  - This help    ║\n"
             "║ QUIT                  - Exit         ║\n"
             "╚═══════════════════════════════════════╝\n"
-            "Note: [t] is optional alert threshold (e.g. 1.5)\n";
-        send(client->socket, help, strlen(help), 0);
+            "Note: [t] is optional alert threshold (e.g. 1.5)\n"
+            "      [p] is a limit price; the unfilled rest waits in the book\n"
+            "      <orders> is BUY|SELL <symbol> <qty>, repeated (comma optional)\n"
+            "      [ms] [m] pace quotes: at most one per symbol per ms, moves of m% or more\n";
+        session_reply(client, help);
     }
     else if (strcasecmp(cmd, "QUIT") == 0 && n <= 1) {
         client->active = 0;
-        const char* goodbye = "CLOSING_CONNECTION\n";
-        send(client->socket, goodbye, strlen(goodbye), 0);
+        session_reply(client, "CLOSING_CONNECTION\n");
     }
     else {
-        const char* msg = "ERROR: Invalid command or arguments. Type HELP.\n";
-        send(client->socket, msg, strlen(msg), 0);
+        session_reply(client, "ERROR: Invalid command or arguments. Type HELP.\n");
     }
 }
 
-// Producer thread function (Market simulator)
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Producer thread function (Market simulator): publishes one shard of the tick engine's
+// stream on its schedule, or a recorded tick file at its original pace scaled by the
+// replay speed. Shards share no lock: each has its own symbols, mutex, version and
+// broadcast batches.
 void* producer_thread(void* arg) {
-    log_message("Producer thread started (Simulating Market)");
+    const ProducerConfig* config = (const ProducerConfig*)arg;
+    Replay* replay = config->replay;
+    MarketShard* shard = market_shard(config->shard);
+    SimEngine engine;
+    BroadcastBatch batch;
+    int* updated = malloc(sizeof(int) * SIM_MAX_BATCH);
+    uint64_t* marks = NULL;     // Round in which each symbol was last updated
+    int marks_capacity = 0;
+    uint64_t round = 0;
+    uint64_t published = 0;
+    int replay_finished = 0;
+    
+    memset(&batch, 0, sizeof(batch));
+    sim_init(&engine, &config->sim, config->shard, market_shard_count());
+    if (market_shard_count() > 1) {
+        char msg[96];
+        sprintf(msg, "Producer thread started (Simulating Market, shard %d of %d)",
+                config->shard, market_shard_count());
+        log_message(msg);
+    } else {
+        log_message(replay ? "Producer thread started (Replaying ticks)" : "Producer thread started (Simulating Market)");
+    }
+    
+    // Per-tick price logging only at rates a person can read
+    int log_ticks = replay ? replay->speed > 0.0 && replay->speed <= 1.0 : engine.total_rate <= SIM_LOG_MAX_RATE;
+    double next_due = (double)monotonic_ns();
+    int64_t summary_at = monotonic_ns() + 1000000000;
+    uint64_t summary_ticks = 0;
     
     while (server_running) {
-        sleep(3); // Update prices every 3 seconds
+        int64_t now = monotonic_ns();
         
-        pthread_mutex_lock(&market_data.mutex);
+        // Once a second at high rates instead of one log record per tick
+        if (now >= summary_at) {
+            if (!log_ticks && published != summary_ticks) {
+                char msg[128];
+                if (market_shard_count() > 1) {
+                    sprintf(msg, "Tick engine shard %d: %" PRIu64 " ticks in the last second",
+                            config->shard, published - summary_ticks);
+                } else {
+                    sprintf(msg, "Tick %s: %" PRIu64 " ticks in the last second",
+                            replay ? "replay" : "engine", published - summary_ticks);
+                }
+                log_message(msg);
+            }
+            summary_ticks = published;
+            summary_at = now + 1000000000;
+        }
         
-        // Randomly update prices of 1 or 2 stocks
-        for (int i = 0; i < (rand() % 2) + 1; i++) {
-            int idx = rand() % market_data.stock_count;
-            Stock* s = &market_data.stocks[idx];
-            
-            // Random change between -3.00% and +3.00%
-            double change = ((rand() % 600) - 300) / 10000.0; // (-0.03 to 0.03)
-            s->price *= (1 + change);
-            
-            // Ensure price stays positive and isn't ridiculously high
-            if (s->price < 0.01) s->price = s->base_price * 0.9;
-            if (s->price > s->base_price * 5) s->price = s->base_price * 2;
-            
-            s->change_percent = ((s->price - s->base_price) / s->base_price) * 100;
+        // Ticks due by now, capped per round
+        int total = 0;
+        int64_t wait = 100000000;
+        if (replay) {
+            if (replay_done(replay)) {
+                if (!replay_finished) log_message("Replay finished; prices stay at their last values");
+                replay_finished = 1;
+            } else {
+                total = replay_due(replay, now, SIM_MAX_BATCH, &wait);
+            }
+        } else if (engine.total_rate > 0.0) {
+            if (next_due <= now) {
+                // A lagging engine resumes from now rather than bursting to catch up
+                double interval = 1e9 / engine.total_rate;
+                total = (int)((now - next_due) / interval) + 1;
+                if (total > SIM_MAX_BATCH) {
+                    total = SIM_MAX_BATCH;
+                    next_due = now;
+                }
+                next_due += total * interval;
+            } else {
+                wait = (int64_t)next_due - now;
+            }
+        }
+        
+        // Sleep until the next tick is due, in short slices so shutdown stays prompt
+        if (total == 0) {
+            if (wait > 100000000) wait = 100000000;
+            struct timespec ts = {wait / 1000000000, wait % 1000000000};
+            nanosleep(&ts, NULL);
+            if (!replay && engine.total_rate <= 0.0) sim_refresh(&engine);
+            continue;
+        }
+        round++;
+        
+        metrics_lock(&shard->mutex);
+        market_begin(config->shard);
+        
+        int64_t tick_ns = realtime_ns();
+        int update_total = 0;
+        for (int i = 0; i < total; i++) {
+            double price, change_percent;
+            int idx, volume;
+            if (replay) {
+                idx = replay_next(replay, &price, &volume);
+                if (idx < 0) continue;
+                double base = market_stock(idx)->base_price;
+                change_percent = ((price - base) / base) * 100;
+            } else {
+                idx = sim_next(&engine, &price, &change_percent);
+                volume = market_stock(idx)->volume;
+            }
+            market_publish(idx, price, change_percent, volume, tick_ns);
+            if (log_ticks) {
+                log_event(LOG_PRICE_UPDATE, idx, 0, 0, price, change_percent);
+            }
             
-            char msg[128];
-            sprintf(msg, "Price update: %s $%.2f (%+.2f%%)", 
-                            s->symbol, s->price, s->change_percent);
-            log_message(msg);
+            if (idx >= marks_capacity) {
+                int capacity = marks_capacity ? marks_capacity : 1024;
+                while (capacity <= idx) capacity *= 2;
+                marks = realloc(marks, sizeof(uint64_t) * capacity);
+                memset(marks + marks_capacity, 0, sizeof(uint64_t) * (capacity - marks_capacity));
+                marks_capacity = capacity;
+            }
+            if (marks[idx] != round) {
+                marks[idx] = round;
+                updated[update_total++] = idx;
+            }
         }
+        published += total;
+        metrics_count(CTR_TICKS, total);
         
-        market_data.update_count++;
-        // Signal all waiting client threads about the update
-        pthread_cond_broadcast(&market_data.data_updated);
+        market_advance(config->shard);
+        if (!replay) sim_refresh(&engine); // Symbols listed by a reload join the stream
         
-        pthread_mutex_unlock(&market_data.mutex);
+        pthread_mutex_unlock(&shard->mutex);
+        
+        // Broadcast stage: each updated symbol once per round, on its latest price
+        for (int i = 0; i < update_total; i++) {
+            broadcast_tick(&batch, updated[i]);
+            holders_mark(updated[i]);
+        }
+        broadcast_commit(&batch);
     }
     
+    for (int r = 0; r < MAX_REACTORS; r++) free(batch.batch[r]);
+    free(updated);
+    free(marks);
+    sim_destroy(&engine);
+    subindex_thread_release();
     log_message("Producer thread exiting");
     return NULL;
 }
 
-// Client handler thread function
-void* client_handler_thread(void* arg) {
-    ClientInfo* client = (ClientInfo*)arg;
-    char buffer[BUFFER_SIZE];
-    int last_update = 0;
+// Grow the session input buffer so at least `more` bytes fit after the buffered data
+static int inbuf_reserve(ClientInfo* client, int more) {
+    if (client->inbuf_len + more <= client->inbuf_capacity) return 0;
+    int capacity = client->inbuf_capacity ? client->inbuf_capacity : BUFFER_SIZE;
+    while (capacity < client->inbuf_len + more) capacity *= 2;
+    char* inbuf = realloc(client->inbuf, capacity);
+    if (!inbuf) return -1;
+    client->inbuf = inbuf;
+    client->inbuf_capacity = capacity;
+    return 0;
+}
+
+// Run one complete text line from data; returns bytes consumed, 0 if the line is incomplete
+static int session_line(ClientInfo* client, char* data, int available) {
+    char* newline = memchr(data, '\n', available);
+    
+    // Rest of a line already rejected as too long: drop it through its newline
+    if (client->discarding) {
+        if (!newline) return available;
+        client->discarding = 0;
+        return newline - data + 1;
+    }
+    if (!newline) return 0;
     
-    char msg[128];
-    sprintf(msg, "Client %s connected on socket %d", client->username, client->socket);
-    log_message(msg);
+    int used = newline - data + 1;
+    int len = newline - data;
+    if (len > 0 && data[len - 1] == '\r') len--;
     
-    const char* welcome = 
-        "\n╔════════════════════════════════════╗\n"
-        "║   STOCK TRADING SYSTEM v3.0       ║\n"
-        "╚════════════════════════════════════╝\n"
-        "💰 Starting balance: $100,000.00\n"
-        "Type HELP for commands\n\n> ";
-    send(client->socket, welcome, strlen(welcome), 0);
+    if (len >= MAX_LINE) {
+        session_reply(client, "ERROR: Command too long.\n");
+        return used;
+    }
     
-    while (server_running && client->active) {
-        fd_set readfds;
-        struct timeval tv = {0, 100000}; // Wait 100ms for command input
-        FD_ZERO(&readfds);
-        FD_SET(client->socket, &readfds);
-        
-        // Check for command input
-        if (select(client->socket + 1, &readfds, NULL, NULL, &tv) > 0) {
-            int bytes = recv(client->socket, buffer, BUFFER_SIZE - 1, 0);
-            if (bytes <= 0) break; // Client disconnected or error
-            
-            buffer[bytes] = '\0';
-            buffer[strcspn(buffer, "\r\n")] = 0; // Remove newline
-            
-            if (strlen(buffer) > 0) {
-                handle_command(client, buffer);
-                if (!client->active) break; // Handle QUIT command
-            }
+    char line[MAX_LINE];
+    memcpy(line, data, len);
+    line[len] = '\0';
+    
+    // Protocol negotiation: everything after the handshake line is framed
+    if (strcasecmp(line, PROTO_HANDSHAKE) == 0) {
+        binary_handshake(client);
+    } else if (len > 0) {
+        int64_t start = metrics_now();
+        handle_command(client, line);
+        metrics_record(HIST_COMMAND, metrics_now() - start);
+        metrics_count(CTR_COMMANDS, 1);
+    }
+    return used;
+}
+
+// Run every complete line or frame in data; returns the bytes consumed
+static int session_parse(ClientInfo* client, char* data, int len) {
+    int offset = 0;
+    while (client->active && offset < len) {
+        int used = client->binary ? binary_frame(client, data + offset, len - offset)
+                                  : session_line(client, data + offset, len - offset);
+        if (used <= 0) break;
+        offset += used;
+    }
+    return offset;
+}
+
+// Parse what is buffered; a partial line or frame stays for the next read
+static void session_parse_buffered(ClientInfo* client) {
+    int offset = session_parse(client, client->inbuf, client->inbuf_len);
+    memmove(client->inbuf, client->inbuf + offset, client->inbuf_len - offset);
+    client->inbuf_len -= offset;
+    
+    // Idle sessions hold no input buffer; the next read allocates one
+    if (client->inbuf_len == 0) {
+        free(client->inbuf);
+        client->inbuf = NULL;
+        client->inbuf_capacity = 0;
+    }
+    
+    // A text line that never ends is dropped rather than buffered forever, along with
+    // whatever of it is still to come
+    if (!client->binary && client->inbuf_len >= MAX_LINE) {
+        session_reply(client, "ERROR: Command too long.\n");
+        client->inbuf_len = 0;
+        client->discarding = 1;
+    }
+}
+
+// Session input: called by the owning reactor when the socket is readable
+void session_readable(ClientInfo* client) {
+    int eof = 0;
+    
+    // Drain the socket so every pipelined request is handled in this wakeup
+    for (;;) {
+        if (inbuf_reserve(client, BUFFER_SIZE) < 0) {
+            client->active = 0;
+            return;
         }
-        
-        // Wait for market update (Producer/Consumer pattern)
-        pthread_mutex_lock(&market_data.mutex);
-        
-        // Use conditional wait with a timeout to prevent infinite blocking on shutdown
-        while (market_data.update_count == last_update && server_running && client->active) {
-            struct timespec timeout;
-            clock_gettime(CLOCK_REALTIME, &timeout);
-            timeout.tv_sec += 1; // Wait up to 1 second
-            
-            if (pthread_cond_timedwait(&market_data.data_updated, &market_data.mutex, &timeout) == ETIMEDOUT) {
-                // Time out occurred, check server_running/client_active flags
-                if (!server_running || !client->active) break;
-            }
+        int space = client->inbuf_capacity - client->inbuf_len;
+        metrics_count(CTR_IO_CALLS, 1);
+        int bytes = recv(client->socket, client->inbuf + client->inbuf_len, space, MSG_DONTWAIT);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) eof = 1;
+            break;
         }
-        
-        // Check alerts if data was actually updated
-        if (market_data.update_count != last_update) {
-            last_update = market_data.update_count;
-            pthread_mutex_unlock(&market_data.mutex);
-            check_alerts(client);
-        } else {
-            pthread_mutex_unlock(&market_data.mutex);
+        if (bytes == 0) {
+            eof = 1; // Client disconnected; still run what it sent before closing
+            break;
         }
+        client->inbuf_len += bytes;
+        if (bytes < space) break;
     }
     
-    // Cleanup on disconnect
+    session_parse_buffered(client);
+    if (eof) client->active = 0; // Replies still get one flush before the reactor drops it
+}
+
+// Bytes the io_uring backend received for this session (len 0 = end of stream). When
+// nothing is buffered they are parsed in place and only a partial tail is copied.
+void session_input(ClientInfo* client, char* data, int len) {
+    if (len == 0) {
+        client->active = 0;
+        return;
+    }
+    if (client->inbuf_len == 0) {
+        int used = session_parse(client, data, len);
+        data += used;
+        len -= used;
+        if (len == 0 || !client->active) return;
+    }
+    if (inbuf_reserve(client, len) < 0) {
+        client->active = 0;
+        return;
+    }
+    memcpy(client->inbuf + client->inbuf_len, data, len);
+    client->inbuf_len += len;
+    session_parse_buffered(client);
+}
+
+// Session teardown: called by the owning reactor once the session is detached
+void session_closed(ClientInfo* client) {
+    char msg[128];
+    
     close(client->socket);
     client->active = 0;
+    outq_clear(&client->outq);
+    
+    // Drop subscriptions from the index so the broadcast stage stops targeting this slot
+    for (int i = 0; i < client->subscription_count; i++) {
+        Subscription* sub = client->subscriptions[i];
+        SymbolSubs* index = subindex_get(sub->stock_id);
+        pthread_mutex_lock(&index->lock);
+        subindex_remove(index, sub);
+        pthread_mutex_unlock(&index->lock);
+        free(sub);
+    }
+    free(client->subscriptions);
+    client->subscriptions = NULL;
+    client->subscription_count = client->subscription_capacity = 0;
+    free(client->streams);
+    client->streams = NULL;
+    client->stream_count = client->stream_capacity = 0;
+    client->stream_all = 0;
+    
+
+    // Resting orders reference this slot; pull them before the account is detached
+    cancel_all_orders(client);
+    free(client->orders);
+    client->orders = NULL;
+    client->order_count = client->order_capacity = 0;
+    account_close(client->account);
+    client->account = NULL;
+    
+    free(client->inbuf);
+    client->inbuf = NULL;
+    client->inbuf_len = client->inbuf_capacity = 0;
     
     sprintf(msg, "Client %s disconnected", client->username);
     log_message(msg);
     
-    return NULL;
+    session_free(client);
 }
 
-// Logger function
-void log_message(const char* message) {
-    pthread_mutex_lock(&log_mutex);
-    
-    time_t now = time(NULL);
-    char timestamp[26];
-    ctime_r(&now, timestamp);
-    timestamp[24] = '\0'; // Remove trailing newline from ctime_r
-    
-    fprintf(log_file, "[%s] %s\n", timestamp, message);
-    fflush(log_file); // Ensure message is written immediately
-    printf("[%s] %s\n", timestamp, message); // Also print to console
+// Greet a new session before handing it to a reactor
+void session_welcome(ClientInfo* client) {
+    char msg[128];
+    sprintf(msg, "Client %s connected on socket %d", client->username, client->socket);
+    log_message(msg);
     
-    pthread_mutex_unlock(&log_mutex);
+    const char* welcome = 
+        "\n╔════════════════════════════════════╗\n"
+        "║   STOCK TRADING SYSTEM v3.0       ║\n"
+        "╚════════════════════════════════════╝\n"
+        "💰 Starting balance: $100,000.00\n"
+        "Type HELP for commands\n\n> ";
+    session_reply(client, welcome); // Flushed by the reactor that adopts the session
 }
 
 // Signal handler for clean shutdown
 void signal_handler(int sig) {
-    log_message("Shutdown signal received");
-    server_running = 0;
+    if (sig == SIGHUP) {
+        reload_symbols = 1; // Picked up by the accept loop
+        return;
+    }
+    server_running = 0; // Logged by main once the accept loop exits
+}
+
+// Sessions are bounded by MAX_SESSIONS, not by the default descriptor limit
+static void raise_fd_limit() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) return;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    char msg[96];
+    sprintf(msg, "File descriptor limit: %llu", (unsigned long long)rl.rlim_cur);
+    log_message(msg);
+}
+
+// Session table footprint and accept-path cost, logged at shutdown
+static void log_session_stats() {
+    SessionStats st;
+    session_stats(&st);
+    char msg[LOG_TEXT_LEN];
+    snprintf(msg, sizeof(msg), "Sessions: peak %d, %d slots of %zu bytes, %" PRIu64 " accepted",
+             st.peak, st.slots, st.slot_bytes, st.accepted);
+    log_message(msg);
+    if (st.accepted) {
+        snprintf(msg, sizeof(msg), "Accept path: %.1f us average, %.1f us max",
+                 st.accept_ns_total / 1e3 / st.accepted, st.accept_ns_max / 1e3);
+        log_message(msg);
+    }
 }
 
 // Clean up resources
 void cleanup_server() {
     log_message("Cleaning up server resources");
     
-    // Signal all waiting clients to wake up and exit
-    pthread_cond_broadcast(&market_data.data_updated);
-
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].active) {
-            clients[i].active = 0;
-            close(clients[i].socket);
-        }
-    }
+    // Reactors close the sessions they own
+    reactor_stop_all();
+    metrics_stop();
+    journal_close(); // No session is left to trade
     
     if (server_socket > 0) close(server_socket);
     
     pthread_mutex_destroy(&market_data.mutex);
-    pthread_cond_destroy(&market_data.data_updated);
-    pthread_mutex_destroy(&clients_mutex);
-    pthread_mutex_destroy(&log_mutex);
+    for (int i = 0; i < MAX_MARKET_SHARDS; i++) pthread_mutex_destroy(&market_shard(i)->mutex);
+    log_session_stats();
+    sessions_destroy_all();
+    subindex_destroy_all();
+    holders_destroy_all();
+    snapshot_cache_clear();
+    orders_destroy_all();
+    accounts_destroy_all();
+    
+    log_message("===== SERVER STOPPED =====");
+    log_shutdown(); // Drains every pending record before closing the file
+}
+
+// List symbols appended to the symbol file since startup (after SIGHUP)
+static void check_reload(const char* symbols_path) {
+    if (!reload_symbols) return;
+    reload_symbols = 0;
+    char msg[128];
+    int added = market_load_file(symbols_path);
+    sprintf(msg, "Symbol reload: %d new symbol(s), %d listed", added, market_symbol_count());
+    log_message(msg);
+}
+
+// Set up a freshly accepted connection and hand it to a reactor
+static void accept_session(int sock, int64_t accepted_ns) {
+    static int next_id = 1;
+    
+    // Claim a session slot (O(1): free list, or a new chunk of slots)
+    ClientInfo* client = session_alloc();
+    if (client) {
+        // Initialize new client structure
+        client->socket = sock;
+        client->active = 1;
+        client->client_id = next_id++;
+        sprintf(client->username, "User%d", client->client_id);
+        
+        init_client_portfolio(client);
+        
+        // Greet, then hand the session to a reactor thread
+        session_welcome(client);
+        reactor_add_session(client);
+        session_accepted(monotonic_ns() - accepted_ns);
+    } else {
+        // Server full
+        const char* msg = "ERROR: Server full. Try again later.\n";
+        send(sock, msg, strlen(msg), MSG_DONTWAIT | MSG_NOSIGNAL);
+        close(sock);
+        log_message("Connection rejected: Server full");
+    }
+}
+
+// Accept loop for the epoll backend: select() with a 1 s timeout, then accept until
+// the backlog is empty
+static void accept_select(const char* symbols_path) {
+    struct sockaddr_in client_addr;
+    socklen_t addr_len;
+    
+    fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL, 0) | O_NONBLOCK);
+    while (server_running) {
+        fd_set readfds;
+        struct timeval tv = {1, 0}; // Wait 1 second
+        FD_ZERO(&readfds);
+        FD_SET(server_socket, &readfds);
+        
+        check_reload(symbols_path);
+        
+        // Wait for activity on the server socket
+        if (select(server_socket + 1, &readfds, NULL, NULL, &tv) <= 0) continue;
+        
+        for (;;) {
+            addr_len = sizeof(client_addr);
+            int sock = accept(server_socket, (struct sockaddr*)&client_addr, &addr_len);
+            if (sock < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && server_running) {
+                    log_message("ERROR: Accept failed");
+                }
+                break;
+            }
+            int64_t accepted_ns = monotonic_ns();
+            // Session writes never block the reactor; backlog waits in the output queue
+            fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+            accept_session(sock, accepted_ns);
+        }
+    }
+}
+
+// Accept loop for the io_uring backend: one multishot accept delivers every new
+// connection, and the wait wakes once a second for reloads and shutdown. Sockets
+// stay blocking; the reactors' rings wait for them instead of failing with EAGAIN.
+static void accept_uring(const char* symbols_path) {
+    static char accept_token;
+    Uring ring;
+    if (uring_init(&ring, 64) < 0) {
+        log_message("WARNING: io_uring acceptor setup failed, using select");
+        accept_select(symbols_path);
+        return;
+    }
     
-    if (log_file) {
-        log_message("===== SERVER STOPPED =====");
-        fclose(log_file);
+    int armed = 0;
+    while (server_running) {
+        check_reload(symbols_path);
+        if (!armed) {
+            struct io_uring_sqe* sqe = uring_sqe(&ring);
+            if (!sqe) break;
+            uring_prep_accept(sqe, server_socket, &accept_token);
+            armed = 1;
+        }
+        if (uring_enter(&ring, 1000) < 0) {
+            log_message("ERROR: io_uring acceptor failed");
+            break;
+        }
+        
+        struct io_uring_cqe* cqe;
+        while ((cqe = uring_peek(&ring))) {
+            int res = cqe->res;
+            if (!(cqe->flags & IORING_CQE_F_MORE)) armed = 0;
+            uring_advance(&ring);
+            if (res >= 0) {
+                accept_session(res, monotonic_ns());
+            } else if (res != -EINTR && res != -EAGAIN && res != -ECANCELED && server_running) {
+                log_message("ERROR: Accept failed");
+            }
+        }
     }
+    uring_destroy(&ring);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-f symbols_file] [-m walk|gbm|jump] [-r ticks_per_sec] [-S seed]\n"
+            "          [-v volatility] [-d drift] [-R tick_file [-x speed]] [-J journal_prefix]\n"
+            "          [-M metrics_port] [-P producers] [-N auto|uring|epoll]\n"
+            "  -x: 1 = original timing (default), N = N times faster, 0 = as fast as possible\n"
+            "  -P: market shards, one producer thread each (default %d; 0 = one per CPU)\n"
+            "  -J: account journal and snapshot path prefix (default " JOURNAL_DEFAULT_PREFIX "; none = off)\n"
+            "  -M: plain-text metrics on 127.0.0.1:PORT (default %d; 0 = off)\n"
+            "  -N: network backend (default " NET_BACKEND "; auto = io_uring when the kernel supports it)\n",
+            prog, PRODUCER_THREADS, METRICS_PORT);
 }
 
-int main() {
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t addr_len = sizeof(client_addr);
-    pthread_t producer_tid;
-    int next_id = 1;
+int main(int argc, char* argv[]) {
+    struct sockaddr_in server_addr;
+    pthread_t producer_tids[MAX_MARKET_SHARDS];
+    const char* symbols_path = SYMBOLS_FILE;
+    SimConfig sim_config = {SIM_WALK, (uint64_t)realtime_ns(), SIM_DEFAULT_RATE, SIM_DEFAULT_SIGMA, 0.0};
+    const char* replay_path = NULL;
+    double replay_speed = 1.0;
+    const char* journal_prefix = JOURNAL_DEFAULT_PREFIX;
+    int metrics_port = METRICS_PORT;
+    Replay replay;
+    ProducerConfig producer_configs[MAX_MARKET_SHARDS];
+    int producers = PRODUCER_THREADS;
+    const char* backend = NET_BACKEND;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "f:m:r:S:v:d:R:x:J:M:P:N:h")) != -1) {
+        switch (opt) {
+        case 'f': symbols_path = optarg; break;
+        case 'r': sim_config.rate = atof(optarg); break;
+        case 'S': sim_config.seed = strtoull(optarg, NULL, 10); break;
+        case 'v': sim_config.sigma = atof(optarg); break;
+        case 'd': sim_config.drift = atof(optarg); break;
+        case 'R': replay_path = optarg; break;
+        case 'x': replay_speed = atof(optarg); break;
+        case 'M': metrics_port = atoi(optarg); break;
+        case 'P': producers = atoi(optarg); break;
+        case 'N': backend = optarg; break;
+        case 'J': journal_prefix = strcmp(optarg, "none") == 0 ? NULL : optarg; break;
+        case 'm':
+            if (sim_parse_model(optarg) < 0) {
+                fprintf(stderr, "Unknown price model: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            sim_config.model = sim_parse_model(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (strcmp(backend, "auto") != 0 && strcmp(backend, "uring") != 0 && strcmp(backend, "epoll") != 0) {
+        fprintf(stderr, "Unknown network backend: %s\n", backend);
+        return EXIT_FAILURE;
+    }
+    if (sim_config.rate < 0.0 || sim_config.sigma < 0.0 || replay_speed < 0.0 || producers < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
     
-    log_file = fopen(LOG_FILE, "a");
-    if (!log_file) {
+    if (log_init(LOG_FILE) < 0) {
         perror("Log file error");
         exit(EXIT_FAILURE);
     }
@@ -570,15 +1423,64 @@ int main() {
     // Set up signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGHUP, signal_handler);     // Reload the symbol file
     signal(SIGPIPE, SIG_IGN); // Ignore broken pipe signal
     
-    srand(time(NULL));
-    init_market_data();
+    init_market_data(symbols_path);
+    accounts_init();
+    
+    // Named accounts as of the last journaled trade
+    if (journal_open(journal_prefix) < 0) {
+        fprintf(stderr, "Cannot recover accounts from %s.*; see %s\n", journal_prefix, LOG_FILE);
+        log_shutdown();
+        exit(EXIT_FAILURE);
+    }
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        clients[i].active = 0;
+    // A tick file is one ordered stream, so replay keeps a single producer
+    if (producers == 0) producers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (replay_path) producers = 1;
+    market_set_shards(producers);
+    producers = market_shard_count();
+    
+    Replay* producer_replay = NULL;
+    if (replay_path) {
+        if (replay_open(&replay, replay_path, replay_speed) < 0) {
+            log_shutdown();
+            exit(EXIT_FAILURE);
+        }
+        producer_replay = &replay;
+    } else {
+        char engine_msg[160];
+        sprintf(engine_msg, "Tick engine: %s model, %.2f ticks/s, seed %" PRIu64 ", %d shard(s)",
+                sim_model_name(sim_config.model), sim_config.rate, sim_config.seed, producers);
+        log_message(engine_msg);
+    }
+    for (int i = 0; i < producers; i++) {
+        producer_configs[i].sim = sim_config;
+        producer_configs[i].replay = producer_replay;
+        producer_configs[i].shard = i;
     }
     
+    char scan_msg[64];
+    sprintf(scan_msg, "Alert scan kernel: %s", alert_scan_kernel());
+    log_message(scan_msg);
+    
+    raise_fd_limit();
+    
+    // io_uring when asked for (or on auto) and the kernel has what it needs
+    int use_uring = strcmp(backend, "epoll") != 0 && uring_supported();
+    if (strcmp(backend, "uring") == 0 && !use_uring) {
+        log_message("WARNING: io_uring unavailable, using epoll");
+    }
+    char backend_msg[128];
+    if (use_uring) {
+        sprintf(backend_msg, "Network backend: io_uring (multishot accept/recv, %d x %d B receive buffers per reactor)",
+                URING_BUF_COUNT, URING_BUF_SIZE);
+    } else {
+        sprintf(backend_msg, "Network backend: epoll");
+    }
+    log_message(backend_msg);
+    
     // 1. Create socket
     server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket < 0) {
@@ -588,8 +1490,8 @@ int main() {
     }
     
     // Allow reuse of address
-    int opt = 1;
-    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    int reuse = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
     
     // Configure server address
     server_addr.sin_family = AF_INET;
@@ -604,7 +1506,7 @@ int main() {
     }
     
     // 3. Listen for connections
-    if (listen(server_socket, MAX_CLIENTS) < 0) {
+    if (listen(server_socket, SOMAXCONN) < 0) {
         log_message("ERROR: Listen failed");
         cleanup_server();
         exit(EXIT_FAILURE);
@@ -612,63 +1514,33 @@ int main() {
     
     log_message("Server listening on port 8888");
     
-    // Start producer (market simulation) thread
-    pthread_create(&producer_tid, NULL, producer_thread, NULL);
+    // Start event loop threads that own all client sessions
+    if (reactor_start_all(REACTOR_THREADS, use_uring) < 0) {
+        cleanup_server();
+        exit(EXIT_FAILURE);
+    }
+    
+    // A busy metrics port is reported but does not stop trading
+    metrics_start(metrics_port);
+    
+    // Start producer (market simulation) threads, one per market shard
+    for (int i = 0; i < producers; i++) {
+        pthread_create(&producer_tids[i], NULL, producer_thread, &producer_configs[i]);
+    }
     
     // Main server loop (Accepting connections)
-    while (server_running) {
-        fd_set readfds;
-        struct timeval tv = {1, 0}; // Wait 1 second
-        FD_ZERO(&readfds);
-        FD_SET(server_socket, &readfds);
-        
-        // Wait for activity on the server socket
-        if (select(server_socket + 1, &readfds, NULL, NULL, &tv) <= 0) continue;
-        
-        // 4. Accept connection
-        int sock = accept(server_socket, (struct sockaddr*)&client_addr, &addr_len);
-        if (sock < 0) {
-            if (server_running) {
-                log_message("ERROR: Accept failed");
-            }
-            continue;
-        }
-        
-        // Find an empty slot for the new client
-        pthread_mutex_lock(&clients_mutex);
-        int slot = -1;
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (!clients[i].active) {
-                slot = i;
-                break;
-            }
-        }
-        
-        if (slot >= 0) {
-            // Initialize new client structure
-            clients[slot].socket = sock;
-            clients[slot].active = 1;
-            clients[slot].client_id = next_id++;
-            sprintf(clients[slot].username, "User%d", clients[slot].client_id);
-            
-            init_client_portfolio(&clients[slot]);
-            
-            // Start client handler thread
-            pthread_create(&clients[slot].thread, NULL, client_handler_thread, &clients[slot]);
-            pthread_detach(clients[slot].thread); // Detach thread to clean resources automatically
-        } else {
-            // Server full
-            const char* msg = "ERROR: Server full. Try again later.\n";
-            send(sock, msg, strlen(msg), 0);
-            close(sock);
-            log_message("Connection rejected: Server full");
-        }
-        pthread_mutex_unlock(&clients_mutex);
+    if (use_uring) {
+        accept_uring(symbols_path);
+    } else {
+        accept_select(symbols_path);
     }
     
+    log_message("Shutdown signal received");
+    
     // Wait for the producer thread to finish its loop
-    pthread_join(producer_tid, NULL);
+    for (int i = 0; i < producers; i++) pthread_join(producer_tids[i], NULL);
+    if (producer_replay) replay_close(producer_replay);
     cleanup_server();
     
     return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
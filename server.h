@@ -5,63 +5,150 @@
 #include <time.h>
 #include <signal.h>
 #include <sys/time.h>
+#include "log.h"
+#include "market.h"
+#include "broadcast.h"
+#include "subindex.h"
+#include "holders.h"
+#include "protocol.h"
+#include "sim.h"
+#include "replay.h"
+#include "orders.h"
+#include "accounts.h"
+#include "journal.h"
+#include "sessions.h"
+#include "metrics.h"
 
 // Constants
 #define PORT 8888
-#define MAX_CLIENTS 10
-#define MAX_STOCKS 10
+#define REACTOR_THREADS 0      // Event loop threads (0 = one per online CPU)
+#define PRODUCER_THREADS 1          // Market shards, one producer each (-P; 0 = one per online CPU)
+#define NET_BACKEND "auto"          // Session I/O: auto, uring or epoll (-N)
 #define BUFFER_SIZE 1024
+#define MAX_LINE 1024               // Longest accepted text command (BATCH lines run long)
 #define INITIAL_BALANCE 100000.00
 #define LOG_FILE "server.log"
+#define WATCH_DEFAULT_MS 1000      // PORTFOLIO WATCH update interval
+#define WATCH_MIN_MS 100           // Fastest allowed (also the reactors' polling period)
+#define WATCH_UNSENT UINT64_MAX
+#define STREAM_DEFAULT_MS 250      // STREAM update interval
+#define STREAM_MIN_MS 10           // Fastest allowed
+#define STREAM_ALL -2              // STREAM ALL (find_stock returns -1 for unknown symbols)
 
 // Structures
-typedef struct {
-    char symbol[6];
-    double price;
-    double base_price;
-    double change_percent;
-    int volume;
-} Stock;
-
-typedef struct {
-    pthread_mutex_t mutex;
-    pthread_cond_t data_updated;
-    Stock stocks[MAX_STOCKS];
-    int stock_count;
-    int update_count;
-} MarketData;
-
-typedef struct {
-    char symbol[6];
-    int quantity;
-    double avg_buy_price;
-} Holding;
-
-typedef struct {
-    double wallet_balance;
-    double total_invested;
-    int holding_count;
-    Holding holdings[MAX_STOCKS];
-} Portfolio;
-
-typedef struct {
+typedef struct Subscription {
+    int stock_id;
     int active;
     double threshold; // Percentage change threshold for alert
-    int buy_alert_sent;
-    int sell_alert_sent;
+    struct ClientInfo* client;  // Owner, used by the broadcast stage
+    int index_pos;              // Column slot in the symbol's alert index (-1 = not indexed)
 } Subscription;
 
+// Streamed symbol and the price its client last saw (NAN = none yet)
 typedef struct {
+    int stock_id;
+    double price;
+    int muted;                  // UNSTREAMed while stream_all (the entry keeps its ID's slot)
+} QuoteStream;
+
+typedef struct ClientInfo {
     int client_id;
     int socket;
     char username[32];
     int active;
-    pthread_t thread;
-    Portfolio portfolio;
-    Subscription subscriptions[MAX_STOCKS];
+    int in_use;                 // Slot owned by a reactor until session_closed()
+    uint32_t slot;              // Index in the session table (fixed)
+    uint32_t generation;        // Bumped each time the slot is freed (see SessionHandle)
+    struct Reactor* reactor;    // Reactor thread that owns this session
+    struct ClientInfo* next;    // Reactor session list links (free list while unused)
+    struct ClientInfo* prev;
+    OutQueue outq;              // Shared broadcast messages awaiting the socket
+    int touched;                // Reactor scratch flag while draining deliveries
+    int want_write;             // EPOLLOUT armed while outq holds a backlog
+    uint64_t hold_seq;          // Output waits until the journal has this record on disk
+    int held;                   // Counted in the reactor's held sessions
+    int binary;                 // Negotiated binary framing (see protocol.h)
+    char* inbuf;                // Received bytes not yet parsed into lines or frames
+    int inbuf_len;
+    int inbuf_capacity;
+    int discarding;             // Dropping input through the next newline (rest of an over-long line)
+    Account* account;           // Trading state; shared by every session logged in to it
+    uint64_t* orders;           // Resting order IDs, oldest first (guarded by the account lock)
+    int order_count;
+    int order_capacity;
+    Subscription** subscriptions; // Heap-allocated: the symbol index points at them
+    int subscription_count;
+    int subscription_capacity;
+    int64_t watch_interval_ns;  // PORTFOLIO WATCH: least time between updates (0 = off)
+    int64_t watch_due_ns;       // Earliest time of the next update
+    uint64_t watch_seq;         // Account mark_seq last reported (WATCH_UNSENT = none yet)
+    double watch_value;         // Market value last reported
+    QuoteStream* streams;       // STREAM: symbols pushed as quote updates (indexed by ID while stream_all)
+    int stream_count;
+    int stream_capacity;
+    int stream_all;             // Every symbol, including ones listed later
+    int64_t stream_interval_ns; // Least time between polls of the streams (0 = off)
+    int64_t stream_due_ns;      // Next poll
+    double stream_min_change;   // Percent move since the price last sent that warrants an update
+    unsigned long stream_version; // Market version at the last poll (0 = poll regardless)
 } ClientInfo;
 
+// Outcome of a BUY/SELL, rendered as text or as a FILL/ORDER_ACK/ERROR frame
+typedef struct {
+    int error;                  // ERR_* from protocol.h
+    int stock_id;
+    int side;                   // SIDE_BUY / SIDE_SELL
+    int quantity;
+    int held;                   // Shares available to sell (ERR_INSUFFICIENT_SHARES)
+    int filled;                 // Limit orders: executed on arrival
+    int resting;                // Limit orders: left in the book under order_id
+    uint64_t order_id;
+    double limit;               // Limit orders: price rounded to the cent
+    double price;               // Average fill price
+    double amount;              // Cost of a buy, proceeds of a sell
+    double realized_pl;
+    double cost_basis;          // Cost basis of the shares sold
+    double balance;
+} TradeResult;
+
+// One order of a BATCH
+typedef struct {
+    int stock_id;
+    int side;                   // SIDE_BUY / SIDE_SELL
+    int quantity;
+} BatchOrder;
+
+// What a producer thread publishes: its shard of the tick engine, or a recorded tick
+// file (replay always runs as the only shard)
+typedef struct {
+    SimConfig sim;
+    Replay* replay;             // NULL = simulate
+    int shard;
+} ProducerConfig;
+
 // Function prototypes
-void log_message(const char* message);
+void session_reply(ClientInfo* client, const char* text);
+void session_queue(ClientInfo* client, Message* msg);
+int execute_buy(ClientInfo* client, int stock_idx, int qty, TradeResult* result);
+int execute_sell(ClientInfo* client, int stock_idx, int qty, TradeResult* result);
+int execute_limit(ClientInfo* client, int stock_idx, int side, int qty, double limit, TradeResult* result);
+int execute_batch(ClientInfo* client, const BatchOrder* orders, int count, int atomic, TradeResult* results);
+int execute_cancel(ClientInfo* client, uint64_t order_id, int* remaining);
+int list_orders(ClientInfo* client, OrderEntry** entries);
+void cancel_all_orders(ClientInfo* client);
+int execute_login(ClientInfo* client, const char* name);
+int execute_subscribe(ClientInfo* client, int stock_idx, double threshold, Message** alert);
+int execute_watch(ClientInfo* client, int interval_ms);
+Message* portfolio_update(ClientInfo* client);
+int execute_stream(ClientInfo* client, int stock_idx, int interval_ms, double min_change);
+int execute_unstream(ClientInfo* client, int stock_idx);
+void stream_seen(ClientInfo* client, const QuoteEntry* quotes, int count);
+int stream_updates(ClientInfo* client);
+void handle_frame(ClientInfo* client, const char* frame, int len);
+void binary_handshake(ClientInfo* client);
+int binary_frame(ClientInfo* client, const char* data, int available);
+void session_readable(ClientInfo* client);
+void session_input(ClientInfo* client, char* data, int len);
+void session_closed(ClientInfo* client);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "sessions.h"
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Session table: ClientInfo slots in fixed chunks, so a session's address is stable
+// for the life of the server, with an intrusive LIFO free list for O(1) accept and
+// close. Chunks are added only when the free list runs dry.
+
+static ClientInfo* chunks[MAX_SESSION_CHUNKS];
+static int chunk_count = 0;
+static ClientInfo* free_list = NULL;    // Linked through ClientInfo.next
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SessionStats stats;
+
+// Add a chunk of free slots; caller holds table_mutex
+static int table_grow() {
+    if (chunk_count == MAX_SESSION_CHUNKS) return -1;
+    ClientInfo* chunk = calloc(SESSION_CHUNK_SIZE, sizeof(ClientInfo));
+    if (!chunk) return -1;
+
+    // Pushed in reverse so the lowest slot is handed out first
+    for (int i = SESSION_CHUNK_SIZE - 1; i >= 0; i--) {
+        chunk[i].slot = (uint32_t)(chunk_count * SESSION_CHUNK_SIZE + i);
+        chunk[i].generation = 1;
+        chunk[i].next = free_list;
+        free_list = &chunk[i];
+    }
+    __atomic_store_n(&chunks[chunk_count++], chunk, __ATOMIC_RELEASE);
+    stats.slots += SESSION_CHUNK_SIZE;
+    return 0;
+}
+
+// Claim a free slot for a new connection; NULL when the table is full
+ClientInfo* session_alloc() {
+    pthread_mutex_lock(&table_mutex);
+    if (!free_list && table_grow() < 0) {
+        pthread_mutex_unlock(&table_mutex);
+        return NULL;
+    }
+    ClientInfo* client = free_list;
+    free_list = client->next;
+    client->next = NULL;
+    client->in_use = 1;
+    if (++stats.open > stats.peak) stats.peak = stats.open;
+    pthread_mutex_unlock(&table_mutex);
+    return client;
+}
+
+// Return a closed session's slot; handles to it stop resolving
+void session_free(ClientInfo* client) {
+    pthread_mutex_lock(&table_mutex);
+    __atomic_store_n(&client->generation, client->generation + 1, __ATOMIC_RELEASE);
+    client->in_use = 0;
+    client->next = free_list;
+    free_list = client;
+    stats.open--;
+    pthread_mutex_unlock(&table_mutex);
+}
+
+SessionHandle session_handle(const ClientInfo* client) {
+    return ((uint64_t)client->generation << 32) | client->slot;
+}
+
+// Session a handle was taken from, or NULL if that session has closed since
+ClientInfo* session_resolve(SessionHandle handle) {
+    uint32_t slot = (uint32_t)handle;
+    int c = slot >> SESSION_CHUNK_SHIFT;
+    if (c >= MAX_SESSION_CHUNKS) return NULL;
+    ClientInfo* chunk = __atomic_load_n(&chunks[c], __ATOMIC_ACQUIRE);
+    if (!chunk) return NULL;
+
+    ClientInfo* client = &chunk[slot & (SESSION_CHUNK_SIZE - 1)];
+    if (__atomic_load_n(&client->generation, __ATOMIC_ACQUIRE) != (uint32_t)(handle >> 32)) return NULL;
+    return client;
+}
+
+// Account one accept (acceptor thread only)
+void session_accepted(int64_t elapsed_ns) {
+    pthread_mutex_lock(&table_mutex);
+    stats.accepted++;
+    stats.accept_ns_total += elapsed_ns;
+    if (elapsed_ns > stats.accept_ns_max) stats.accept_ns_max = elapsed_ns;
+    pthread_mutex_unlock(&table_mutex);
+}
+
+void session_stats(SessionStats* out) {
+    pthread_mutex_lock(&table_mutex);
+    *out = stats;
+    out->slot_bytes = sizeof(ClientInfo);
+    pthread_mutex_unlock(&table_mutex);
+}
+
+// Free the table once every reactor has closed its sessions
+void sessions_destroy_all() {
+    for (int c = 0; c < chunk_count; c++) {
+        free(chunks[c]);
+        chunks[c] = NULL;
+    }
+    chunk_count = 0;
+    free_list = NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef SESSIONS_H
+#define SESSIONS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Constants
+#define SESSION_CHUNK_SHIFT 10          // Slots are allocated 1024 at a time and never move
+#define SESSION_CHUNK_SIZE (1 << SESSION_CHUNK_SHIFT)
+#define MAX_SESSION_CHUNKS 256
+#define MAX_SESSIONS (SESSION_CHUNK_SIZE * MAX_SESSION_CHUNKS)
+
+struct ClientInfo;
+
+// Slot index in the low 32 bits, the slot's generation above. A handle outlives its
+// session safely: once the slot is freed its generation moves on and the handle no
+// longer resolves. 0 is never a valid handle.
+typedef uint64_t SessionHandle;
+
+// Structures
+typedef struct {
+    int open;                   // Sessions in use
+    int peak;
+    int slots;                  // Slots allocated (in use or on the free list)
+    size_t slot_bytes;          // sizeof(ClientInfo)
+    uint64_t accepted;
+    int64_t accept_ns_total;    // accept() to reactor handoff, summed
+    int64_t accept_ns_max;
+} SessionStats;
+
+// Function prototypes
+struct ClientInfo* session_alloc();
+void session_free(struct ClientInfo* client);
+SessionHandle session_handle(const struct ClientInfo* client);
+struct ClientInfo* session_resolve(SessionHandle handle);
+void session_accepted(int64_t elapsed_ns);
+void session_stats(SessionStats* out);
+void sessions_destroy_all();
+
+#endif
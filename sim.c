@@ -0,0 +1,173 @@
+#include "sim.h"
+#include "market.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+static const char* model_names[] = {"walk", "gbm", "jump"};
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Seed one generator; distinct streams of the same seed are independent
+void sim_rng_seed(SimRng* rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03ULL);
+    for (int i = 0; i < 4; i++) rng->s[i] = splitmix64(&x);
+    rng->has_spare = 0;
+}
+
+uint64_t sim_rng_next(SimRng* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// Uniform in [0, 1)
+double sim_rng_uniform(SimRng* rng) {
+    return (sim_rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+// Standard normal (Box-Muller, pairs cached so the draw count stays deterministic)
+double sim_rng_normal(SimRng* rng) {
+    if (rng->has_spare) {
+        rng->has_spare = 0;
+        return rng->spare;
+    }
+    double u1 = 1.0 - sim_rng_uniform(rng); // (0, 1]: log() stays finite
+    double u2 = sim_rng_uniform(rng);
+    double r = sqrt(-2.0 * log(u1));
+    rng->spare = r * sin(2.0 * M_PI * u2);
+    rng->has_spare = 1;
+    return r * cos(2.0 * M_PI * u2);
+}
+
+int sim_parse_model(const char* name) {
+    for (int i = 0; i < (int)(sizeof(model_names) / sizeof(model_names[0])); i++) {
+        if (strcasecmp(name, model_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char* sim_model_name(SimModel model) {
+    return model_names[model];
+}
+
+// Engine for one market shard; each shard draws from its own generator stream, so a
+// single shard reproduces the unsharded stream exactly
+void sim_init(SimEngine* engine, const SimConfig* config, int shard, int shard_count) {
+    memset(engine, 0, sizeof(*engine));
+    engine->config = *config;
+    engine->shard = shard;
+    engine->shard_count = shard_count;
+    sim_rng_seed(&engine->rng, config->seed, shard);
+    sim_refresh(engine);
+}
+
+// Rebuild the symbol selection tables when the universe has grown
+void sim_refresh(SimEngine* engine) {
+    int count = market_symbol_count();
+    if (count == engine->symbol_count) return;
+
+    engine->fixed_cumulative = realloc(engine->fixed_cumulative, sizeof(double) * count);
+    engine->fixed_ids = realloc(engine->fixed_ids, sizeof(int) * count);
+    engine->shared_ids = realloc(engine->shared_ids, sizeof(int) * count);
+    engine->fixed_count = engine->shared_count = 0;
+    engine->fixed_total = 0.0;
+
+    // The shared rate is split evenly over every such symbol, whichever shard has it
+    int shared_total = 0;
+    for (int i = 0; i < count; i++) {
+        double rate = market_stock(i)->tick_rate;
+        if (rate <= 0.0) shared_total++;
+        if (i % engine->shard_count != engine->shard) continue;
+        if (rate > 0.0) {
+            engine->fixed_total += rate;
+            engine->fixed_cumulative[engine->fixed_count] = engine->fixed_total;
+            engine->fixed_ids[engine->fixed_count++] = i;
+        } else {
+            engine->shared_ids[engine->shared_count++] = i;
+        }
+    }
+    if (engine->shared_count == shared_total) {
+        engine->shared_rate = shared_total ? engine->config.rate : 0.0;
+    } else {
+        engine->shared_rate = engine->config.rate * engine->shared_count / shared_total;
+    }
+    engine->total_rate = engine->fixed_total + engine->shared_rate;
+    engine->symbol_count = count;
+}
+
+void sim_destroy(SimEngine* engine) {
+    free(engine->fixed_cumulative);
+    free(engine->fixed_ids);
+    free(engine->shared_ids);
+    memset(engine, 0, sizeof(*engine));
+}
+
+// Pick the next symbol in proportion to its tick rate; *dt gets its mean tick interval
+static int pick_symbol(SimEngine* engine, double* dt) {
+    double u = sim_rng_uniform(&engine->rng) * engine->total_rate;
+
+    if (u < engine->fixed_total) {
+        int lo = 0, hi = engine->fixed_count - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (engine->fixed_cumulative[mid] > u) hi = mid;
+            else lo = mid + 1;
+        }
+        *dt = 1.0 / market_stock(engine->fixed_ids[lo])->tick_rate;
+        return engine->fixed_ids[lo];
+    }
+
+    int k = (int)((u - engine->fixed_total) / engine->shared_rate * engine->shared_count);
+    if (k >= engine->shared_count) k = engine->shared_count - 1;
+    *dt = engine->shared_count / engine->shared_rate;
+    return engine->shared_ids[k];
+}
+
+// Draw the next tick: returns the symbol ID and its new price and change from base.
+// Caller is the only publisher of this stream (it holds its shard's mutex).
+int sim_next(SimEngine* engine, double* price, double* change_percent) {
+    double dt;
+    int idx = pick_symbol(engine, &dt);
+    Stock* s = market_stock(idx);
+    const SimConfig* c = &engine->config;
+    double next;
+
+    if (c->model == SIM_WALK) {
+        double change = (sim_rng_uniform(&engine->rng) * 2.0 - 1.0) * SIM_WALK_STEP;
+        next = s->price * (1 + change);
+    } else {
+        double z = sim_rng_normal(&engine->rng);
+        double log_move = (c->drift - 0.5 * c->sigma * c->sigma) * dt + c->sigma * sqrt(dt) * z;
+        if (c->model == SIM_JUMP && sim_rng_uniform(&engine->rng) < SIM_JUMP_PROB) {
+            log_move += SIM_JUMP_SIGMA * sim_rng_normal(&engine->rng);
+        }
+        next = s->price * exp(log_move);
+    }
+
+    // Ensure price stays positive and isn't ridiculously high
+    if (next < 0.01) next = s->base_price * 0.9;
+    if (next > s->base_price * 5) next = s->base_price * 2;
+
+    *price = next;
+    *change_percent = ((next - s->base_price) / s->base_price) * 100;
+    engine->ticks++;
+    return idx;
+}
@@ -0,0 +1,71 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+// Constants
+#define SIM_DEFAULT_RATE 0.5            // Ticks per second shared by symbols without a RATE
+#define SIM_DEFAULT_SIGMA 0.01          // Volatility per sqrt(second) (GBM / jump)
+#define SIM_WALK_STEP 0.03              // Random walk: uniform move of up to +/-3% per tick
+#define SIM_JUMP_PROB 0.01              // Jump model: chance of a jump on any tick
+#define SIM_JUMP_SIGMA 0.05             // Jump model: log-size standard deviation of a jump
+#define SIM_MAX_BATCH 65536             // Ticks published per round when catching up
+#define SIM_LOG_MAX_RATE 10.0           // Above this, price updates are summarized once a second
+
+// Price models
+typedef enum {
+    SIM_WALK,                   // Bounded multiplicative random walk (the original simulator)
+    SIM_GBM,                    // Geometric Brownian motion
+    SIM_JUMP                    // GBM plus occasional log-normal jumps
+} SimModel;
+
+// Structures
+
+// xoshiro256** state; one per producer thread, never shared
+typedef struct {
+    uint64_t s[4];
+    double spare;               // Second Box-Muller normal
+    int has_spare;
+} SimRng;
+
+typedef struct {
+    SimModel model;
+    uint64_t seed;
+    double rate;                // Ticks per second across symbols without their own rate
+    double sigma;
+    double drift;               // Per second (GBM / jump)
+} SimConfig;
+
+// Deterministic tick stream: the sequence of (symbol, price) depends only on the
+// seed, the config, the shard and the symbol universe, never on timing
+typedef struct {
+    SimConfig config;
+    SimRng rng;
+    int shard;                  // Draws only symbols with ID % shard_count == shard
+    int shard_count;
+    int symbol_count;           // Universe size the selection tables were built for
+    double fixed_total;         // Sum of per-symbol rates
+    double* fixed_cumulative;   // Running sum of per-symbol rates
+    int* fixed_ids;
+    int fixed_count;
+    int* shared_ids;            // Symbols that split config.rate evenly
+    int shared_count;
+    double shared_rate;         // This shard's part of config.rate
+    double total_rate;          // Ticks per second of the whole stream
+    uint64_t ticks;
+} SimEngine;
+
+// Function prototypes
+void sim_rng_seed(SimRng* rng, uint64_t seed, uint64_t stream);
+uint64_t sim_rng_next(SimRng* rng);
+double sim_rng_uniform(SimRng* rng);
+double sim_rng_normal(SimRng* rng);
+
+int sim_parse_model(const char* name);
+const char* sim_model_name(SimModel model);
+void sim_init(SimEngine* engine, const SimConfig* config, int shard, int shard_count);
+void sim_refresh(SimEngine* engine);
+void sim_destroy(SimEngine* engine);
+int sim_next(SimEngine* engine, double* price, double* change_percent);
+
+#endif
@@ -0,0 +1,154 @@
+#include "subindex.h"
+#include "server.h"
+#include "alertscan.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-symbol indexes, chunked like the market so they grow with the universe
+static SymbolSubs* index_chunks[MAX_SYMBOL_CHUNKS];
+
+// Scan output, reused by each producer thread across ticks
+static __thread uint64_t* scan_masks;
+static __thread int scan_words;
+
+static double* column_alloc(int capacity) {
+    return aligned_alloc(ALERT_SCAN_ALIGN, sizeof(double) * capacity);
+}
+
+// Mark slot i unarmed on both sides
+static void slot_clear(SymbolSubs* index, int i) {
+    index->buy_limit[i] = -INFINITY;
+    index->sell_limit[i] = INFINITY;
+    index->subs[i] = NULL;
+}
+
+// Give sub a column slot (both sides disarmed) if it has none
+static void index_insert(SymbolSubs* index, Subscription* sub) {
+    if (sub->index_pos >= 0) return;
+    if (index->count == index->capacity) {
+        int capacity = index->capacity ? index->capacity * 2 : SUBINDEX_INITIAL_CAPACITY;
+        double* buy = column_alloc(capacity);
+        double* sell = column_alloc(capacity);
+        if (index->count) {
+            memcpy(buy, index->buy_limit, sizeof(double) * index->count);
+            memcpy(sell, index->sell_limit, sizeof(double) * index->count);
+        }
+        free(index->buy_limit);
+        free(index->sell_limit);
+        index->buy_limit = buy;
+        index->sell_limit = sell;
+        index->subs = realloc(index->subs, sizeof(Subscription*) * capacity);
+        index->capacity = capacity;
+        for (int i = index->count; i < capacity; i++) slot_clear(index, i);
+    }
+    sub->index_pos = index->count;
+    index->subs[index->count++] = sub;
+}
+
+// Index of one listed symbol; its chunk is created on first use
+SymbolSubs* subindex_get(int stock_id) {
+    int c = stock_id >> SYMBOL_CHUNK_SHIFT;
+    SymbolSubs* chunk = __atomic_load_n(&index_chunks[c], __ATOMIC_ACQUIRE);
+
+    if (!chunk) {
+        SymbolSubs* fresh = calloc(SYMBOL_CHUNK_SIZE, sizeof(SymbolSubs));
+        for (int i = 0; i < SYMBOL_CHUNK_SIZE; i++) {
+            pthread_mutex_init(&fresh[i].lock, NULL);
+            fresh[i].buy_bound = -INFINITY;
+            fresh[i].sell_bound = INFINITY;
+        }
+        if (__atomic_compare_exchange_n(&index_chunks[c], &chunk, fresh, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            chunk = fresh;
+        } else {
+            free(fresh); // Another thread won the race; chunk now holds its copy
+        }
+    }
+    return &chunk[stock_id & (SYMBOL_CHUNK_SIZE - 1)];
+}
+
+void subindex_destroy_all() {
+    for (int c = 0; c < MAX_SYMBOL_CHUNKS; c++) {
+        if (!index_chunks[c]) continue;
+        for (int i = 0; i < SYMBOL_CHUNK_SIZE; i++) {
+            free(index_chunks[c][i].buy_limit);
+            free(index_chunks[c][i].sell_limit);
+            free(index_chunks[c][i].subs);
+            pthread_mutex_destroy(&index_chunks[c][i].lock);
+        }
+        free(index_chunks[c]);
+        index_chunks[c] = NULL;
+    }
+}
+
+// Arm sub on the requested sides; caller holds index->lock
+void subindex_arm(SymbolSubs* index, Subscription* sub, int buy, int sell) {
+    index_insert(index, sub);
+    int i = sub->index_pos;
+    if (buy) {
+        index->buy_limit[i] = -sub->threshold;
+        if (index->buy_limit[i] > index->buy_bound) index->buy_bound = index->buy_limit[i];
+    }
+    if (sell) {
+        index->sell_limit[i] = sub->threshold;
+        if (index->sell_limit[i] < index->sell_bound) index->sell_bound = index->sell_limit[i];
+    }
+}
+
+// Take sub out of both sides; caller holds index->lock. The bounds are left as they
+// are: a stale bound only costs one extra scan, which then tightens it.
+void subindex_remove(SymbolSubs* index, Subscription* sub) {
+    int i = sub->index_pos;
+    if (i < 0) return;
+    sub->index_pos = -1;
+
+    int last = --index->count;
+    if (i != last) {
+        index->buy_limit[i] = index->buy_limit[last];
+        index->sell_limit[i] = index->sell_limit[last];
+        index->subs[i] = index->subs[last];
+        index->subs[i]->index_pos = i;
+    }
+    slot_clear(index, last);
+}
+
+// Check one move against every armed limit; caller holds index->lock. Fired sides
+// are disarmed, and *buy / *sell receive one bit per slot (valid until this thread's
+// next scan). Returns the number of mask words, 0 when nothing fired.
+int subindex_scan(SymbolSubs* index, double change_percent, const uint64_t** buy, const uint64_t** sell) {
+    if (change_percent > index->buy_bound && change_percent < index->sell_bound) return 0;
+
+    int padded = (index->count + ALERT_SCAN_LANES - 1) & ~(ALERT_SCAN_LANES - 1);
+    int words = (padded + 63) / 64;
+    if (words > scan_words) {
+        free(scan_masks);
+        scan_masks = malloc(sizeof(uint64_t) * 2 * words);
+        scan_words = words;
+    }
+    uint64_t* buy_mask = scan_masks;
+    uint64_t* sell_mask = scan_masks + scan_words;
+
+    if (!alert_scan(index->buy_limit, index->sell_limit, padded, change_percent,
+                    buy_mask, sell_mask, &index->buy_bound, &index->sell_bound)) {
+        return 0;
+    }
+    for (int w = 0; w < words; w++) {
+        for (uint64_t m = buy_mask[w]; m; m &= m - 1) {
+            index->buy_limit[w * 64 + __builtin_ctzll(m)] = -INFINITY;
+        }
+        for (uint64_t m = sell_mask[w]; m; m &= m - 1) {
+            index->sell_limit[w * 64 + __builtin_ctzll(m)] = INFINITY;
+        }
+    }
+    *buy = buy_mask;
+    *sell = sell_mask;
+    return words;
+}
+
+// Free this thread's scan masks (producer exit)
+void subindex_thread_release() {
+    free(scan_masks);
+    scan_masks = NULL;
+    scan_words = 0;
+}
@@ -0,0 +1,37 @@
+#ifndef SUBINDEX_H
+#define SUBINDEX_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "market.h"
+
+// Constants
+#define SUBINDEX_INITIAL_CAPACITY 8     // Slots; always a multiple of ALERT_SCAN_LANES
+
+struct Subscription;
+
+// Structures
+
+// Inverted index for one symbol, stored as columns so one tick is checked against
+// every subscriber in a single vector pass (see alertscan.c). Slot i of each column
+// belongs to subs[i]; disarmed sides and spare slots hold +/-INFINITY.
+typedef struct {
+    pthread_mutex_t lock;
+    double* buy_limit;          // -threshold while the buy (drop) alert is armed
+    double* sell_limit;         // +threshold while the sell (rise) alert is armed
+    struct Subscription** subs;
+    int count;
+    int capacity;
+    double buy_bound;           // No buy alert can fire for a change above this
+    double sell_bound;          // No sell alert can fire for a change below this
+} SymbolSubs;
+
+// Function prototypes
+SymbolSubs* subindex_get(int stock_id);
+void subindex_destroy_all();
+void subindex_arm(SymbolSubs* index, struct Subscription* sub, int buy, int sell);
+void subindex_remove(SymbolSubs* index, struct Subscription* sub);
+int subindex_scan(SymbolSubs* index, double change_percent, const uint64_t** buy, const uint64_t** sell);
+void subindex_thread_release();
+
+#endif
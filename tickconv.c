@@ -0,0 +1,213 @@
+#include "tickfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+// Converts CSV ticks ("timestamp,symbol,price[,volume]") into the binary tick file
+// the server replays with -R. Timestamps may be epoch seconds with an optional
+// fraction, "YYYY-MM-DD HH:MM:SS[.frac]" (UTC) or a bare time of day "HH:MM:SS[.frac]".
+
+#define MAX_LINE 512
+#define DEFAULT_TICK_VOLUME 0
+#define MAX_SYMBOL_CHARS 11             // Longest symbol the server lists (SYMBOL_LEN - 1)
+
+typedef struct {
+    TickRecord tick;
+    uint64_t line;              // Input order, keeps the sort stable for equal timestamps
+} InputTick;
+
+static TickSymbol* symbols = NULL;
+static int symbol_count = 0;
+static int symbol_capacity = 0;
+
+// Digits after a decimal point as nanoseconds; *end moves past them
+static int64_t parse_fraction(const char* p, const char** end) {
+    int64_t ns = 0, scale = 100000000;
+    if (*p == '.') {
+        p++;
+        while (isdigit((unsigned char)*p)) {
+            ns += (*p - '0') * scale;
+            scale /= 10;
+            p++;
+        }
+    }
+    *end = p;
+    return ns;
+}
+
+// Timestamp field to nanoseconds; returns -1 if it is not one of the accepted forms
+static int64_t parse_timestamp(const char* field) {
+    int y, mo, d, h, mi, s, n = 0;
+    const char* end;
+
+    if (sscanf(field, "%d-%d-%d%*[ T]%d:%d:%d%n", &y, &mo, &d, &h, &mi, &s, &n) == 6 && n > 0) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_year = y - 1900;
+        tm.tm_mon = mo - 1;
+        tm.tm_mday = d;
+        tm.tm_hour = h;
+        tm.tm_min = mi;
+        tm.tm_sec = s;
+        return (int64_t)timegm(&tm) * 1000000000LL + parse_fraction(field + n, &end);
+    }
+    n = 0;
+    if (sscanf(field, "%d:%d:%d%n", &h, &mi, &s, &n) == 3 && n > 0) {
+        return ((int64_t)h * 3600 + mi * 60 + s) * 1000000000LL + parse_fraction(field + n, &end);
+    }
+    if (isdigit((unsigned char)field[0])) {
+        char* after;
+        long long seconds = strtoll(field, &after, 10);
+        return seconds * 1000000000LL + parse_fraction(after, &end);
+    }
+    return -1;
+}
+
+static int* slots = NULL;         // Open-addressing index: symbol index + 1 (0 = empty)
+static int slot_mask = 0;
+
+static uint32_t symbol_hash(const char* key) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < TICKFILE_SYMBOL_LEN && key[i]; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void index_rebuild(int size) {
+    free(slots);
+    slots = calloc(size, sizeof(int));
+    slot_mask = size - 1;
+    for (int i = 0; i < symbol_count; i++) {
+        uint32_t slot = symbol_hash(symbols[i].symbol) & slot_mask;
+        while (slots[slot]) slot = (slot + 1) & slot_mask;
+        slots[slot] = i + 1;
+    }
+}
+
+static int symbol_index(const char* symbol, double price) {
+    char key[TICKFILE_SYMBOL_LEN];
+    memset(key, 0, sizeof(key));
+    for (int i = 0; symbol[i]; i++) key[i] = toupper((unsigned char)symbol[i]);
+
+    if (!slots) index_rebuild(1024);
+    uint32_t slot = symbol_hash(key) & slot_mask;
+    while (slots[slot]) {
+        int i = slots[slot] - 1;
+        if (memcmp(symbols[i].symbol, key, sizeof(key)) == 0) return i;
+        slot = (slot + 1) & slot_mask;
+    }
+
+    if (symbol_count == symbol_capacity) {
+        symbol_capacity = symbol_capacity ? symbol_capacity * 2 : 64;
+        symbols = realloc(symbols, sizeof(TickSymbol) * symbol_capacity);
+    }
+    memcpy(symbols[symbol_count].symbol, key, sizeof(key));
+    symbols[symbol_count].open_price = price;
+    slots[slot] = ++symbol_count;
+    if (symbol_count * 2 > slot_mask + 1) index_rebuild((slot_mask + 1) * 2);
+    return symbol_count - 1;
+}
+
+static int compare_ticks(const void* a, const void* b) {
+    const InputTick* x = a;
+    const InputTick* y = b;
+    if (x->tick.ts_ns != y->tick.ts_ns) return x->tick.ts_ns < y->tick.ts_ns ? -1 : 1;
+    return x->line < y->line ? -1 : (x->line > y->line);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s input.csv output.ticks\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in) {
+        perror("Input");
+        return EXIT_FAILURE;
+    }
+
+    InputTick* ticks = NULL;
+    size_t count = 0, capacity = 0;
+    uint64_t line_no = 0, skipped = 0;
+    char line[MAX_LINE];
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        char* ts_field = strtok(line, ",\r\n");
+        char* symbol = strtok(NULL, ", \t\r\n");
+        char* price_field = strtok(NULL, ",\r\n");
+        char* volume_field = strtok(NULL, ",\r\n");
+        if (!ts_field || !symbol || !price_field) {
+            skipped++;
+            continue;
+        }
+
+        int64_t ts = parse_timestamp(ts_field);
+        double price = atof(price_field);
+        if (ts < 0 || price <= 0.0 || strlen(symbol) > MAX_SYMBOL_CHARS) {
+            if (line_no > 1) skipped++; // A header line is expected
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            ticks = realloc(ticks, sizeof(InputTick) * capacity);
+            if (!ticks) {
+                fprintf(stderr, "Out of memory after %zu ticks\n", count);
+                return EXIT_FAILURE;
+            }
+        }
+        InputTick* t = &ticks[count++];
+        t->tick.ts_ns = ts;
+        t->tick.symbol = symbol_index(symbol, price);
+        t->tick.volume = volume_field ? (uint32_t)strtoul(volume_field, NULL, 10) : DEFAULT_TICK_VOLUME;
+        t->tick.price = price;
+        t->line = line_no;
+    }
+    fclose(in);
+
+    // Replay needs non-decreasing timestamps
+    qsort(ticks, count, sizeof(InputTick), compare_ticks);
+
+    // Opening price is the earliest tick per symbol, not the first line seen
+    for (size_t i = count; i-- > 0;) {
+        symbols[ticks[i].tick.symbol].open_price = ticks[i].tick.price;
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        perror("Output");
+        return EXIT_FAILURE;
+    }
+
+    TickFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TICKFILE_MAGIC, sizeof(header.magic));
+    header.version = TICKFILE_VERSION;
+    header.symbol_count = symbol_count;
+    header.tick_count = count;
+    header.first_ns = count ? ticks[0].tick.ts_ns : 0;
+
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+             (symbol_count == 0 || fwrite(symbols, sizeof(TickSymbol), symbol_count, out) == (size_t)symbol_count);
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = fwrite(&ticks[i].tick, sizeof(TickRecord), 1, out) == 1;
+    }
+    if (fclose(out) != 0 || !ok) {
+        perror("Write");
+        return EXIT_FAILURE;
+    }
+
+    double span = count ? (ticks[count - 1].tick.ts_ns - ticks[0].tick.ts_ns) / 1e9 : 0.0;
+    printf("Wrote %zu ticks, %d symbols, %.1f s of market time to %s (%lu lines skipped)\n",
+           count, symbol_count, span, argv[2], (unsigned long)skipped);
+    free(ticks);
+    free(symbols);
+    free(slots);
+    return EXIT_SUCCESS;
+}
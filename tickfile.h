@@ -0,0 +1,38 @@
+#ifndef TICKFILE_H
+#define TICKFILE_H
+
+// Compact binary tick file shared by the replay source and the tickconv converter.
+//
+// Layout: TickFileHeader, then symbol_count TickSymbol entries, then tick_count
+// TickRecord entries sorted by timestamp. Every section is 8-byte aligned so the
+// file can be used in place through mmap. Little-endian.
+
+#include <stdint.h>
+
+// Constants
+#define TICKFILE_MAGIC "TICKS01"        // 8 bytes including the NUL
+#define TICKFILE_VERSION 1
+#define TICKFILE_SYMBOL_LEN 16
+
+// Structures
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t symbol_count;
+    uint64_t tick_count;
+    int64_t first_ns;               // Timestamp of the first tick
+} TickFileHeader;
+
+typedef struct {
+    char symbol[TICKFILE_SYMBOL_LEN]; // NUL padded
+    double open_price;              // First price in the file, base for symbols it lists
+} TickSymbol;
+
+typedef struct {
+    int64_t ts_ns;                  // Source timestamp (only differences matter for playback)
+    uint32_t symbol;                // Index into the symbol table
+    uint32_t volume;
+    double price;
+} TickRecord;
+
+#endif
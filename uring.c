@@ -0,0 +1,282 @@
+#include "uring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+// Raw io_uring plumbing for the reactors and the acceptor. Receives use multishot
+// recv over a registered ring of provided buffers, so one armed request delivers
+// every read of a session; output is queued as SENDMSG requests and submitted with
+// the next io_uring_enter, which also waits for completions.
+
+static int sys_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags, const void* arg, size_t size) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+static int sys_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// Whether this kernel has everything the backend uses: timed waits, no dropped
+// completions, provided buffer rings and the ops below. SEND_ZC arrived in the
+// same release as multishot recv (6.0), which the probe cannot report directly.
+int uring_supported() {
+    Uring u;
+    if (uring_init(&u, 8) < 0) return 0;
+
+    static const int ops[] = { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG,
+                               IORING_OP_READ, IORING_OP_SEND_ZC };
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, size);
+    int ok = probe && sys_register(u.fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (size_t i = 0; ok && i < sizeof(ops) / sizeof(ops[0]); i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+
+    if (ok) ok = uring_buffers_init(&u) == 0;
+    uring_destroy(&u);
+    return ok;
+}
+
+int uring_init(Uring* u, unsigned entries) {
+    struct io_uring_params p;
+    memset(u, 0, sizeof(*u));
+    memset(&p, 0, sizeof(p));
+    u->fd = -1;
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+
+    int fd = sys_setup(entries, &p);
+    if (fd < 0) return -1;
+    u->fd = fd;
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) {
+        uring_destroy(u);
+        return -1;
+    }
+
+    u->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_map_size > u->sq_map_size) u->sq_map_size = u->cq_map_size;
+        u->cq_map_size = u->sq_map_size;
+    }
+    u->sq_map = mmap(NULL, u->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    if (u->sq_map == MAP_FAILED) {
+        u->sq_map = NULL;
+        uring_destroy(u);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_map = u->sq_map;
+    } else {
+        u->cq_map = mmap(NULL, u->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_CQ_RING);
+        if (u->cq_map == MAP_FAILED) {
+            u->cq_map = NULL;
+            uring_destroy(u);
+            return -1;
+        }
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        uring_destroy(u);
+        return -1;
+    }
+
+    char* sq = u->sq_map;
+    char* cq = u->cq_map;
+    u->sq_head = (unsigned*)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    u->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    u->sq_local = *u->sq_tail;
+    u->cq_head = (unsigned*)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    u->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    // SQE slot i is always submitted through array entry i
+    unsigned* array = (unsigned*)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) array[i] = i;
+    return 0;
+}
+
+// Register URING_BUF_COUNT receive buffers as group URING_BUF_GROUP
+int uring_buffers_init(Uring* u) {
+    u->buf_ring_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    void* ring = mmap(NULL, u->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) return -1;
+    u->buf_ring = ring;
+    u->buffers = malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (!u->buffers) return -1;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, u->buf_ring_size);
+        u->buf_ring = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < URING_BUF_COUNT; i++) {
+        struct io_uring_buf* b = &u->buf_ring->bufs[i];
+        b->addr = (uint64_t)(uintptr_t)(u->buffers + (size_t)i * URING_BUF_SIZE);
+        b->len = URING_BUF_SIZE;
+        b->bid = i;
+    }
+    __atomic_store_n(&u->buf_ring->tail, URING_BUF_COUNT, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void uring_destroy(Uring* u) {
+    if (u->fd >= 0) close(u->fd); // Cancels whatever is still in flight
+    if (u->buf_ring) munmap(u->buf_ring, u->buf_ring_size);
+    free(u->buffers);
+    if (u->sqes) munmap(u->sqes, u->sqes_size);
+    if (u->cq_map && u->cq_map != u->sq_map) munmap(u->cq_map, u->cq_map_size);
+    if (u->sq_map) munmap(u->sq_map, u->sq_map_size);
+    memset(u, 0, sizeof(*u));
+    u->fd = -1;
+}
+
+// Make queued SQEs visible to the kernel (submitted by the next uring_enter)
+static void publish(Uring* u) {
+    unsigned tail = *u->sq_tail;
+    if (tail == u->sq_local) return;
+    u->pending += u->sq_local - tail;
+    __atomic_store_n(u->sq_tail, u->sq_local, __ATOMIC_RELEASE);
+}
+
+// Next free SQE, cleared; submits early only when the queue is full
+struct io_uring_sqe* uring_sqe(Uring* u) {
+    while (u->sq_local - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+        publish(u);
+        u->enters++;
+        int n = sys_enter(u->fd, u->pending, 0, 0, NULL, 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return NULL;
+        if (n > 0) u->pending -= n;
+    }
+    struct io_uring_sqe* sqe = &u->sqes[u->sq_local & u->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_local++;
+    return sqe;
+}
+
+// Multishot accept: one CQE (new socket in res) per connection until cancelled
+void uring_prep_accept(struct io_uring_sqe* sqe, int fd, void* user) {
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = (uint64_t)(uintptr_t)user;
+}
+
+// Multishot recv into the provided buffers: one CQE per read, res 0 at end of stream
+void uring_prep_recv(struct io_uring_sqe* sqe, int fd, void* user) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = (uint64_t)(uintptr_t)user;
+}
+
+void uring_prep_read(struct io_uring_sqe* sqe, int fd, void* buf, unsigned len, void* user) {
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->user_data = (uint64_t)(uintptr_t)user;
+}
+
+void uring_prep_sendmsg(struct io_uring_sqe* sqe, int fd, const void* msghdr, void* user) {
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msghdr;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)user;
+}
+
+// Submit everything queued and wait up to timeout_ms (-1 = forever, 0 = not at all)
+// for a completion, all in one syscall. Returns -1 on a broken ring.
+int uring_enter(Uring* u, int timeout_ms) {
+    publish(u);
+    unsigned flags = 0;
+    unsigned wait = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    const void* argp = NULL;
+    size_t argsz = 0;
+
+    if (timeout_ms != 0 && !uring_peek(u)) {
+        flags |= IORING_ENTER_GETEVENTS;
+        wait = 1;
+        if (timeout_ms > 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+    }
+    if (!u->pending && !wait) return 0;
+
+    u->enters++;
+    int n = sys_enter(u->fd, u->pending, wait, flags, argp, argsz);
+    if (n < 0) {
+        if (errno == EINTR || errno == ETIME || errno == EAGAIN || errno == EBUSY) return 0;
+        return -1;
+    }
+    u->pending -= n;
+    return 0;
+}
+
+// Oldest unreaped completion, or NULL
+struct io_uring_cqe* uring_peek(Uring* u) {
+    unsigned head = *u->cq_head;
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+    return &u->cqes[head & u->cq_mask];
+}
+
+void uring_advance(Uring* u) {
+    __atomic_store_n(u->cq_head, *u->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// Provided buffer a receive completion filled, or NULL
+char* uring_buffer(Uring* u, const struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_BUFFER)) return NULL;
+    return u->buffers + (size_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) * URING_BUF_SIZE;
+}
+
+// Hand a completion's buffer back to the kernel
+void uring_buffer_recycle(Uring* u, const struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_BUFFER)) return;
+    unsigned id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    uint16_t tail = u->buf_ring->tail;
+    struct io_uring_buf* b = &u->buf_ring->bufs[tail & (URING_BUF_COUNT - 1)];
+    b->addr = (uint64_t)(uintptr_t)(u->buffers + (size_t)id * URING_BUF_SIZE);
+    b->len = URING_BUF_SIZE;
+    b->bid = id;
+    __atomic_store_n(&u->buf_ring->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+}
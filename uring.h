@@ -0,0 +1,60 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+// Constants
+#define URING_ENTRIES 1024              // Submission queue slots (completion queue is 4x)
+#define URING_BUF_GROUP 0               // Provided buffer group used for receives
+#define URING_BUF_COUNT 256             // Receive buffers per ring (power of two)
+#define URING_BUF_SIZE 4096
+
+// Structures
+
+// One io_uring instance driven through the raw syscalls (no liburing). Only the
+// thread that owns it prepares, submits and reaps.
+typedef struct Uring {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local;              // Tail including SQEs not yet published
+    unsigned pending;               // Published SQEs the kernel has not consumed
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;                   // Same mapping as sq_map with IORING_FEAT_SINGLE_MMAP
+    size_t cq_map_size;
+    size_t sqes_size;
+    struct io_uring_buf_ring* buf_ring; // Registered receive buffers (NULL = none)
+    char* buffers;
+    size_t buf_ring_size;
+    uint64_t enters;                // io_uring_enter calls made
+} Uring;
+
+// Function prototypes
+int uring_supported();
+int uring_init(Uring* u, unsigned entries);
+int uring_buffers_init(Uring* u);
+void uring_destroy(Uring* u);
+
+struct io_uring_sqe* uring_sqe(Uring* u);
+void uring_prep_accept(struct io_uring_sqe* sqe, int fd, void* user);
+void uring_prep_recv(struct io_uring_sqe* sqe, int fd, void* user);
+void uring_prep_read(struct io_uring_sqe* sqe, int fd, void* buf, unsigned len, void* user);
+void uring_prep_sendmsg(struct io_uring_sqe* sqe, int fd, const void* msghdr, void* user);
+int uring_enter(Uring* u, int timeout_ms);
+
+struct io_uring_cqe* uring_peek(Uring* u);
+void uring_advance(Uring* u);
+char* uring_buffer(Uring* u, const struct io_uring_cqe* cqe);
+void uring_buffer_recycle(Uring* u, const struct io_uring_cqe* cqe);
+
+#endif